@@ -1,7 +1,15 @@
 #include "port_audio.h"
 
 #include "port_audio_callback_data.h"
-
+#include "port_audio_device_changes.h"
+#include "port_audio_latency_probe.h"
+#include "port_audio_render_ahead.h"
+#include "port_audio_scheduler.h"
+#include "port_audio_session_recorder.h"
+#include "port_audio_shm_endpoint.h"
+#include "port_audio_tracer.h"
+
+#include "core/math/math_funcs.h"
 #include "core/os/memory.h"
 #include "core/os/os.h"
 
@@ -11,8 +19,28 @@
 
 #include <portaudio.h>
 
+#include <atomic>
+#include <cstring>
+#include <vector>
+
 #pragma region IMP_DETAILS
 
+// warm streams keep running while parked, the audio thread acknowledges parking so the callback can be swapped
+enum PoolState {
+    POOL_ACTIVE = 0,
+    POOL_PARKING = 1,
+    POOL_PARKED = 2,
+};
+
+// reconfigure_stream() hands the callback from the old to the replacement stream at a period boundary
+enum HandoffState {
+    HANDOFF_NONE = 0,
+    HANDOFF_WAITING = 1,
+    HANDOFF_FADE_OUT = 2,
+    HANDOFF_FADE_IN = 3,
+    HANDOFF_DONE = 4,
+};
+
 class CallbackUserDataGdBinding {
 public:
     PortAudio *port_audio;
@@ -20,14 +48,83 @@ public:
     Callable audio_callback;
     Callable stream_finished_callback;
     Ref<PortAudioCallbackData> audio_callback_data;
+    PortAudioRenderAhead *render_ahead;
+    Ref<PortAudioGraph> graph;
+    Ref<PortAudioConvolver> convolver;
+    Ref<PortAudioVoiceGate> voice_gate;
+    std::vector<float> pre_roll_scratch;
+    Ref<PortAudioWatchdog> watchdog;
+    Ref<PortAudioJitterBuffer> jitter_buffer;
+    Ref<PortAudioBroadcast> broadcast;
+    Ref<PortAudioLimiter> limiter;
+    // created by the first schedule() call, FLOAT_32 output only
+    std::atomic<PortAudioScheduler *> scheduler;
+    bool scheduler_supported;
+    PortAudioClock *clock;
+    std::atomic<PortAudioLatencyProbe *> latency_probe;
+    std::atomic<PortAudioTracer *> tracer;
+    std::atomic<PortAudioShmEndpoint *> shm_endpoint;
+    std::atomic<PortAudioSessionRecorder *> recorder;
+    // callbacks entered and returned, see wait_for_callbacks
+    std::atomic<uint64_t> callbacks_started;
+    std::atomic<uint64_t> callbacks_finished;
+    // add_trace_marker calls using the tracer, see wait_for_markers
+    std::atomic<int> marker_pins;
     uint64_t last_call_duration;
     int output_sample_size;
     int input_sample_size;
     int output_channel_count;
     int input_channel_count;
+    int output_device_channel_count;
+    int input_device_channel_count;
+    PortAudioChannelRouter *output_router;
+    PortAudioChannelRouter *input_router;
+    std::vector<float> output_routing_buffer;
+    std::vector<float> input_routing_buffer;
+    PortAudioInputConditioner *input_conditioner;
+    std::vector<float> input_conditioning_buffer;
+    bool output_non_interleaved;
+    bool input_non_interleaved;
+    std::vector<uint8_t> interleave_buffer;
+    bool output_native_format;
+    bool input_native_format;
+    // read by the callback, a warm stream without a bound script plays silence
+    std::atomic<bool> warm;
+    std::atomic<bool> warm_bound;
+    std::atomic<int> pool_state;
+    std::atomic<int> handoff_state;
+    std::atomic<int> handoff_callbacks;
+    CallbackUserDataGdBinding *handoff_target;
+    double handoff_sample_rate;
+    bool handoff_can_fade;
+    // crossfaded handoffs: the old stream renders handoff_frames, the last handoff_fade_frames of them are written to
+    // handoff_buffer of the replacement, which replays them fading in while the old stream fades them out
+    bool handoff_crossfade;
+    unsigned long handoff_frames;
+    unsigned long handoff_fade_frames;
+    unsigned long handoff_position;
+    std::vector<float> handoff_buffer;
 
     CallbackUserDataGdBinding() {
         port_audio = nullptr;
+        render_ahead = nullptr;
+        graph = Ref<PortAudioGraph>();
+        convolver = Ref<PortAudioConvolver>();
+        voice_gate = Ref<PortAudioVoiceGate>();
+        watchdog = Ref<PortAudioWatchdog>();
+        jitter_buffer = Ref<PortAudioJitterBuffer>();
+        broadcast = Ref<PortAudioBroadcast>();
+        limiter = Ref<PortAudioLimiter>();
+        scheduler.store(nullptr);
+        scheduler_supported = false;
+        clock = nullptr;
+        latency_probe.store(nullptr);
+        tracer.store(nullptr);
+        shm_endpoint.store(nullptr);
+        recorder.store(nullptr);
+        callbacks_started.store(0);
+        callbacks_finished.store(0);
+        marker_pins.store(0);
         last_call_duration = 0;
         stream = Ref<PortAudioStream>();
         audio_callback = Callable();
@@ -37,13 +134,257 @@ public:
         input_sample_size = 0;
         output_channel_count = 0;
         input_channel_count = 0;
+        output_device_channel_count = 0;
+        input_device_channel_count = 0;
+        output_router = nullptr;
+        input_router = nullptr;
+        input_conditioner = nullptr;
+        output_non_interleaved = false;
+        input_non_interleaved = false;
+        output_native_format = false;
+        input_native_format = false;
+        warm = false;
+        warm_bound = false;
+        pool_state.store(POOL_ACTIVE);
+        handoff_state.store(HANDOFF_NONE);
+        handoff_callbacks.store(0);
+        handoff_target = nullptr;
+        handoff_sample_rate = 0;
+        handoff_can_fade = false;
+        handoff_crossfade = false;
+        handoff_frames = 0;
+        handoff_fade_frames = 0;
+        handoff_position = 0;
+    }
+
+    // pins are only taken under data_map_mutex, once the user data is out of the map or its tracer is detached
+    // just the markers already in flight are left, each a single ring buffer write
+    void wait_for_markers() {
+        while (marker_pins.load() > 0) {
+            OS::get_singleton()->delay_usec(100);
+        }
+    }
+
+    ~CallbackUserDataGdBinding() {
+        wait_for_markers();
+        delete output_router;
+        delete input_router;
+        delete input_conditioner;
+        // the stream is closed at this point, finish the trace file
+        delete tracer.load();
+        delete shm_endpoint.load();
+        delete recorder.load();
     }
 };
 
-static int port_audio_callback_gd_binding_converter(const void *p_input_buffer, void *p_output_buffer,
-                                                    unsigned long p_frames_per_buffer,
-                                                    const PaStreamCallbackTimeInfo *p_time_info,
-                                                    PaStreamCallbackFlags p_status_flags, void *p_user_data) {
+// non interleaved buffers are arrays of per channel pointers, scripts always see interleaved frames.
+// SAMPLE_SIZE is known at compile time so each copy is a single load and store, 0 copies p_sample_size bytes
+template <int SAMPLE_SIZE>
+static void interleave_samples(uint8_t *r_destination, const uint8_t *const *p_channels, unsigned long p_frames,
+                               int p_channel_count, int p_sample_size) {
+    const int sample_size = SAMPLE_SIZE ? SAMPLE_SIZE : p_sample_size;
+    const int frame_size = p_channel_count * sample_size;
+    for (int c = 0; c < p_channel_count; c++) {
+        const uint8_t *source = p_channels[c];
+        uint8_t *destination = r_destination + c * sample_size;
+        for (unsigned long i = 0; i < p_frames; i++) {
+            memcpy(destination + i * frame_size, source + i * sample_size, sample_size);
+        }
+    }
+}
+
+template <int SAMPLE_SIZE>
+static void deinterleave_samples(uint8_t *const *r_channels, const uint8_t *p_source, unsigned long p_frames,
+                                 int p_channel_count, int p_sample_size) {
+    const int sample_size = SAMPLE_SIZE ? SAMPLE_SIZE : p_sample_size;
+    const int frame_size = p_channel_count * sample_size;
+    for (int c = 0; c < p_channel_count; c++) {
+        const uint8_t *source = p_source + c * sample_size;
+        uint8_t *destination = r_channels[c];
+        for (unsigned long i = 0; i < p_frames; i++) {
+            memcpy(destination + i * sample_size, source + i * frame_size, sample_size);
+        }
+    }
+}
+
+static void interleave_input(uint8_t *r_destination, const void *p_input_buffer, unsigned long p_frames,
+                             int p_channel_count, int p_sample_size) {
+    const uint8_t *const *channels = (const uint8_t *const *) p_input_buffer;
+    switch (p_sample_size) {
+        case 1:
+            interleave_samples<1>(r_destination, channels, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 2:
+            interleave_samples<2>(r_destination, channels, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 3:
+            interleave_samples<3>(r_destination, channels, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 4:
+            interleave_samples<4>(r_destination, channels, p_frames, p_channel_count, p_sample_size);
+            break;
+        default:
+            interleave_samples<0>(r_destination, channels, p_frames, p_channel_count, p_sample_size);
+            break;
+    }
+}
+
+static void deinterleave_output(void *p_output_buffer, const uint8_t *p_source, unsigned long p_frames,
+                                int p_channel_count, int p_sample_size) {
+    uint8_t *const *channels = (uint8_t *const *) p_output_buffer;
+    switch (p_sample_size) {
+        case 1:
+            deinterleave_samples<1>(channels, p_source, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 2:
+            deinterleave_samples<2>(channels, p_source, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 3:
+            deinterleave_samples<3>(channels, p_source, p_frames, p_channel_count, p_sample_size);
+            break;
+        case 4:
+            deinterleave_samples<4>(channels, p_source, p_frames, p_channel_count, p_sample_size);
+            break;
+        default:
+            deinterleave_samples<0>(channels, p_source, p_frames, p_channel_count, p_sample_size);
+            break;
+    }
+}
+
+static void silence_output(CallbackUserDataGdBinding *p_user_data, void *p_output_buffer, unsigned long p_frames) {
+    if (p_user_data->output_non_interleaved) {
+        uint8_t *const *channels = (uint8_t *const *) p_output_buffer;
+        for (int c = 0; c < p_user_data->output_device_channel_count; c++) {
+            memset(channels[c], 0, p_frames * p_user_data->output_sample_size);
+        }
+    } else {
+        memset(p_output_buffer, 0, p_frames * p_user_data->output_device_channel_count * p_user_data->output_sample_size);
+    }
+}
+
+// without a crossfade the old stream fades out its last period and the replacement fades in its first one
+static void fade_handoff_period(CallbackUserDataGdBinding *p_user_data, void *p_output_buffer, unsigned long p_frames_per_buffer,
+                                bool p_fade_out) {
+    if (!p_output_buffer || !p_user_data->handoff_can_fade || p_frames_per_buffer == 0) {
+        return;
+    }
+    float *samples = (float *) p_output_buffer;
+    int channel_count = p_user_data->output_device_channel_count;
+    float gain_step = 1.0f / p_frames_per_buffer;
+    for (unsigned long frame = 0; frame < p_frames_per_buffer; frame++) {
+        float gain = p_fade_out ? 1.0f - gain_step * (frame + 1) : gain_step * (frame + 1);
+        for (int c = 0; c < channel_count; c++) {
+            samples[frame * channel_count + c] *= gain;
+        }
+    }
+}
+
+// the old stream fades out the end of its last handoff_frames and copies those frames to the replacement, which replays
+// them fading in, so both streams play the same audio with gains summing to one. true once the last frame is rendered
+static bool fade_out_handoff(CallbackUserDataGdBinding *p_user_data, void *p_output_buffer, unsigned long p_frames_per_buffer) {
+    if (!p_user_data->handoff_crossfade) {
+        fade_handoff_period(p_user_data, p_output_buffer, p_frames_per_buffer, true);
+        return true;
+    }
+    float *samples = (float *) p_output_buffer;
+    float *handoff_buffer = p_user_data->handoff_target->handoff_buffer.data();
+    int channel_count = p_user_data->output_device_channel_count;
+    unsigned long fade_start = p_user_data->handoff_frames - p_user_data->handoff_fade_frames;
+    float gain_step = 1.0f / p_user_data->handoff_fade_frames;
+    for (unsigned long frame = 0; frame < p_frames_per_buffer; frame++) {
+        float *output_frame = samples ? samples + frame * channel_count : nullptr;
+        unsigned long position = p_user_data->handoff_position;
+        if (position >= p_user_data->handoff_frames) {
+            // rendered after the handoff, the replacement continues from here
+            if (output_frame) {
+                memset(output_frame, 0, channel_count * sizeof(float));
+            }
+            continue;
+        }
+        p_user_data->handoff_position++;
+        if (position < fade_start) {
+            continue;
+        }
+        float *handoff_frame = handoff_buffer + (position - fade_start) * channel_count;
+        float gain = 1.0f - gain_step * (position - fade_start + 1);
+        for (int c = 0; c < channel_count; c++) {
+            handoff_frame[c] = output_frame ? output_frame[c] : 0.0f;
+            if (output_frame) {
+                output_frame[c] *= gain;
+            }
+        }
+    }
+    return p_user_data->handoff_position >= p_user_data->handoff_frames;
+}
+
+// first period of the replacement after a crossfaded handoff, replaces the script
+static void fade_in_handoff(CallbackUserDataGdBinding *p_user_data, void *p_output_buffer, unsigned long p_frames_per_buffer) {
+    float *samples = (float *) p_output_buffer;
+    int channel_count = p_user_data->output_device_channel_count;
+    unsigned long frames = MIN(p_frames_per_buffer, p_user_data->handoff_fade_frames);
+    float gain_step = 1.0f / p_user_data->handoff_fade_frames;
+    for (unsigned long frame = 0; frame < frames; frame++) {
+        const float *handoff_frame = p_user_data->handoff_buffer.data() + frame * channel_count;
+        float gain = gain_step * (frame + 1);
+        for (int c = 0; c < channel_count; c++) {
+            samples[frame * channel_count + c] = handoff_frame[c] * gain;
+        }
+    }
+    memset(samples + frames * channel_count, 0, (p_frames_per_buffer - frames) * channel_count * sizeof(float));
+}
+
+// timing of a finished callback goes to the watchdog and the tracer
+static void finish_callback(CallbackUserDataGdBinding *p_user_data, void *p_output_buffer, uint64_t p_micro_seconds_start,
+                            unsigned long p_frames_per_buffer, PaStreamCallbackFlags p_status_flags,
+                            const PaStreamCallbackTimeInfo *p_time_info) {
+    int handoff_state = p_user_data->handoff_state.load(std::memory_order_acquire);
+    bool handoff_finished = false;
+    if (handoff_state == HANDOFF_FADE_OUT) {
+        handoff_finished = fade_out_handoff(p_user_data, p_output_buffer, p_frames_per_buffer);
+    } else if (handoff_state == HANDOFF_FADE_IN) {
+        fade_handoff_period(p_user_data, p_output_buffer, p_frames_per_buffer, false);
+        handoff_finished = true;
+    }
+    uint64_t micro_seconds_end = OS::get_singleton()->get_ticks_usec();
+    p_user_data->last_call_duration = micro_seconds_end - p_micro_seconds_start;
+    if (p_user_data->watchdog.is_valid()) {
+        p_user_data->watchdog->update(p_user_data->last_call_duration, p_frames_per_buffer, p_status_flags);
+    }
+    PortAudioTracer *tracer = p_user_data->tracer.load();
+    if (tracer) {
+        tracer->record_callback(p_micro_seconds_start, micro_seconds_end, p_frames_per_buffer, p_status_flags,
+                                p_time_info->inputBufferAdcTime, p_time_info->currentTime, p_time_info->outputBufferDacTime);
+    }
+    // last step, the replacement takes over the shared watchdog and clock only after this callback is done with them
+    if (handoff_finished && handoff_state == HANDOFF_FADE_OUT) {
+        // both streams share the clock of the reconfigured stream, the replacement starts a new time base
+        p_user_data->clock->reset(p_user_data->handoff_sample_rate);
+        p_user_data->handoff_state.store(HANDOFF_DONE, std::memory_order_release);
+        p_user_data->handoff_target->handoff_state.store(HANDOFF_FADE_IN, std::memory_order_release);
+    } else if (handoff_finished) {
+        p_user_data->handoff_state.store(HANDOFF_NONE, std::memory_order_release);
+    }
+}
+
+// objects the callback reads through an atomic pointer are detached by exchanging the pointer with nullptr. a
+// callback that still uses the object entered before the exchange, wait until all of those have returned before
+// freeing it. false when the callback did not return in time, the object must then be leaked
+static bool wait_for_callbacks(CallbackUserDataGdBinding *p_user_data, uint64_t p_timeout_usec) {
+    uint64_t started = p_user_data->callbacks_started.load();
+    uint64_t deadline = OS::get_singleton()->get_ticks_usec() + p_timeout_usec;
+    while (p_user_data->callbacks_finished.load() < started) {
+        if (OS::get_singleton()->get_ticks_usec() > deadline) {
+            return false;
+        }
+        OS::get_singleton()->delay_usec(100);
+    }
+    return true;
+}
+
+static int port_audio_callback_gd_binding_run(const void *p_input_buffer, void *p_output_buffer,
+                                              unsigned long p_frames_per_buffer,
+                                              const PaStreamCallbackTimeInfo *p_time_info,
+                                              PaStreamCallbackFlags p_status_flags, void *p_user_data) {
 
     uint64_t micro_seconds_start = OS::get_singleton()->get_ticks_usec();
 
@@ -53,6 +394,79 @@ static int port_audio_callback_gd_binding_converter(const void *p_input_buffer,
         return PortAudio::PortAudioCallbackResult::ABORT;
     }
 
+    // a replacement waits silently until the stream it replaces has faded out, the old stream stays silent afterwards
+    int handoff_state = user_data->handoff_state.load(std::memory_order_acquire);
+    if (handoff_state == HANDOFF_WAITING || handoff_state == HANDOFF_DONE) {
+        user_data->handoff_callbacks.fetch_add(1, std::memory_order_relaxed);
+        if (p_output_buffer) {
+            silence_output(user_data, p_output_buffer, p_frames_per_buffer);
+        }
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
+    }
+
+    // feed the clock estimator before any user code can delay the callback
+    if (user_data->clock) {
+        double buffer_time = p_output_buffer ? p_time_info->outputBufferDacTime : p_time_info->inputBufferAdcTime;
+        user_data->clock->update(micro_seconds_start, p_frames_per_buffer, p_time_info->currentTime, buffer_time);
+    }
+
+    // the first period after a crossfaded handoff replays what the old stream faded out, the script continues after it
+    if (handoff_state == HANDOFF_FADE_IN && user_data->handoff_crossfade) {
+        if (p_output_buffer) {
+            fade_in_handoff(user_data, p_output_buffer, p_frames_per_buffer);
+            PortAudioShmEndpoint *shm_endpoint = user_data->shm_endpoint.load();
+            if (shm_endpoint && !shm_endpoint->is_input()) {
+                shm_endpoint->write((const float *) p_output_buffer, p_frames_per_buffer);
+            }
+        }
+        user_data->handoff_state.store(HANDOFF_NONE, std::memory_order_release);
+        finish_callback(user_data, p_output_buffer, micro_seconds_start, p_frames_per_buffer, p_status_flags, p_time_info);
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
+    }
+
+    // parked warm streams play silence until they are started again, so do started ones no script is bound to
+    int pool_state = user_data->pool_state.load(std::memory_order_acquire);
+    if (pool_state != POOL_ACTIVE || (user_data->warm && !user_data->warm_bound)) {
+        if (pool_state == POOL_PARKING) {
+            user_data->pool_state.store(POOL_PARKED, std::memory_order_release);
+        }
+        if (p_output_buffer) {
+            silence_output(user_data, p_output_buffer, p_frames_per_buffer);
+        }
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
+    }
+
+    // a round trip measurement owns the stream until its capture is complete
+    PortAudioLatencyProbe *latency_probe = user_data->latency_probe.load();
+    if (latency_probe && p_input_buffer && p_output_buffer) {
+        if (latency_probe->process((const float *) p_input_buffer, (float *) p_output_buffer, p_frames_per_buffer)) {
+            user_data->latency_probe.store(nullptr, std::memory_order_release);
+        }
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
+    }
+
+    // published streams hand the device frames to other processes, readers never delay the callback
+    PortAudioShmEndpoint *shm_endpoint = user_data->shm_endpoint.load();
+    if (shm_endpoint && shm_endpoint->is_input() && p_input_buffer) {
+        shm_endpoint->write((const float *) p_input_buffer, p_frames_per_buffer);
+    }
+
+    // render ahead streams are filled from the main thread, only drain the buffered audio
+    if (user_data->render_ahead) {
+        if (p_output_buffer) {
+            user_data->render_ahead->pull(p_output_buffer, p_frames_per_buffer);
+            if (shm_endpoint && !shm_endpoint->is_input()) {
+                shm_endpoint->write((const float *) p_output_buffer, p_frames_per_buffer);
+            }
+        }
+        PortAudioTracer *tracer = user_data->tracer.load();
+        if (tracer) {
+            tracer->record_callback(micro_seconds_start, OS::get_singleton()->get_ticks_usec(), p_frames_per_buffer, p_status_flags,
+                                    p_time_info->inputBufferAdcTime, p_time_info->currentTime, p_time_info->outputBufferDacTime);
+        }
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
+    }
+
     // retrieve callback data
     Ref<PortAudioCallbackData> audio_callback_data = user_data->audio_callback_data;
     Ref<StreamPeerBuffer> input_buffer;
@@ -68,17 +482,106 @@ static int port_audio_callback_gd_binding_converter(const void *p_input_buffer,
         has_output = output_buffer.is_valid();
     }
 
+    const int input_frame_size = user_data->input_channel_count * user_data->input_sample_size;
+    const int output_frame_size = user_data->output_channel_count * user_data->output_sample_size;
+
     // copy input buffer to godot type, if available
+    // float_input is set when native stages produced the float frames the script sees
+    const float *float_input = nullptr;
     if (has_input) {
+        int input_size = p_frames_per_buffer * input_frame_size;
+        if (input_buffer->get_size() != input_size) {
+            input_buffer->resize(input_size);
+        }
+        input_buffer->seek(0);
+        if (user_data->input_router) {
+            // device channels are reduced to the logical channels before the script sees them
+            size_t routed_samples = p_frames_per_buffer * user_data->input_channel_count;
+            if (user_data->input_routing_buffer.size() < routed_samples) {
+                user_data->input_routing_buffer.resize(routed_samples);
+            }
+            user_data->input_router->process((const float *) p_input_buffer, user_data->input_routing_buffer.data(), p_frames_per_buffer);
+            float_input = user_data->input_routing_buffer.data();
+        }
+        if (user_data->input_conditioner) {
+            size_t conditioned_samples = p_frames_per_buffer * user_data->input_channel_count;
+            if (user_data->input_conditioning_buffer.size() < conditioned_samples) {
+                user_data->input_conditioning_buffer.resize(conditioned_samples);
+            }
+            user_data->input_conditioner->process(float_input ? float_input : (const float *) p_input_buffer,
+                                                  user_data->input_conditioning_buffer.data(), p_frames_per_buffer);
+            float_input = user_data->input_conditioning_buffer.data();
+        }
+        if (float_input) {
+            input_buffer->put_data((const uint8_t *) float_input, input_size);
+        } else if (user_data->input_non_interleaved) {
+            if ((int) user_data->interleave_buffer.size() < input_size) {
+                user_data->interleave_buffer.resize(input_size);
+            }
+            interleave_input(user_data->interleave_buffer.data(), p_input_buffer, p_frames_per_buffer,
+                             user_data->input_channel_count, user_data->input_sample_size);
+            input_buffer->put_data(user_data->interleave_buffer.data(), input_size);
+        } else {
+            input_buffer->put_data((const uint8_t *) p_input_buffer, input_size);
+        }
         input_buffer->seek(0);
-        uint8_t *input_buffer_ptr = (uint8_t *) p_input_buffer;
-        input_buffer->put_data(input_buffer_ptr, p_frames_per_buffer);
+        // every reader gets the frames the script sees, each follows with its own cursor
+        if (user_data->broadcast.is_valid()) {
+            user_data->broadcast->write(input_buffer->get_data_array().ptr(), p_frames_per_buffer);
+        }
+    }
+
+    // a closed voice gate skips the script, the gate keeps the recent input as pre-roll for the next opening
+    int gate_event = PortAudioVoiceGate::GATE_OPEN;
+    int pre_roll_frames = 0;
+    if (has_input && user_data->voice_gate.is_valid()) {
+        const float *gate_input = float_input ? float_input : (const float *) p_input_buffer;
+        gate_event = user_data->voice_gate->process(gate_input, p_frames_per_buffer, user_data->pre_roll_scratch.data(), pre_roll_frames);
+        if (gate_event == PortAudioVoiceGate::GATE_CLOSED) {
+            finish_callback(user_data, p_output_buffer, micro_seconds_start, p_frames_per_buffer, p_status_flags, p_time_info);
+            return PortAudio::PortAudioCallbackResult::CONTINUE;
+        }
+        audio_callback_data->set_pre_roll_frames(pre_roll_frames);
+        if (pre_roll_frames > 0) {
+            Ref<StreamPeerBuffer> pre_roll_buffer = audio_callback_data->get_pre_roll_buffer();
+            pre_roll_buffer->seek(0);
+            pre_roll_buffer->put_data((const uint8_t *) user_data->pre_roll_scratch.data(), pre_roll_frames * user_data->input_channel_count * sizeof(float));
+            pre_roll_buffer->seek(0);
+        }
+    }
+    audio_callback_data->set_voice_gate_event(gate_event);
+
+    // an overloaded stream skips the script until the watchdog lets it try again
+    if (user_data->watchdog.is_valid() && user_data->watchdog->should_skip_script()) {
+        if (p_output_buffer) {
+            if (!user_data->watchdog->render_substitute((float *) p_output_buffer, p_frames_per_buffer)) {
+                silence_output(user_data, p_output_buffer, p_frames_per_buffer);
+            }
+            if (shm_endpoint && !shm_endpoint->is_input()) {
+                shm_endpoint->write((const float *) p_output_buffer, p_frames_per_buffer);
+            }
+        }
+        finish_callback(user_data, p_output_buffer, micro_seconds_start, p_frames_per_buffer, p_status_flags, p_time_info);
+        return PortAudio::PortAudioCallbackResult::CONTINUE;
     }
 
     // provide params
-    audio_callback_data->set_input_buffer_adc_time(p_time_info->inputBufferAdcTime);
+    // with a measured alignment the adc time is the dac time of the output the input lines up with
+    double input_alignment = user_data->stream->get_input_alignment();
+    if (has_input && p_output_buffer && input_alignment > 0) {
+        audio_callback_data->set_input_buffer_adc_time(p_time_info->outputBufferDacTime - input_alignment);
+        audio_callback_data->set_input_alignment_frames((uint64_t) Math::round(input_alignment * user_data->stream->get_sample_rate()));
+    } else {
+        audio_callback_data->set_input_buffer_adc_time(p_time_info->inputBufferAdcTime);
+        audio_callback_data->set_input_alignment_frames(0);
+    }
     audio_callback_data->set_current_time(p_time_info->currentTime);
-    audio_callback_data->set_output_buffer_dac_time(p_time_info->outputBufferDacTime);
+    // the limiter delays everything written now, the script and the scheduler see when it is actually heard
+    double output_buffer_dac_time = p_time_info->outputBufferDacTime;
+    if (user_data->limiter.is_valid()) {
+        output_buffer_dac_time += user_data->limiter->get_latency();
+    }
+    audio_callback_data->set_output_buffer_dac_time(output_buffer_dac_time);
     audio_callback_data->set_frames_per_buffer(p_frames_per_buffer);
     audio_callback_data->set_status_flags(p_status_flags);
     audio_callback_data->set_last_call_duration(user_data->last_call_duration);
@@ -88,6 +591,17 @@ static int port_audio_callback_gd_binding_converter(const void *p_input_buffer,
         output_buffer->seek(0);
     }
 
+    // recordings hold exactly what the script sees, replay_session() feeds it back offline
+    PortAudioSessionRecorder *recorder = user_data->recorder.load();
+    if (recorder) {
+        recorder->record(p_frames_per_buffer, p_status_flags, micro_seconds_start, audio_callback_data->get_input_buffer_adc_time(),
+                         p_time_info->currentTime, output_buffer_dac_time,
+                         has_input ? input_buffer->get_data_array().ptr() : nullptr,
+                         has_input ? (uint32_t) (p_frames_per_buffer * input_frame_size) : 0, gate_event,
+                         pre_roll_frames > 0 ? (const uint8_t *) user_data->pre_roll_scratch.data() : nullptr,
+                         (uint32_t) (pre_roll_frames * user_data->input_channel_count * sizeof(float)));
+    }
+
     // perform callback
     Variant variant = audio_callback_data;
     const Variant *variant_ptr = &variant;
@@ -101,18 +615,70 @@ static int port_audio_callback_gd_binding_converter(const void *p_input_buffer,
 
     // write to output buffer
     if (has_output) {
-        int buffer_size = p_frames_per_buffer * user_data->output_channel_count * user_data->output_sample_size;
+        int buffer_size = p_frames_per_buffer * output_frame_size;
         int bytes_written = output_buffer->get_position();
         if (bytes_written > buffer_size) {
             print_line(
                     vformat("PortAudio::port_audio_callback_converter: bytes_written (%d) > p_frames_per_buffer (%d) - data truncated",
                             bytes_written, buffer_size));
-            return PortAudio::PortAudioCallbackResult::CONTINUE;
+            bytes_written = buffer_size;
         }
-        output_buffer->seek(0);
-        int read;
+        const uint8_t *written_ptr = output_buffer->get_data_array().ptr();
         uint8_t *output_buffer_ptr = (uint8_t *) p_output_buffer;
-        output_buffer->get_partial_data(output_buffer_ptr, bytes_written, read);
+        if (user_data->output_router) {
+            // native stages run on the logical channels, only the limiter runs after routing to the device
+            size_t routed_samples = p_frames_per_buffer * user_data->output_channel_count;
+            if (user_data->output_routing_buffer.size() < routed_samples) {
+                user_data->output_routing_buffer.resize(routed_samples);
+            }
+            output_buffer_ptr = (uint8_t *) user_data->output_routing_buffer.data();
+        }
+        if (user_data->output_non_interleaved) {
+            // whole frames only, a partial frame would be split across channels
+            unsigned long frames_written = bytes_written / output_frame_size;
+            deinterleave_output(p_output_buffer, written_ptr, frames_written, user_data->output_channel_count,
+                                user_data->output_sample_size);
+            uint8_t *const *channels = (uint8_t *const *) p_output_buffer;
+            for (int c = 0; c < user_data->output_channel_count; c++) {
+                memset(&channels[c][frames_written * user_data->output_sample_size], 0,
+                       (p_frames_per_buffer - frames_written) * user_data->output_sample_size);
+            }
+        } else {
+            // silence whatever the script did not write
+            memcpy(output_buffer_ptr, written_ptr, bytes_written);
+            memset(output_buffer_ptr + bytes_written, 0, buffer_size - bytes_written);
+        }
+
+        // externally produced audio plays alongside the script output and goes through the same stages
+        if (user_data->jitter_buffer.is_valid()) {
+            user_data->jitter_buffer->mix((float *) output_buffer_ptr, p_frames_per_buffer);
+        }
+
+        // native processing stages, graph and convolver are optional and dropped first under overload
+        bool skip_processors = user_data->watchdog.is_valid() && user_data->watchdog->should_skip_processors();
+        PortAudioScheduler *scheduler = user_data->scheduler.load(std::memory_order_acquire);
+        if (scheduler) {
+            scheduler->process((float *) output_buffer_ptr, p_frames_per_buffer, output_buffer_dac_time);
+        }
+        if (user_data->graph.is_valid() && !skip_processors) {
+            user_data->graph->process((float *) output_buffer_ptr, p_frames_per_buffer, user_data->port_audio->get_worker_pool());
+        }
+        if (user_data->convolver.is_valid() && !skip_processors) {
+            user_data->convolver->process((float *) output_buffer_ptr, p_frames_per_buffer, user_data->port_audio->get_worker_pool());
+        }
+        if (user_data->output_router) {
+            user_data->output_router->process((const float *) output_buffer_ptr, (float *) p_output_buffer, p_frames_per_buffer);
+        }
+        // last stage, on the device channels since routing sums sources with gain. also under overload
+        if (user_data->limiter.is_valid()) {
+            user_data->limiter->process((float *) p_output_buffer, p_frames_per_buffer);
+        }
+        if (shm_endpoint && !shm_endpoint->is_input()) {
+            shm_endpoint->write((const float *) p_output_buffer, p_frames_per_buffer);
+        }
+        if (user_data->watchdog.is_valid()) {
+            user_data->watchdog->store_last_good((const float *) p_output_buffer, p_frames_per_buffer);
+        }
     }
 
     // evaluate callback result
@@ -124,9 +690,25 @@ static int port_audio_callback_gd_binding_converter(const void *p_input_buffer,
         callback_result = result;
     }
 
-    uint64_t micro_seconds_end = OS::get_singleton()->get_ticks_usec();
-    user_data->last_call_duration = micro_seconds_end - micro_seconds_start;
+    finish_callback(user_data, p_output_buffer, micro_seconds_start, p_frames_per_buffer, p_status_flags, p_time_info);
+
+    return callback_result;
+}
 
+static int port_audio_callback_gd_binding_converter(const void *p_input_buffer, void *p_output_buffer,
+                                                    unsigned long p_frames_per_buffer,
+                                                    const PaStreamCallbackTimeInfo *p_time_info,
+                                                    PaStreamCallbackFlags p_status_flags, void *p_user_data) {
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) p_user_data;
+    if (!user_data) {
+        print_line("PortAudio::port_audio_callback_converter: !user_data");
+        return PortAudio::PortAudioCallbackResult::ABORT;
+    }
+    // seq_cst, pairs with the exchange in the thread that detaches an object
+    user_data->callbacks_started.fetch_add(1);
+    int callback_result = port_audio_callback_gd_binding_run(p_input_buffer, p_output_buffer, p_frames_per_buffer, p_time_info,
+                                                             p_status_flags, p_user_data);
+    user_data->callbacks_finished.fetch_add(1);
     return callback_result;
 }
 
@@ -254,6 +836,268 @@ static PaSampleFormat get_sample_format(PortAudioStreamParameter::PortAudioSampl
     return (PaSampleFormat) p_sample_format;
 }
 
+// heuristic: the format each host api usually exchanges with the driver, anything else costs a conversion pass per
+// buffer. portaudio does not report the driver format and Pa_IsFormatSupported also accepts formats it converts,
+// so this is an assumption per host api, not a probe. the device may still run another format internally
+static PaSampleFormat guess_native_sample_format(PaDeviceIndex p_device_index) {
+    const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo(p_device_index);
+    if (pa_device_info == nullptr) {
+        return 0;
+    }
+    const PaHostApiInfo *pa_api_info = Pa_GetHostApiInfo(pa_device_info->hostApi);
+    if (pa_api_info == nullptr) {
+        return 0;
+    }
+    switch (pa_api_info->type) {
+        case paCoreAudio:
+        case paJACK:
+        case paWASAPI:
+            return paFloat32;
+        case paASIO:
+        case paWDMKS:
+            return paInt32;
+        case paMME:
+        case paDirectSound:
+        case paALSA:
+        case paOSS:
+            return paInt16;
+        default:
+            return paFloat32;
+    }
+}
+
+static bool is_native_sample_format(PaDeviceIndex p_device_index, PaSampleFormat p_sample_format) {
+    return guess_native_sample_format(p_device_index) == (p_sample_format & ~paNonInterleaved);
+}
+
+static const PaSampleFormat probe_sample_formats[] = { paFloat32, paInt32, paInt24, paInt16, paInt8, paUInt8 };
+static const double probe_sample_rates[] = { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000 };
+
+static bool is_format_supported_on(PaDeviceIndex p_device_index, bool p_output, int p_channel_count, PaSampleFormat p_sample_format, double p_sample_rate) {
+    PaStreamParameters parameters = { p_device_index, p_channel_count, p_sample_format, 0, nullptr };
+    return Pa_IsFormatSupported(p_output ? nullptr : &parameters, p_output ? &parameters : nullptr, p_sample_rate) == paFormatIsSupported;
+}
+
+// assumed native format first, then the formats portaudio converts most cheaply
+static PaSampleFormat negotiate_sample_format(PaDeviceIndex p_device_index, bool p_output, int p_channel_count, double p_sample_rate) {
+    const PaSampleFormat candidates[] = { guess_native_sample_format(p_device_index), paFloat32, paInt32, paInt24, paInt16 };
+    for (PaSampleFormat candidate : candidates) {
+        if (candidate != 0 && is_format_supported_on(p_device_index, p_output, p_channel_count, candidate, p_sample_rate)) {
+            return candidate;
+        }
+    }
+    return 0;
+}
+
+// returns the channel count the callback works with, the device channel count without routing
+static int setup_channel_routing(CallbackUserDataGdBinding *p_user_data, Ref<PortAudioStreamParameter> p_parameter,
+                                 int p_device_channel_count, PaSampleFormat p_sample_format, bool p_output,
+                                 unsigned int p_frames_per_buffer) {
+    Ref<PortAudioChannelRouting> routing = p_parameter->get_channel_routing();
+    if (routing.is_null()) {
+        return p_device_channel_count;
+    }
+    if (p_sample_format != paFloat32) {
+        print_line("PortAudio::setup_channel_routing: channel routing requires FLOAT_32 - routing ignored");
+        return p_device_channel_count;
+    }
+    PortAudioChannelRouter *router = p_output ? routing->create_output_router(p_device_channel_count)
+                                              : routing->create_input_router(p_device_channel_count);
+    if (!router) {
+        print_line("PortAudio::setup_channel_routing: no valid routes - routing ignored");
+        return p_device_channel_count;
+    }
+    if (p_output) {
+        p_user_data->output_router = router;
+        p_user_data->output_routing_buffer.resize(p_frames_per_buffer * router->get_source_channel_count());
+        return router->get_source_channel_count();
+    }
+    p_user_data->input_router = router;
+    p_user_data->input_routing_buffer.resize(p_frames_per_buffer * router->get_destination_channel_count());
+    return router->get_destination_channel_count();
+}
+
+static void setup_output_processors(CallbackUserDataGdBinding *p_user_data, Ref<PortAudioStream> p_stream,
+                                    PortAudioStreamParameter::PortAudioSampleFormat p_sample_format) {
+    if (p_user_data->output_channel_count <= 0) {
+        return;
+    }
+    p_user_data->scheduler_supported = p_sample_format == PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32;
+    Ref<PortAudioGraph> graph = p_stream->get_graph();
+    if (graph.is_valid()) {
+        if (p_sample_format != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+            print_line("PortAudio::setup_output_processors: graph requires FLOAT_32 output - graph ignored");
+        } else if (graph->prepare(p_user_data->output_channel_count, p_stream->get_sample_rate())) {
+            p_user_data->graph = graph;
+        }
+    }
+    Ref<PortAudioConvolver> convolver = p_stream->get_convolver();
+    if (convolver.is_valid()) {
+        if (p_sample_format != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+            print_line("PortAudio::setup_output_processors: convolver requires FLOAT_32 output - convolver ignored");
+        } else if (convolver->prepare(p_user_data->output_channel_count, p_stream->get_sample_rate())) {
+            p_user_data->convolver = convolver;
+        }
+    }
+    Ref<PortAudioJitterBuffer> jitter_buffer = p_stream->get_jitter_buffer();
+    if (jitter_buffer.is_valid()) {
+        if (p_sample_format != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+            print_line("PortAudio::setup_output_processors: jitter buffer requires FLOAT_32 output - jitter buffer ignored");
+        } else if (jitter_buffer->prepare(p_user_data->output_channel_count, p_stream->get_sample_rate())) {
+            p_user_data->jitter_buffer = jitter_buffer;
+        }
+    }
+    Ref<PortAudioLimiter> limiter = p_stream->get_limiter();
+    if (limiter.is_valid()) {
+        if (p_sample_format != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+            print_line("PortAudio::setup_output_processors: limiter requires FLOAT_32 output - limiter ignored");
+        } else if (limiter->prepare(p_user_data->output_device_channel_count, p_stream->get_sample_rate())) {
+            p_user_data->limiter = limiter;
+        }
+    }
+}
+
+// the gate replaces the script call with a native check, it needs float input and no output to keep filling
+static void setup_voice_gate(CallbackUserDataGdBinding *p_user_data, Ref<PortAudioStream> p_stream, PaSampleFormat p_sample_format) {
+    Ref<PortAudioVoiceGate> voice_gate = p_stream->get_voice_gate();
+    if (voice_gate.is_null()) {
+        return;
+    }
+    if (p_sample_format != paFloat32) {
+        print_line("PortAudio::setup_voice_gate: voice gate requires FLOAT_32 input - voice gate ignored");
+        return;
+    }
+    if (p_stream->get_output_channel_count() > 0) {
+        print_line("PortAudio::setup_voice_gate: voice gate requires an input only stream - voice gate ignored");
+        return;
+    }
+    if (!voice_gate->prepare(p_user_data->input_channel_count, p_stream->get_sample_rate())) {
+        return;
+    }
+    p_user_data->voice_gate = voice_gate;
+    size_t pre_roll_samples = (size_t) voice_gate->get_pre_roll_capacity() * p_user_data->input_channel_count;
+    p_user_data->pre_roll_scratch.resize(MAX(pre_roll_samples, (size_t) 1));
+    Ref<StreamPeerBuffer> pre_roll_buffer;
+    pre_roll_buffer.instantiate();
+    pre_roll_buffer->resize(pre_roll_samples * sizeof(float));
+    p_user_data->audio_callback_data->set_pre_roll_buffer(pre_roll_buffer);
+}
+
+static void setup_input_processors(CallbackUserDataGdBinding *p_user_data, Ref<PortAudioStream> p_stream,
+                                   PaSampleFormat p_sample_format) {
+    // conditioning runs on the logical channels after routing, everything after it sees the conditioned input
+    Ref<PortAudioInputConditioning> conditioning = p_stream->get_input_stream_parameter()->get_conditioning();
+    if (conditioning.is_valid()) {
+        if (p_sample_format != paFloat32) {
+            print_line("PortAudio::setup_input_processors: conditioning requires FLOAT_32 input - conditioning ignored");
+        } else {
+            p_user_data->input_conditioner = conditioning->create_conditioner(p_user_data->input_channel_count, p_stream->get_sample_rate());
+            p_user_data->input_conditioning_buffer.resize(p_stream->get_frames_per_buffer() * p_user_data->input_channel_count);
+        }
+    }
+    Ref<PortAudioBroadcast> broadcast = p_stream->get_broadcast();
+    if (broadcast.is_valid() &&
+        broadcast->prepare(p_user_data->input_channel_count * p_user_data->input_sample_size, p_user_data->input_channel_count, p_stream->get_sample_rate())) {
+        p_user_data->broadcast = broadcast;
+    }
+    setup_voice_gate(p_user_data, p_stream, p_sample_format);
+}
+
+// substituting the last good buffer needs interleaved float frames on the device side
+static void setup_watchdog(CallbackUserDataGdBinding *p_user_data, Ref<PortAudioStream> p_stream, bool p_float_output) {
+    Ref<PortAudioWatchdog> watchdog = p_stream->get_watchdog();
+    if (watchdog.is_null()) {
+        return;
+    }
+    bool can_substitute = p_float_output && p_user_data->output_device_channel_count > 0 && !p_user_data->output_non_interleaved;
+    if (p_user_data->output_device_channel_count > 0 && !can_substitute &&
+        watchdog->get_degrade_mode() != PortAudioWatchdog::DEGRADE_SKIP_PROCESSORS) {
+        print_line("PortAudio::setup_watchdog: substitute buffers require interleaved FLOAT_32 output - degrading to silence");
+    }
+    if (watchdog->prepare(p_stream->get_sample_rate(), p_user_data->output_device_channel_count,
+                          p_stream->get_frames_per_buffer(), can_substitute)) {
+        p_user_data->watchdog = watchdog;
+    }
+}
+
+static void release_processors(CallbackUserDataGdBinding *p_user_data) {
+    PortAudioScheduler *scheduler = p_user_data->scheduler.exchange(nullptr);
+    if (scheduler) {
+        delete scheduler;
+    }
+    if (p_user_data->graph.is_valid()) {
+        p_user_data->graph->release();
+        p_user_data->graph = Ref<PortAudioGraph>();
+    }
+    if (p_user_data->convolver.is_valid()) {
+        p_user_data->convolver->release();
+        p_user_data->convolver = Ref<PortAudioConvolver>();
+    }
+    if (p_user_data->voice_gate.is_valid()) {
+        p_user_data->voice_gate->release();
+        p_user_data->voice_gate = Ref<PortAudioVoiceGate>();
+    }
+    if (p_user_data->watchdog.is_valid()) {
+        p_user_data->watchdog->release();
+        p_user_data->watchdog = Ref<PortAudioWatchdog>();
+    }
+    if (p_user_data->jitter_buffer.is_valid()) {
+        p_user_data->jitter_buffer->release();
+        p_user_data->jitter_buffer = Ref<PortAudioJitterBuffer>();
+    }
+    if (p_user_data->broadcast.is_valid()) {
+        p_user_data->broadcast->release();
+        p_user_data->broadcast = Ref<PortAudioBroadcast>();
+    }
+    if (p_user_data->limiter.is_valid()) {
+        p_user_data->limiter->release();
+        p_user_data->limiter = Ref<PortAudioLimiter>();
+    }
+    if (p_user_data->render_ahead) {
+        // the node frees its ring buffer on the main thread
+        p_user_data->render_ahead->detach();
+        p_user_data->render_ahead = nullptr;
+    }
+}
+
+static Dictionary device_info_to_dictionary(const PaDeviceInfo *p_device_info) {
+    Dictionary device_info;
+    device_info["struct_version"] = p_device_info->structVersion;
+    device_info["name"] = String(p_device_info->name);
+    device_info["host_api"] = p_device_info->hostApi;
+    device_info["max_input_channels"] = p_device_info->maxInputChannels;
+    device_info["max_output_channels"] = p_device_info->maxOutputChannels;
+    device_info["default_low_input_latency"] = p_device_info->defaultLowInputLatency;
+    device_info["default_low_output_latency"] = p_device_info->defaultLowOutputLatency;
+    device_info["default_high_input_latency"] = p_device_info->defaultHighInputLatency;
+    device_info["default_high_output_latency"] = p_device_info->defaultHighOutputLatency;
+    device_info["default_sample_rate"] = p_device_info->defaultSampleRate;
+    return device_info;
+}
+
+class WorkerPoolBenchmark {
+public:
+    float *buffer;
+    int frames;
+
+    static void process_channel(void *p_user_data, int p_channel) {
+        WorkerPoolBenchmark *benchmark = (WorkerPoolBenchmark *) p_user_data;
+        float *samples = benchmark->buffer + (size_t) p_channel * benchmark->frames;
+        // a cascade of biquads roughly resembles a per-channel effect chain
+        for (int stage = 0; stage < 16; stage++) {
+            float z1 = 0;
+            float z2 = 0;
+            for (int i = 0; i < benchmark->frames; i++) {
+                float x = samples[i];
+                float y = 0.2929f * x + z1;
+                z1 = 0.5858f * x + z2;
+                z2 = 0.2929f * x - 0.1716f * y;
+                samples[i] = y;
+            }
+        }
+    }
+};
+
 #pragma endregion IMP_DETAILS
 
 PortAudio *PortAudio::singleton = NULL;
@@ -293,99 +1137,508 @@ String PortAudio::get_error_text(PortAudio::PortAudioError p_error) {
             return "STREAM_NOT_FOUND";
         case STREAM_USER_DATA_NOT_FOUND:
             return "STREAM_USER_DATA_NOT_FOUND";
+        case INVALID_RENDER_AHEAD:
+            return "INVALID_RENDER_AHEAD";
+        case SCHEDULE_QUEUE_FULL:
+            return "SCHEDULE_QUEUE_FULL";
+        case MEASUREMENT_FAILED:
+            return "MEASUREMENT_FAILED";
+        case TRACE_FAILED:
+            return "TRACE_FAILED";
+        case PUBLISH_FAILED:
+            return "PUBLISH_FAILED";
+        case RECORD_FAILED:
+            return "RECORD_FAILED";
+        case RECONFIGURE_FAILED:
+            return "RECONFIGURE_FAILED";
+        case INVALID_SCHEDULE_EVENT:
+            return "INVALID_SCHEDULE_EVENT";
     }
     return String(Pa_GetErrorText(p_error));
 }
 
 PortAudio::PortAudioError PortAudio::initialize() {
+    // every entry point that needs the host apis calls this, the scan only happens once
+    if (initialized.load(std::memory_order_acquire)) {
+        return PortAudioError::NO_ERROR;
+    }
+    MutexLock lock(initialize_mutex);
+    if (initialized.load(std::memory_order_relaxed)) {
+        return PortAudioError::NO_ERROR;
+    }
+    RWLockWrite device_write_lock(device_lock);
+    uint64_t start_usec = OS::get_singleton()->get_ticks_usec();
     PaError err = Pa_Initialize();
-    return get_error(err);
+    if (err != paNoError) {
+        return get_error(err);
+    }
+    snapshot_devices();
+    print_verbose(vformat("PortAudio::initialize: %d devices found in %d ms", devices.size(), (OS::get_singleton()->get_ticks_usec() - start_usec) / 1000));
+    initialized.store(true, std::memory_order_release);
+    return PortAudioError::NO_ERROR;
 }
 
-PortAudio::PortAudioError PortAudio::terminate() {
-    PaError err = Pa_Terminate();
-    return get_error(err);
+void PortAudio::initialize_async() {
+    if (initialized.load(std::memory_order_acquire)) {
+        call_deferred("emit_signal", "initialized", PortAudioError::NO_ERROR);
+        return;
+    }
+    bool expected = false;
+    if (!initializing.compare_exchange_strong(expected, true)) {
+        // already scanning, the pending signal covers this call as well
+        return;
+    }
+    if (initialize_thread.is_started()) {
+        initialize_thread.wait_to_finish();
+    }
+    initialize_thread.start(&PortAudio::initialize_thread_main, this);
 }
 
-int PortAudio::get_host_api_count() {
-    return Pa_GetHostApiCount();
+bool PortAudio::is_initialized() {
+    return initialized.load(std::memory_order_acquire);
 }
 
-int PortAudio::get_default_host_api() {
-    return Pa_GetDefaultHostApi();
+void PortAudio::initialize_thread_main(void *p_port_audio) {
+    PortAudio *port_audio = (PortAudio *) p_port_audio;
+    PortAudioError err = port_audio->initialize();
+    port_audio->initializing.store(false);
+    port_audio->call_deferred("emit_signal", "initialized", err);
 }
 
-Dictionary PortAudio::get_host_api_info(int p_host_api) {
-    const PaHostApiInfo *pa_api_info = Pa_GetHostApiInfo(p_host_api);
-    if (pa_api_info == NULL) {
-        // TODO error
-    }
-    Dictionary api_info;
-    api_info["struct_version"] = pa_api_info->structVersion;
-    api_info["type"] = (int) pa_api_info->type; // TODO enum
-    api_info["name"] = String(pa_api_info->name);
-    api_info["device_count"] = pa_api_info->deviceCount;
-    api_info["default_input_device"] = pa_api_info->defaultInputDevice;
-    api_info["default_output_device"] = pa_api_info->defaultOutputDevice;
-    return api_info;
+PortAudio::PortAudioError PortAudio::from_pa_error(int p_pa_error) {
+    return get_error((PaError) p_pa_error);
 }
 
-int PortAudio::host_api_type_id_to_host_api_index(int p_host_api_type_id) {
-    return Pa_HostApiTypeIdToHostApiIndex((PaHostApiTypeId) p_host_api_type_id);
+void PortAudio::register_aggregate_stream() {
+    // under lifecycle_mutex, a rescan that already checked for open streams has to finish first
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    MutexLock lock(data_map_mutex);
+    open_aggregate_streams++;
 }
 
-int PortAudio::host_api_device_index_to_device_index(int p_host_api, int p_host_api_device_index) {
-    return Pa_HostApiDeviceIndexToDeviceIndex(p_host_api, p_host_api_device_index);
+void PortAudio::unregister_aggregate_stream() {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    MutexLock lock(data_map_mutex);
+    open_aggregate_streams--;
 }
 
-Dictionary PortAudio::get_last_host_error_info() {
-    const PaHostErrorInfo *pa_host_error_info = Pa_GetLastHostErrorInfo();
-    if (pa_host_error_info == NULL) {
-        // TODO error
-        return Dictionary();
+PortAudio::PortAudioError PortAudio::terminate() {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    MutexLock lock(initialize_mutex);
+    if (!initialized.load(std::memory_order_relaxed)) {
+        return PortAudioError::NO_ERROR;
     }
-    Dictionary host_error_info;
-    host_error_info["host_api_type"] = (int) pa_host_error_info->hostApiType;
-    host_error_info["error_code"] = (int64_t) pa_host_error_info->errorCode;
-    host_error_info["error_text"] = String(pa_host_error_info->errorText);
-    return host_error_info;
+    {
+        // the member streams of an aggregate would be freed under it
+        MutexLock data_map_lock(data_map_mutex);
+        if (open_aggregate_streams > 0) {
+            print_line(vformat("PortAudio::terminate: %d aggregate streams are still open", open_aggregate_streams));
+            return PortAudioError::STREAM_IS_NOT_STOPPED;
+        }
+    }
+    RWLockWrite device_write_lock(device_lock);
+    PaError err = Pa_Terminate();
+    initialized.store(false, std::memory_order_release);
+    devices.clear();
+    default_input_device_id = String();
+    default_output_device_id = String();
+    return get_error(err);
 }
 
-int PortAudio::get_device_count() {
+void PortAudio::snapshot_devices() {
+    // ids are built from host api and device name so they survive a rescan, indices do not
+    devices.clear();
+    {
+        MutexLock lock(device_format_cache_mutex);
+        device_format_cache.clear();
+    }
+    std::map<String, int> occurrences;
+    int device_count = Pa_GetDeviceCount();
+    for (int i = 0; i < device_count; i++) {
+        const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo(i);
+        if (pa_device_info == nullptr) {
+            continue;
+        }
+        const PaHostApiInfo *pa_api_info = Pa_GetHostApiInfo(pa_device_info->hostApi);
+        String base_id = String(pa_api_info ? pa_api_info->name : "") + "/" + String(pa_device_info->name);
+        int occurrence = occurrences[base_id]++;
+        DeviceEntry entry;
+        entry.id = occurrence > 0 ? base_id + "#" + itos(occurrence) : base_id;
+        entry.index = i;
+        entry.info = device_info_to_dictionary(pa_device_info);
+        entry.info["device_id"] = entry.id;
+        devices.push_back(entry);
+    }
+    default_input_device_id = get_device_id_locked(Pa_GetDefaultInputDevice());
+    default_output_device_id = get_device_id_locked(Pa_GetDefaultOutputDevice());
+}
+
+String PortAudio::get_device_id_locked(int p_device_index) {
+    for (int i = 0; i < devices.size(); i++) {
+        if (devices[i].index == p_device_index) {
+            return devices[i].id;
+        }
+    }
+    return String();
+}
+
+bool PortAudio::rescan_devices() {
+    Vector<DeviceEntry> previous;
+    String previous_default_input;
+    String previous_default_output;
+    Vector<DeviceEntry> current;
+    String current_default_input;
+    String current_default_output;
+    {
+        // terminating the library invalidates every stream, only rescan while none is open
+        lifecycle_mutex.lock();
+        bool streams_open;
+        {
+            MutexLock lock(data_map_mutex);
+            streams_open = !data_map.empty() || open_aggregate_streams > 0;
+        }
+        if (streams_open) {
+            lifecycle_mutex.unlock();
+            return false;
+        }
+        // an open from here on waits in initialize() for the rescan, lifecycle_mutex is not held across it
+        MutexLock init_lock(initialize_mutex);
+        bool was_initialized = initialized.exchange(false, std::memory_order_acq_rel);
+        lifecycle_mutex.unlock();
+        RWLockWrite device_write_lock(device_lock);
+        previous = devices;
+        previous_default_input = default_input_device_id;
+        previous_default_output = default_output_device_id;
+        if (was_initialized) {
+            Pa_Terminate();
+        }
+        PaError err = Pa_Initialize();
+        initialized.store(err == paNoError, std::memory_order_release);
+        if (err == paNoError) {
+            snapshot_devices();
+        } else {
+            print_line(vformat("PortAudio::rescan_devices: failed to initialize (%d)", err));
+            devices.clear();
+            default_input_device_id = String();
+            default_output_device_id = String();
+        }
+        current = devices;
+        current_default_input = default_input_device_id;
+        current_default_output = default_output_device_id;
+    }
+
+    for (int i = 0; i < current.size(); i++) {
+        bool found = false;
+        for (int j = 0; j < previous.size() && !found; j++) {
+            found = previous[j].id == current[i].id;
+        }
+        if (!found) {
+            call_deferred("emit_signal", "device_added", current[i].id, current[i].info);
+        }
+    }
+    for (int i = 0; i < previous.size(); i++) {
+        bool found = false;
+        for (int j = 0; j < current.size() && !found; j++) {
+            found = current[j].id == previous[i].id;
+        }
+        if (!found) {
+            call_deferred("emit_signal", "device_removed", previous[i].id);
+        }
+    }
+    if (current_default_input != previous_default_input || current_default_output != previous_default_output) {
+        call_deferred("emit_signal", "default_device_changed", current_default_input, current_default_output);
+    }
+    return true;
+}
+
+PortAudio::PortAudioError PortAudio::start_device_monitor(double p_interval) {
+    ERR_FAIL_COND_V(p_interval <= 0, PortAudioError::UNDEFINED);
+    device_monitor_interval_usec.store((uint64_t) (p_interval * 1000000.0));
+    if (device_monitor_thread.is_started()) {
+        return PortAudioError::NO_ERROR;
+    }
+    device_monitor_exit.store(false);
+    device_monitor_thread.start(&PortAudio::device_monitor_main, this);
+    return PortAudioError::NO_ERROR;
+}
+
+void PortAudio::stop_device_monitor() {
+    if (!device_monitor_thread.is_started()) {
+        return;
+    }
+    device_monitor_exit.store(true);
+    device_monitor_thread.wait_to_finish();
+}
+
+bool PortAudio::is_device_monitor_running() {
+    return device_monitor_thread.is_started();
+}
+
+void PortAudio::device_monitor_main(void *p_port_audio) {
+    PortAudio *port_audio = (PortAudio *) p_port_audio;
+    // the first scan happens here instead of on the main thread
+    port_audio->initialize();
+    String last_token = PortAudioDeviceChanges::get_token();
+    if (last_token.is_empty()) {
+        print_line("PortAudio::device_monitor_main: no device change notification on this platform - devices are only scanned once");
+    }
+    bool pending = false;
+    while (!port_audio->device_monitor_exit.load()) {
+        uint64_t wait_usec = port_audio->device_monitor_interval_usec.load();
+        for (uint64_t waited_usec = 0; waited_usec < wait_usec && !port_audio->device_monitor_exit.load(); waited_usec += 20000) {
+            OS::get_singleton()->delay_usec(20000);
+        }
+        if (port_audio->device_monitor_exit.load()) {
+            break;
+        }
+        String token = PortAudioDeviceChanges::get_token();
+        if (token == last_token && !pending) {
+            continue;
+        }
+        // a change seen while streams are open is picked up once the last one is closed
+        pending = !port_audio->rescan_devices();
+        last_token = token;
+    }
+}
+
+String PortAudio::get_device_id(int p_device_index) {
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return String();
+    }
+    RWLockRead device_read_lock(device_lock);
+    return get_device_id_locked(p_device_index);
+}
+
+int PortAudio::get_device_index(const String &p_device_id) {
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return paNoDevice;
+    }
+    RWLockRead device_read_lock(device_lock);
+    for (int i = 0; i < devices.size(); i++) {
+        if (devices[i].id == p_device_id) {
+            return devices[i].index;
+        }
+    }
+    return paNoDevice;
+}
+
+Array PortAudio::get_devices() {
+    Array result;
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return result;
+    }
+    RWLockRead device_read_lock(device_lock);
+    for (int i = 0; i < devices.size(); i++) {
+        Dictionary device_info = devices[i].info.duplicate();
+        device_info["index"] = devices[i].index;
+        result.push_back(device_info);
+    }
+    return result;
+}
+
+int PortAudio::get_host_api_count() {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
+    return Pa_GetHostApiCount();
+}
+
+int PortAudio::get_default_host_api() {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
+    return Pa_GetDefaultHostApi();
+}
+
+Dictionary PortAudio::get_host_api_info(int p_host_api) {
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return Dictionary();
+    }
+    RWLockRead device_read_lock(device_lock);
+    const PaHostApiInfo *pa_api_info = Pa_GetHostApiInfo(p_host_api);
+    if (pa_api_info == NULL) {
+        // TODO error
+        return Dictionary();
+    }
+    Dictionary api_info;
+    api_info["struct_version"] = pa_api_info->structVersion;
+    api_info["type"] = (int) pa_api_info->type; // TODO enum
+    api_info["name"] = String(pa_api_info->name);
+    api_info["device_count"] = pa_api_info->deviceCount;
+    api_info["default_input_device"] = pa_api_info->defaultInputDevice;
+    api_info["default_output_device"] = pa_api_info->defaultOutputDevice;
+    return api_info;
+}
+
+int PortAudio::host_api_type_id_to_host_api_index(int p_host_api_type_id) {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
+    return Pa_HostApiTypeIdToHostApiIndex((PaHostApiTypeId) p_host_api_type_id);
+}
+
+int PortAudio::host_api_device_index_to_device_index(int p_host_api, int p_host_api_device_index) {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
+    return Pa_HostApiDeviceIndexToDeviceIndex(p_host_api, p_host_api_device_index);
+}
+
+Dictionary PortAudio::get_last_host_error_info() {
+    const PaHostErrorInfo *pa_host_error_info = Pa_GetLastHostErrorInfo();
+    if (pa_host_error_info == NULL) {
+        // TODO error
+        return Dictionary();
+    }
+    Dictionary host_error_info;
+    host_error_info["host_api_type"] = (int) pa_host_error_info->hostApiType;
+    host_error_info["error_code"] = (int64_t) pa_host_error_info->errorCode;
+    host_error_info["error_text"] = String(pa_host_error_info->errorText);
+    return host_error_info;
+}
+
+int PortAudio::get_device_count() {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
     return Pa_GetDeviceCount();
 }
 
 int PortAudio::get_default_input_device() {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
     return Pa_GetDefaultInputDevice();
 }
 
 int PortAudio::get_default_output_device() {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
     return Pa_GetDefaultOutputDevice();
 }
 
 Dictionary PortAudio::get_device_info(int p_device_index) {
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return Dictionary();
+    }
+    RWLockRead device_read_lock(device_lock);
     const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo((PaDeviceIndex) p_device_index);
     if (pa_device_info == NULL) {
         // TODO error
         return Dictionary();
     }
-    Dictionary device_info;
-    device_info["struct_version"] = pa_device_info->structVersion;
-    device_info["name"] = String(pa_device_info->name);
-    device_info["host_api"] = pa_device_info->hostApi;
-    device_info["max_input_channels"] = pa_device_info->maxInputChannels;
-    device_info["max_output_channels"] = pa_device_info->maxOutputChannels;
-    device_info["default_low_input_latency"] = pa_device_info->defaultLowInputLatency;
-    device_info["default_low_output_latency"] = pa_device_info->defaultLowOutputLatency;
-    device_info["default_high_input_latency"] = pa_device_info->defaultHighInputLatency;
-    device_info["default_high_output_latency"] = pa_device_info->defaultHighOutputLatency;
-    device_info["default_sample_rate"] = pa_device_info->defaultSampleRate;
+    Dictionary device_info = device_info_to_dictionary(pa_device_info);
+    device_info["device_id"] = get_device_id_locked(p_device_index);
     return device_info;
 }
 
+Dictionary PortAudio::get_device_formats(int p_device_index) {
+    if (initialize() != PortAudioError::NO_ERROR) {
+        return Dictionary();
+    }
+    RWLockRead device_read_lock(device_lock);
+    String device_id = get_device_id_locked(p_device_index);
+    {
+        MutexLock lock(device_format_cache_mutex);
+        std::map<String, Dictionary>::iterator it = device_format_cache.find(device_id);
+        if (it != device_format_cache.end()) {
+            return it->second;
+        }
+    }
+    const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo((PaDeviceIndex) p_device_index);
+    if (pa_device_info == nullptr) {
+        return Dictionary();
+    }
+    // probing opens the device on some host apis, each device is only probed once per scan
+    Dictionary formats;
+    formats["device_id"] = device_id;
+    // not probed, see guess_native_sample_format
+    formats["assumed_native_sample_format"] = (int64_t) guess_native_sample_format(p_device_index);
+    formats["max_input_channels"] = pa_device_info->maxInputChannels;
+    formats["max_output_channels"] = pa_device_info->maxOutputChannels;
+    for (int output = 0; output < 2; output++) {
+        int channel_count = MIN(output ? pa_device_info->maxOutputChannels : pa_device_info->maxInputChannels, 2);
+        Array sample_formats;
+        Array sample_rates;
+        if (channel_count > 0) {
+            for (PaSampleFormat sample_format : probe_sample_formats) {
+                if (is_format_supported_on(p_device_index, output, channel_count, sample_format, pa_device_info->defaultSampleRate)) {
+                    sample_formats.push_back((int64_t) sample_format);
+                }
+            }
+            PaSampleFormat rate_format = sample_formats.is_empty() ? paFloat32 : (PaSampleFormat) (int64_t) sample_formats[0];
+            for (double sample_rate : probe_sample_rates) {
+                if (is_format_supported_on(p_device_index, output, channel_count, rate_format, sample_rate)) {
+                    sample_rates.push_back(sample_rate);
+                }
+            }
+        }
+        formats[output ? "output_sample_formats" : "input_sample_formats"] = sample_formats;
+        formats[output ? "output_sample_rates" : "input_sample_rates"] = sample_rates;
+    }
+    if (!device_id.is_empty()) {
+        MutexLock lock(device_format_cache_mutex);
+        device_format_cache[device_id] = formats;
+    }
+    return formats;
+}
+
+PortAudio::PortAudioError PortAudio::negotiate_stream_format(Ref<PortAudioStream> p_stream) {
+    ERR_FAIL_COND_V(p_stream.is_null(), PortAudioError::BAD_STREAM_PTR);
+    PortAudioError init_err = initialize();
+    if (init_err != PortAudioError::NO_ERROR) {
+        return init_err;
+    }
+    RWLockRead device_read_lock(device_lock);
+    Ref<PortAudioStreamParameter> parameters[2] = { p_stream->get_input_stream_parameter(), p_stream->get_output_stream_parameter() };
+    for (int output = 0; output < 2; output++) {
+        Ref<PortAudioStreamParameter> parameter = parameters[output];
+        if (parameter.is_null() || parameter->get_channel_count() <= 0) {
+            continue;
+        }
+        // the native stages only run on float buffers, converting once is cheaper than losing them
+        bool needs_float = parameter->get_channel_routing().is_valid() || (!output && parameter->get_conditioning().is_valid()) ||
+                           (output && (p_stream->get_graph().is_valid() || p_stream->get_convolver().is_valid() ||
+                                      p_stream->get_jitter_buffer().is_valid() || p_stream->get_limiter().is_valid()));
+        // only the sample type is negotiated, the layout the script asked for is kept
+        uint32_t non_interleaved = parameter->get_sample_format() & PortAudioStreamParameter::PortAudioSampleFormat::NON_INTERLEAVED;
+        if (needs_float) {
+            print_line("PortAudio::negotiate_stream_format: routing or native output stages in use - keeping FLOAT_32");
+            parameter->set_sample_format((PortAudioStreamParameter::PortAudioSampleFormat) (PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32 | non_interleaved));
+            continue;
+        }
+        PaSampleFormat sample_format = negotiate_sample_format(parameter->get_device_index(), output, parameter->get_channel_count(), p_stream->get_sample_rate());
+        if (sample_format == 0) {
+            return PortAudioError::SAMPLE_FORMAT_NOT_SUPPORTED;
+        }
+        parameter->set_sample_format((PortAudioStreamParameter::PortAudioSampleFormat) (sample_format | non_interleaved));
+    }
+    return PortAudioError::NO_ERROR;
+}
+
 PortAudio::PortAudioError PortAudio::is_format_supported(Ref<PortAudioStreamParameter> p_input_stream_parameter,
                                                          Ref<PortAudioStreamParameter> p_output_stream_parameter,
                                                          double p_sample_rate) {
+    PortAudioError init_err = initialize();
+    if (init_err != PortAudioError::NO_ERROR) {
+        return init_err;
+    }
+    RWLockRead device_read_lock(device_lock);
     const PaStreamParameters pa_input_parameter = {
             p_input_stream_parameter->get_device_index(),
             p_input_stream_parameter->get_channel_count(),
@@ -409,48 +1662,86 @@ PortAudio::open_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback,
     if (p_audio_callback.is_null()) {
         return PortAudio::PortAudioError::INVALID_FUNC_REF;
     }
+    // a warm stream is already running, only the callback has to be bound
+    if (bind_warm_stream(p_stream, p_audio_callback, p_user_data)) {
+        return PortAudio::PortAudioError::NO_ERROR;
+    }
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    return open_stream_internal(p_stream, p_audio_callback, p_user_data, false);
+}
 
+PortAudio::PortAudioError
+PortAudio::open_stream_internal(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data, bool p_warm) {
+    PortAudioError init_err = initialize();
+    if (init_err != PortAudioError::NO_ERROR) {
+        return init_err;
+    }
     CallbackUserDataGdBinding *user_data = new CallbackUserDataGdBinding();
     user_data->port_audio = this;
     user_data->audio_callback = p_audio_callback;
+    user_data->stream = p_stream;
+    user_data->clock = p_stream->get_clock();
+    user_data->clock->reset(p_stream->get_sample_rate());
     user_data->audio_callback_data.instantiate();
     user_data->audio_callback_data->set_user_data(p_user_data);
+    if (p_warm) {
+        user_data->warm = true;
+        user_data->pool_state.store(POOL_PARKED);
+    }
 
+    PaStreamParameters pa_input_parameter;
     const PaStreamParameters *pa_input_parameter_ptr = nullptr;
     Ref<PortAudioStreamParameter> input_parameter = p_stream->get_input_stream_parameter();
     if (input_parameter.is_valid()) {
         PaSampleFormat pa_sample_format = get_sample_format(input_parameter->get_sample_format());
         PaError sample_size = Pa_GetSampleSize(pa_sample_format);
         if (sample_size <= 0) {
+            release_processors(user_data);
+            delete user_data;
             return get_error(sample_size);
         }
-        user_data->input_channel_count = input_parameter->get_channel_count();
+        user_data->input_device_channel_count = input_parameter->get_channel_count();
+        user_data->input_channel_count = setup_channel_routing(user_data, input_parameter, input_parameter->get_channel_count(),
+                                                               pa_sample_format, false, p_stream->get_frames_per_buffer());
         user_data->input_sample_size = (int) sample_size;
-        const PaStreamParameters pa_input_parameter = {
+        user_data->input_non_interleaved = (pa_sample_format & paNonInterleaved) != 0;
+        user_data->input_native_format = is_native_sample_format(input_parameter->get_device_index(), pa_sample_format);
+        pa_input_parameter = {
                 input_parameter->get_device_index(),
                 input_parameter->get_channel_count(),
-                get_sample_format(input_parameter->get_sample_format()),
+                pa_sample_format,
                 input_parameter->get_suggested_latency(),
                 input_parameter->get_host_api_specific_stream_info(),
         };
         pa_input_parameter_ptr = &pa_input_parameter;
         Ref<StreamPeerBuffer> input_buffer;
         input_buffer.instantiate();
-        input_buffer->resize(p_stream->get_frames_per_buffer());
-        user_data->audio_callback_data->set_output_buffer(input_buffer);
+        input_buffer->resize(p_stream->get_frames_per_buffer() * user_data->input_channel_count * user_data->input_sample_size);
+        user_data->audio_callback_data->set_input_buffer(input_buffer);
+        if (user_data->input_non_interleaved) {
+            user_data->interleave_buffer.resize(input_buffer->get_size());
+        }
+        setup_input_processors(user_data, p_stream, pa_sample_format);
     }
 
+    PaStreamParameters pa_output_parameter;
     const PaStreamParameters *pa_output_parameter_ptr = nullptr;
     Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
     if (output_parameter.is_valid()) {
         PaSampleFormat pa_sample_format = get_sample_format(output_parameter->get_sample_format());
         PaError sample_size = Pa_GetSampleSize(pa_sample_format);
         if (sample_size <= 0) {
+            release_processors(user_data);
+            delete user_data;
             return get_error(sample_size);
         }
-        user_data->output_channel_count = output_parameter->get_channel_count();
+        user_data->output_device_channel_count = output_parameter->get_channel_count();
+        user_data->output_channel_count = setup_channel_routing(user_data, output_parameter, output_parameter->get_channel_count(),
+                                                                pa_sample_format, true, p_stream->get_frames_per_buffer());
         user_data->output_sample_size = (int) sample_size;
-        const PaStreamParameters pa_output_parameter = {
+        user_data->output_non_interleaved = (pa_sample_format & paNonInterleaved) != 0;
+        user_data->output_native_format = is_native_sample_format(output_parameter->get_device_index(), pa_sample_format);
+        pa_output_parameter = {
                 output_parameter->get_device_index(),
                 output_parameter->get_channel_count(),
                 pa_sample_format,
@@ -460,9 +1751,12 @@ PortAudio::open_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback,
         pa_output_parameter_ptr = &pa_output_parameter;
         Ref<StreamPeerBuffer> output_buffer;
         output_buffer.instantiate();
-        output_buffer->resize(p_stream->get_frames_per_buffer());
+        output_buffer->resize(p_stream->get_frames_per_buffer() * user_data->output_channel_count * user_data->output_sample_size);
         user_data->audio_callback_data->set_output_buffer(output_buffer);
+        setup_output_processors(user_data, p_stream, output_parameter->get_sample_format());
     }
+    setup_watchdog(user_data, p_stream, output_parameter.is_valid() &&
+                                                output_parameter->get_sample_format() == PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32);
 
     PaStream *stream;
     PaError err = Pa_OpenStream(&stream,
@@ -475,8 +1769,15 @@ PortAudio::open_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback,
                                 user_data);
     if (err == PaErrorCode::paNoError) {
         p_stream->set_stream(stream);
-        data_map.insert(std::pair<Ref<PortAudioStream>, void *>(p_stream, user_data));
+        {
+            MutexLock lock(data_map_mutex);
+            data_map.insert(std::pair<Ref<PortAudioStream>, void *>(p_stream, user_data));
+        }
+        if (user_data->watchdog.is_valid()) {
+            start_watchdog_monitor();
+        }
     } else {
+        release_processors(user_data);
         delete user_data;
     }
     return get_error(err);
@@ -488,12 +1789,14 @@ PortAudio::PortAudioError PortAudio::open_default_stream(Ref<PortAudioStream> p_
     if (p_audio_callback.is_null()) {
         return PortAudio::PortAudioError::INVALID_FUNC_REF;
     }
-
-    CallbackUserDataGdBinding *user_data = new CallbackUserDataGdBinding();
-    user_data->port_audio = this;
-    user_data->audio_callback = p_audio_callback;
-    user_data->audio_callback_data.instantiate();
-    user_data->audio_callback_data->set_user_data(p_user_data);
+    if (bind_warm_stream(p_stream, p_audio_callback, p_user_data)) {
+        return PortAudio::PortAudioError::NO_ERROR;
+    }
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    PortAudioError init_err = initialize();
+    if (init_err != PortAudioError::NO_ERROR) {
+        return init_err;
+    }
 
     PaSampleFormat pa_sample_format = get_sample_format(p_sample_format);
     PaError sample_size = Pa_GetSampleSize(pa_sample_format);
@@ -501,71 +1804,746 @@ PortAudio::PortAudioError PortAudio::open_default_stream(Ref<PortAudioStream> p_
         return get_error(sample_size);
     }
 
+    CallbackUserDataGdBinding *user_data = new CallbackUserDataGdBinding();
+    user_data->port_audio = this;
+    user_data->audio_callback = p_audio_callback;
+    user_data->stream = p_stream;
+    user_data->clock = p_stream->get_clock();
+    user_data->clock->reset(p_stream->get_sample_rate());
+    user_data->audio_callback_data.instantiate();
+    user_data->audio_callback_data->set_user_data(p_user_data);
+
     Ref<PortAudioStreamParameter> input_parameter = p_stream->get_input_stream_parameter();
     if (input_parameter.is_valid() && input_parameter->get_channel_count() > 0) {
         Ref<StreamPeerBuffer> input_buffer;
         input_buffer.instantiate();
-        input_buffer->resize(p_stream->get_frames_per_buffer());
-        user_data->audio_callback_data->set_input_buffer(input_buffer);
         user_data->input_sample_size = (int) sample_size;
-        user_data->input_channel_count = p_stream->get_input_channel_count();
+        user_data->input_device_channel_count = p_stream->get_input_channel_count();
+        user_data->input_channel_count = setup_channel_routing(user_data, input_parameter, p_stream->get_input_channel_count(),
+                                                               pa_sample_format, false, p_stream->get_frames_per_buffer());
+        user_data->input_non_interleaved = (pa_sample_format & paNonInterleaved) != 0;
+        user_data->input_native_format = is_native_sample_format(Pa_GetDefaultInputDevice(), pa_sample_format);
+        input_buffer->resize(p_stream->get_frames_per_buffer() * user_data->input_channel_count * user_data->input_sample_size);
+        user_data->audio_callback_data->set_input_buffer(input_buffer);
+        if (user_data->input_non_interleaved) {
+            user_data->interleave_buffer.resize(input_buffer->get_size());
+        }
         input_parameter->set_sample_format(p_sample_format);
+        setup_input_processors(user_data, p_stream, pa_sample_format);
+    }
+
+    Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
+    if (output_parameter.is_valid() && output_parameter->get_channel_count() > 0) {
+        Ref<StreamPeerBuffer> output_buffer;
+        output_buffer.instantiate();
+        user_data->output_sample_size = (int) sample_size;
+        user_data->output_device_channel_count = p_stream->get_output_channel_count();
+        user_data->output_channel_count = setup_channel_routing(user_data, output_parameter, p_stream->get_output_channel_count(),
+                                                                pa_sample_format, true, p_stream->get_frames_per_buffer());
+        user_data->output_non_interleaved = (pa_sample_format & paNonInterleaved) != 0;
+        user_data->output_native_format = is_native_sample_format(Pa_GetDefaultOutputDevice(), pa_sample_format);
+        output_buffer->resize(p_stream->get_frames_per_buffer() * user_data->output_channel_count * user_data->output_sample_size);
+        user_data->audio_callback_data->set_output_buffer(output_buffer);
+        output_parameter->set_sample_format(p_sample_format);
+        setup_output_processors(user_data, p_stream, p_sample_format);
+    }
+    setup_watchdog(user_data, p_stream, p_sample_format == PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32);
+
+    PaStream *stream;
+    PaError err = Pa_OpenDefaultStream(&stream,
+                                       p_stream->get_input_channel_count(),
+                                       p_stream->get_output_channel_count(),
+                                       pa_sample_format,
+                                       p_stream->get_sample_rate(),
+                                       p_stream->get_frames_per_buffer(),
+                                       &port_audio_callback_gd_binding_converter,
+                                       user_data);
+    if (err == PaErrorCode::paNoError) {
+        p_stream->set_stream(stream);
+        {
+            MutexLock lock(data_map_mutex);
+            data_map.insert(std::pair<Ref<PortAudioStream>, void *>(p_stream, user_data));
+        }
+        if (user_data->watchdog.is_valid()) {
+            start_watchdog_monitor();
+        }
+    } else {
+        release_processors(user_data);
+        delete user_data;
+    }
+    return get_error(err);
+}
+
+PortAudio::PortAudioError
+PortAudio::open_render_ahead_stream(Ref<PortAudioStream> p_stream, PortAudioRenderAhead *p_render_ahead, Variant p_user_data) {
+    if (!p_render_ahead) {
+        return PortAudio::PortAudioError::INVALID_RENDER_AHEAD;
+    }
+    Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
+    if (output_parameter.is_null() || output_parameter->get_channel_count() <= 0) {
+        return PortAudio::PortAudioError::INVALID_CHANNEL_COUNT;
+    }
+    if (p_stream->get_input_stream_parameter().is_valid()) {
+        print_line("PortAudio::open_render_ahead_stream: input stream parameter ignored, render ahead streams are output only");
+    }
+    if (output_parameter->get_channel_routing().is_valid()) {
+        print_line("PortAudio::open_render_ahead_stream: channel routing ignored, render ahead streams write device channels");
+    }
+
+    PaSampleFormat pa_sample_format = get_sample_format(output_parameter->get_sample_format());
+    // the ring buffer holds interleaved frames, pull() copies them into the device buffer as they are
+    if (pa_sample_format & paNonInterleaved) {
+        print_line("PortAudio::open_render_ahead_stream: NON_INTERLEAVED output is not supported");
+        return PortAudioError::SAMPLE_FORMAT_NOT_SUPPORTED;
+    }
+    PaError sample_size = Pa_GetSampleSize(pa_sample_format);
+    if (sample_size <= 0) {
+        return get_error(sample_size);
+    }
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    PortAudioError init_err = initialize();
+    if (init_err != PortAudioError::NO_ERROR) {
+        return init_err;
+    }
+    int frame_size = output_parameter->get_channel_count() * (int) sample_size;
+    if (!p_render_ahead->setup(frame_size, p_stream->get_sample_rate(), p_stream->get_frames_per_buffer(), p_user_data)) {
+        return PortAudio::PortAudioError::INVALID_RENDER_AHEAD;
+    }
+
+    CallbackUserDataGdBinding *user_data = new CallbackUserDataGdBinding();
+    user_data->port_audio = this;
+    user_data->render_ahead = p_render_ahead;
+    user_data->stream = p_stream;
+    user_data->clock = p_stream->get_clock();
+    user_data->clock->reset(p_stream->get_sample_rate());
+    user_data->audio_callback_data.instantiate();
+    user_data->audio_callback_data->set_user_data(p_user_data);
+    user_data->output_channel_count = output_parameter->get_channel_count();
+    user_data->output_device_channel_count = output_parameter->get_channel_count();
+    user_data->output_sample_size = (int) sample_size;
+
+    const PaStreamParameters pa_output_parameter = {
+            output_parameter->get_device_index(),
+            output_parameter->get_channel_count(),
+            pa_sample_format,
+            output_parameter->get_suggested_latency(),
+            output_parameter->get_host_api_specific_stream_info(),
+    };
+
+    PaStream *stream;
+    PaError err = Pa_OpenStream(&stream,
+                                nullptr,
+                                &pa_output_parameter,
+                                p_stream->get_sample_rate(),
+                                p_stream->get_frames_per_buffer(),
+                                p_stream->get_stream_flags(),
+                                &port_audio_callback_gd_binding_converter,
+                                user_data);
+    if (err == PaErrorCode::paNoError) {
+        p_stream->set_stream(stream);
+        MutexLock lock(data_map_mutex);
+        data_map.insert(std::pair<Ref<PortAudioStream>, void *>(p_stream, user_data));
+    } else {
+        p_render_ahead->release();
+        delete user_data;
+    }
+    return get_error(err);
+}
+
+PortAudio::PortAudioError PortAudio::start_stream(Ref<PortAudioStream> p_stream) {
+    // a close on another thread must not free the user data of a warm stream under us
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data && user_data->warm) {
+        user_data->pool_state.store(POOL_ACTIVE, std::memory_order_release);
+        return PortAudioError::NO_ERROR;
+    }
+    PaStream *stream = (PaStream *) p_stream->get_stream();
+    PaError err = Pa_StartStream(stream);
+    return get_error(err);
+}
+
+PortAudio::PortAudioError PortAudio::stop_stream(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data && user_data->warm) {
+        park_warm_stream(user_data);
+        return PortAudioError::NO_ERROR;
+    }
+    PaStream *stream = (PaStream *) p_stream->get_stream();
+    PaError err = Pa_StopStream(stream);
+    return get_error(err);
+}
+
+PortAudio::PortAudioError PortAudio::abort_stream(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data && user_data->warm) {
+        park_warm_stream(user_data);
+        return PortAudioError::NO_ERROR;
+    }
+    PaStream *stream = (PaStream *) p_stream->get_stream();
+    PaError err = Pa_AbortStream(stream);
+    return get_error(err);
+}
+
+PortAudio::PortAudioError PortAudio::close_stream(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *warm_user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (warm_user_data && warm_user_data->warm) {
+        // warm streams go back to the pool instead of being closed
+        park_warm_stream(warm_user_data);
+        warm_user_data->audio_callback = Callable();
+        warm_user_data->audio_callback_data->set_user_data(Variant());
+        warm_user_data->warm_bound = false;
+        return PortAudioError::NO_ERROR;
+    }
+    PaStream *stream = (PaStream *) p_stream->get_stream();
+    PaError err = Pa_CloseStream(stream);
+    if (err != PaErrorCode::paNoError) {
+        // make sure the callback is stopped before the user data goes away
+        Pa_AbortStream(stream);
+    }
+    MutexLock lock(data_map_mutex);
+    std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.find(p_stream);
+    if (it != data_map.end()) {
+        CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) it->second;
+        data_map.erase(it);
+        if (user_data) {
+            release_processors(user_data);
+            delete user_data;
+        }
+    }
+    return get_error(err);
+}
+
+void PortAudio::close_render_ahead_stream(PortAudioRenderAhead *p_render_ahead) {
+    // called when the node is freed while its stream is still open
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    Ref<PortAudioStream> stream;
+    {
+        MutexLock lock(data_map_mutex);
+        for (std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.begin(); it != data_map.end(); ++it) {
+            if (((CallbackUserDataGdBinding *) it->second)->render_ahead == p_render_ahead) {
+                stream = it->first;
+                break;
+            }
+        }
+    }
+    if (stream.is_null()) {
+        return;
+    }
+    print_line("PortAudio::close_render_ahead_stream: render ahead freed while its stream is open - closing the stream");
+    PaError err = Pa_CloseStream((PaStream *) stream->get_stream());
+    if (err != PaErrorCode::paNoError) {
+        Pa_AbortStream((PaStream *) stream->get_stream());
+    }
+    MutexLock lock(data_map_mutex);
+    std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.find(stream);
+    if (it != data_map.end()) {
+        CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) it->second;
+        data_map.erase(it);
+        release_processors(user_data);
+        delete user_data;
+    }
+}
+
+PortAudio::PortAudioError PortAudio::warm_stream(Ref<PortAudioStream> p_stream) {
+    ERR_FAIL_COND_V(p_stream.is_null(), PortAudioError::BAD_STREAM_PTR);
+    {
+        MutexLock lock(data_map_mutex);
+        if (data_map.find(p_stream) != data_map.end()) {
+            return PortAudioError::STREAM_IS_NOT_STOPPED;
+        }
+        if (warm_queue.has(p_stream)) {
+            // already queued, stream_warmed is emitted once
+            return PortAudioError::NO_ERROR;
+        }
+        warm_queue.push_back(p_stream);
+    }
+    if (!warm_thread.is_started()) {
+        warm_thread_exit.store(false);
+        warm_thread.start(&PortAudio::warm_thread_main, this);
+    }
+    warm_semaphore.post();
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::release_warm_stream(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data || !user_data->warm) {
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    // a regular close from here on, the callback stays silent until the stream is stopped
+    park_warm_stream(user_data);
+    user_data->warm = false;
+    user_data->warm_bound = false;
+    Pa_StopStream((PaStream *) p_stream->get_stream());
+    return close_stream(p_stream);
+}
+
+bool PortAudio::is_stream_warm(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    return user_data && user_data->warm && !user_data->warm_bound;
+}
+
+bool PortAudio::bind_warm_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data || !user_data->warm || user_data->warm_bound) {
+        return false;
+    }
+    // parked streams never touch the callback, it is safe to swap it here
+    park_warm_stream(user_data);
+    user_data->audio_callback = p_audio_callback;
+    user_data->audio_callback_data->set_user_data(p_user_data);
+    user_data->warm_bound = true;
+    return true;
+}
+
+void PortAudio::park_warm_stream(void *p_user_data) {
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) p_user_data;
+    int expected = POOL_ACTIVE;
+    if (!user_data->pool_state.compare_exchange_strong(expected, POOL_PARKING)) {
+        return;
+    }
+    Ref<PortAudioStream> stream = user_data->stream;
+    double period_ms = stream->get_frames_per_buffer() > 0 ? stream->get_frames_per_buffer() * 1000.0 / stream->get_sample_rate() : 10.0;
+    int timeout_ms = MAX(200, (int) (period_ms * 8));
+    for (int waited_ms = 0; waited_ms < timeout_ms; waited_ms++) {
+        if (user_data->pool_state.load(std::memory_order_acquire) == POOL_PARKED) {
+            return;
+        }
+        Pa_Sleep(1);
+    }
+    print_line("PortAudio::park_warm_stream: callback did not acknowledge parking");
+    user_data->pool_state.store(POOL_PARKED, std::memory_order_release);
+}
+
+void PortAudio::warm_thread_main(void *p_port_audio) {
+    PortAudio *port_audio = (PortAudio *) p_port_audio;
+    while (true) {
+        port_audio->warm_semaphore.wait();
+        if (port_audio->warm_thread_exit.load()) {
+            return;
+        }
+        Ref<PortAudioStream> stream;
+        {
+            MutexLock lock(port_audio->data_map_mutex);
+            if (port_audio->warm_queue.is_empty()) {
+                continue;
+            }
+            stream = port_audio->warm_queue[0];
+            port_audio->warm_queue.remove_at(0);
+        }
+        PortAudioError err;
+        {
+            MutexLock lifecycle_lock(port_audio->lifecycle_mutex);
+            err = port_audio->open_stream_internal(stream, Callable(), Variant(), true);
+            if (err == PortAudioError::NO_ERROR) {
+                err = get_error(Pa_StartStream((PaStream *) stream->get_stream()));
+                if (err != PortAudioError::NO_ERROR) {
+                    // a stream that can not run is no use in the pool, a later open starts from scratch
+                    Pa_CloseStream((PaStream *) stream->get_stream());
+                    CallbackUserDataGdBinding *user_data = nullptr;
+                    {
+                        MutexLock lock(port_audio->data_map_mutex);
+                        std::map<Ref<PortAudioStream>, void *>::iterator it = port_audio->data_map.find(stream);
+                        if (it != port_audio->data_map.end()) {
+                            user_data = (CallbackUserDataGdBinding *) it->second;
+                            port_audio->data_map.erase(it);
+                        }
+                    }
+                    if (user_data) {
+                        release_processors(user_data);
+                        delete user_data;
+                    }
+                }
+            }
+        }
+        port_audio->call_deferred("emit_signal", "stream_warmed", stream, err);
+    }
+}
+
+int PortAudio::queue_control_request(ControlOperation p_operation, Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data) {
+    ERR_FAIL_COND_V(p_stream.is_null(), -1);
+    ControlRequest request;
+    request.id = next_control_request_id.fetch_add(1);
+    request.operation = p_operation;
+    request.stream = p_stream;
+    request.audio_callback = p_audio_callback;
+    request.user_data = p_user_data;
+    {
+        MutexLock lock(control_mutex);
+        control_queue.push_back(request);
+        if (!control_thread.is_started()) {
+            control_thread_exit.store(false);
+            control_thread.start(&PortAudio::control_thread_main, this);
+        }
+    }
+    control_semaphore.post();
+    return request.id;
+}
+
+int PortAudio::open_stream_async(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data) {
+    return queue_control_request(CONTROL_OPEN, p_stream, p_audio_callback, p_user_data);
+}
+
+int PortAudio::start_stream_async(Ref<PortAudioStream> p_stream) {
+    return queue_control_request(CONTROL_START, p_stream, Callable(), Variant());
+}
+
+int PortAudio::stop_stream_async(Ref<PortAudioStream> p_stream) {
+    return queue_control_request(CONTROL_STOP, p_stream, Callable(), Variant());
+}
+
+int PortAudio::abort_stream_async(Ref<PortAudioStream> p_stream) {
+    return queue_control_request(CONTROL_ABORT, p_stream, Callable(), Variant());
+}
+
+int PortAudio::close_stream_async(Ref<PortAudioStream> p_stream) {
+    return queue_control_request(CONTROL_CLOSE, p_stream, Callable(), Variant());
+}
+
+int PortAudio::reconfigure_stream(Ref<PortAudioStream> p_stream, Dictionary p_parameters) {
+    return queue_control_request(CONTROL_RECONFIGURE, p_stream, Callable(), p_parameters);
+}
+
+// missing keys keep the value of p_source
+static void apply_stream_parameters(Ref<PortAudioStream> p_target, Ref<PortAudioStream> p_source, const Dictionary &p_parameters) {
+    p_target->set_sample_rate(p_parameters.get("sample_rate", p_source->get_sample_rate()));
+    p_target->set_frames_per_buffer((int) p_parameters.get("frames_per_buffer", p_source->get_frames_per_buffer()));
+    p_target->set_stream_flags((PortAudioStream::PortAudioStreamFlag) (int) p_parameters.get("stream_flags", (int) p_source->get_stream_flags()));
+    p_target->set_input_stream_parameter(p_parameters.get("input_stream_parameter", p_source->get_input_stream_parameter()));
+    p_target->set_output_stream_parameter(p_parameters.get("output_stream_parameter", p_source->get_output_stream_parameter()));
+}
+
+static bool has_same_sample_formats(Ref<PortAudioStream> p_stream, Ref<PortAudioStream> p_other) {
+    Ref<PortAudioStreamParameter> parameters[] = { p_stream->get_input_stream_parameter(), p_stream->get_output_stream_parameter() };
+    Ref<PortAudioStreamParameter> other_parameters[] = { p_other->get_input_stream_parameter(), p_other->get_output_stream_parameter() };
+    for (int i = 0; i < 2; i++) {
+        if (parameters[i].is_valid() != other_parameters[i].is_valid()) {
+            return false;
+        }
+        if (parameters[i].is_valid() && parameters[i]->get_sample_format() != other_parameters[i]->get_sample_format()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// stages prepared for one sample rate and channel layout, the input conditioner is recreated by every open
+static bool has_native_stages(CallbackUserDataGdBinding *p_user_data) {
+    return p_user_data->graph.is_valid() || p_user_data->convolver.is_valid() || p_user_data->voice_gate.is_valid() ||
+           p_user_data->watchdog.is_valid() || p_user_data->jitter_buffer.is_valid() || p_user_data->broadcast.is_valid() ||
+           p_user_data->limiter.is_valid() || p_user_data->scheduler.load();
+}
+
+static bool can_fade_output(Ref<PortAudioStream> p_stream) {
+    Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
+    return output_parameter.is_valid() && output_parameter->get_channel_count() > 0 &&
+           output_parameter->get_sample_format() == PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32;
+}
+
+// closes a stopped stream and opens it again with the new parameters, every stage is prepared from scratch.
+// the caller holds the lifecycle lock
+PortAudio::PortAudioError PortAudio::reopen_stream_internal(Ref<PortAudioStream> p_stream, Dictionary p_parameters) {
+    CallbackUserDataGdBinding *old_user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    Callable audio_callback = old_user_data->audio_callback;
+    Variant user_data = old_user_data->audio_callback_data->get_user_data();
+    Callable stream_finished_callback = old_user_data->stream_finished_callback;
+    PaStream *old_stream = (PaStream *) p_stream->get_stream();
+    PaError close_err = Pa_CloseStream(old_stream);
+    if (close_err != paNoError) {
+        // the old stream is still open and usable
+        print_line(vformat("PortAudio::reconfigure_stream: failed to close the stream (%s)", Pa_GetErrorText(close_err)));
+        return get_error(close_err);
+    }
+    {
+        MutexLock lock(data_map_mutex);
+        data_map.erase(p_stream);
+    }
+    release_processors(old_user_data);
+    delete old_user_data;
+    Dictionary previous_parameters;
+    previous_parameters["sample_rate"] = p_stream->get_sample_rate();
+    previous_parameters["frames_per_buffer"] = p_stream->get_frames_per_buffer();
+    previous_parameters["stream_flags"] = (int) p_stream->get_stream_flags();
+    previous_parameters["input_stream_parameter"] = p_stream->get_input_stream_parameter();
+    previous_parameters["output_stream_parameter"] = p_stream->get_output_stream_parameter();
+    apply_stream_parameters(p_stream, p_stream, p_parameters);
+    PortAudioError err = open_stream_internal(p_stream, audio_callback, user_data, false);
+    if (err != PortAudioError::NO_ERROR) {
+        // the device may still take the old configuration, the stream is only lost if that fails too
+        apply_stream_parameters(p_stream, p_stream, previous_parameters);
+        if (open_stream_internal(p_stream, audio_callback, user_data, false) != PortAudioError::NO_ERROR) {
+            print_line("PortAudio::reconfigure_stream: failed to restore the previous configuration - stream is closed");
+            p_stream->set_stream(nullptr);
+            return err;
+        }
+    }
+    if (!stream_finished_callback.is_null()) {
+        set_stream_finished_callback(p_stream, stream_finished_callback);
+    }
+    return err;
+}
+
+PortAudio::PortAudioError PortAudio::reconfigure_stream_internal(Ref<PortAudioStream> p_stream, Dictionary p_parameters) {
+    // held for the whole handoff, nothing else may open or close the stream in between
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *old_user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!old_user_data) {
+        print_line("PortAudio::reconfigure_stream: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    if (old_user_data->warm || old_user_data->render_ahead) {
+        print_line("PortAudio::reconfigure_stream: warm and render ahead streams can not be reconfigured");
+        return PortAudioError::RECONFIGURE_FAILED;
+    }
+    Callable audio_callback = old_user_data->audio_callback;
+    Variant user_data = old_user_data->audio_callback_data->get_user_data();
+    PaStream *old_stream = (PaStream *) p_stream->get_stream();
+
+    // nothing to hand over on a stopped stream, a plain reopen is enough
+    if (Pa_IsStreamActive(old_stream) != 1) {
+        return reopen_stream_internal(p_stream, p_parameters);
+    }
+
+    // the replacement is opened without processors, they are attached to the running stream
+    Ref<PortAudioStream> replacement;
+    replacement.instantiate();
+    apply_stream_parameters(replacement, p_stream, p_parameters);
+    PortAudioError err = open_stream_internal(replacement, audio_callback, user_data, false);
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    CallbackUserDataGdBinding *new_user_data = (CallbackUserDataGdBinding *) find_user_data(replacement);
+    PaStream *new_stream = (PaStream *) replacement->get_stream();
+    bool compatible = replacement->get_sample_rate() == p_stream->get_sample_rate() && has_same_sample_formats(replacement, p_stream) &&
+                      new_user_data->input_channel_count == old_user_data->input_channel_count &&
+                      new_user_data->output_channel_count == old_user_data->output_channel_count &&
+                      new_user_data->input_sample_size == old_user_data->input_sample_size &&
+                      new_user_data->output_sample_size == old_user_data->output_sample_size;
+    // the limiter runs after routing, it was prepared for the device channels
+    bool limiter_compatible = compatible && new_user_data->output_device_channel_count == old_user_data->output_device_channel_count;
+    if ((!compatible && has_native_stages(old_user_data)) || (!limiter_compatible && old_user_data->limiter.is_valid())) {
+        // the stages were prepared for the old layout and can not move, only a reopen prepares them again
+        print_line("PortAudio::reconfigure_stream: sample rate or channel layout changed - reopening the stream");
+        Pa_CloseStream(new_stream);
+        {
+            MutexLock lock(data_map_mutex);
+            data_map.erase(replacement);
+        }
+        release_processors(new_user_data);
+        delete new_user_data;
+        PaError stop_err = Pa_StopStream(old_stream);
+        if (stop_err != paNoError) {
+            print_line(vformat("PortAudio::reconfigure_stream: failed to stop the stream (%s)", Pa_GetErrorText(stop_err)));
+            return get_error(stop_err);
+        }
+        err = reopen_stream_internal(p_stream, p_parameters);
+        // running before, running after, whichever configuration the reopen ended up with
+        if (p_stream->get_stream()) {
+            Pa_StartStream((PaStream *) p_stream->get_stream());
+        }
+        return err;
+    }
+    new_user_data->handoff_state.store(HANDOFF_WAITING);
+    if (Pa_StartStream(new_stream) != paNoError) {
+        print_line("PortAudio::reconfigure_stream: replacement stream failed to start");
+        Pa_CloseStream(new_stream);
+        MutexLock lock(data_map_mutex);
+        data_map.erase(replacement);
+        release_processors(new_user_data);
+        delete new_user_data;
+        return PortAudioError::RECONFIGURE_FAILED;
     }
 
-    Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
-    if (output_parameter.is_valid() && output_parameter->get_channel_count() > 0) {
-        Ref<StreamPeerBuffer> output_buffer;
-        output_buffer.instantiate();
-        output_buffer->resize(p_stream->get_frames_per_buffer());
-        user_data->audio_callback_data->set_output_buffer(output_buffer);
-        user_data->output_sample_size = (int) sample_size;
-        user_data->output_channel_count = p_stream->get_output_channel_count();
-        output_parameter->set_sample_format(p_sample_format);
+    // both streams run, wait until the replacement delivers callbacks before touching the old one
+    uint64_t deadline = OS::get_singleton()->get_ticks_usec() + 1000000;
+    while (new_user_data->handoff_callbacks.load() < 2 && OS::get_singleton()->get_ticks_usec() < deadline) {
+        OS::get_singleton()->delay_usec(1000);
+    }
+    if (new_user_data->handoff_callbacks.load() < 2) {
+        print_line("PortAudio::reconfigure_stream: replacement stream delivers no callbacks");
+        Pa_AbortStream(new_stream);
+        Pa_CloseStream(new_stream);
+        MutexLock lock(data_map_mutex);
+        data_map.erase(replacement);
+        release_processors(new_user_data);
+        delete new_user_data;
+        return PortAudioError::RECONFIGURE_FAILED;
     }
 
-    PaStream *stream;
-    PaError err = Pa_OpenDefaultStream(&stream,
-                                       p_stream->get_input_channel_count(),
-                                       p_stream->get_output_channel_count(),
-                                       pa_sample_format,
-                                       p_stream->get_sample_rate(),
-                                       p_stream->get_frames_per_buffer(),
-                                       &port_audio_callback_gd_binding_converter,
-                                       user_data);
-    if (err == PaErrorCode::paNoError) {
-        p_stream->set_stream(stream);
-        data_map.insert(std::pair<Ref<PortAudioStream>, void *>(p_stream, user_data));
+    // the waiting callback touches none of this, the old callback keeps using the shared state until it faded out
+    new_user_data->stream = p_stream;
+    new_user_data->clock = p_stream->get_clock();
+    new_user_data->handoff_can_fade = can_fade_output(replacement) && !new_user_data->output_non_interleaved;
+    old_user_data->handoff_can_fade = can_fade_output(p_stream) && !old_user_data->output_non_interleaved;
+    // a crossfade replays frames of the old stream on the replacement, both need the same frame layout and a fixed period
+    unsigned long old_period = p_stream->get_frames_per_buffer();
+    unsigned long new_period = replacement->get_frames_per_buffer();
+    bool crossfade = old_user_data->handoff_can_fade && new_user_data->handoff_can_fade && old_period > 0 && new_period > 0 &&
+                     replacement->get_sample_rate() == p_stream->get_sample_rate() &&
+                     new_user_data->output_device_channel_count == old_user_data->output_device_channel_count;
+    if (crossfade) {
+        // the old stream renders whole periods until one period of the replacement can be replayed
+        new_user_data->handoff_buffer.assign(new_period * new_user_data->output_device_channel_count, 0.0f);
+        new_user_data->handoff_fade_frames = new_period;
+        old_user_data->handoff_fade_frames = new_period;
+        old_user_data->handoff_frames = (new_period + old_period - 1) / old_period * old_period;
+        old_user_data->handoff_position = 0;
+    }
+    new_user_data->handoff_crossfade = crossfade;
+    old_user_data->handoff_crossfade = crossfade;
+    if (compatible) {
+        new_user_data->graph = old_user_data->graph;
+        new_user_data->convolver = old_user_data->convolver;
+        new_user_data->voice_gate = old_user_data->voice_gate;
+        new_user_data->watchdog = old_user_data->watchdog;
+        new_user_data->jitter_buffer = old_user_data->jitter_buffer;
+        new_user_data->broadcast = old_user_data->broadcast;
+        if (limiter_compatible) {
+            new_user_data->limiter = old_user_data->limiter;
+        }
+        if (old_user_data->input_conditioner) {
+            // filter, gate and agc state carry over. the scratch buffer stays per stream, the old callback still writes its own
+            delete new_user_data->input_conditioner;
+            new_user_data->input_conditioner = old_user_data->input_conditioner;
+            new_user_data->input_conditioning_buffer.resize(replacement->get_frames_per_buffer() * new_user_data->input_channel_count);
+        }
+        new_user_data->pre_roll_scratch = old_user_data->pre_roll_scratch;
+        new_user_data->audio_callback_data->set_pre_roll_buffer(old_user_data->audio_callback_data->get_pre_roll_buffer());
+        // pending scheduled events move with the scheduler
+        new_user_data->scheduler.store(old_user_data->scheduler.load());
+    }
+    if (!old_user_data->stream_finished_callback.is_null()) {
+        new_user_data->stream_finished_callback = old_user_data->stream_finished_callback;
+        Pa_SetStreamFinishedCallback(new_stream, &port_audio_stream_finished_callback_gd_binding_converter);
     }
-    return get_error(err);
-}
 
-PortAudio::PortAudioError PortAudio::start_stream(Ref<PortAudioStream> p_stream) {
-    PaStream *stream = (PaStream *) p_stream->get_stream();
-    PaError err = Pa_StartStream(stream);
-    return get_error(err);
-}
+    // hand over at the next period boundary of the old stream
+    old_user_data->handoff_target = new_user_data;
+    old_user_data->handoff_sample_rate = replacement->get_sample_rate();
+    old_user_data->handoff_state.store(HANDOFF_FADE_OUT, std::memory_order_release);
+    deadline = OS::get_singleton()->get_ticks_usec() + 1000000;
+    while (old_user_data->handoff_state.load() != HANDOFF_DONE && OS::get_singleton()->get_ticks_usec() < deadline) {
+        OS::get_singleton()->delay_usec(1000);
+    }
+    if (old_user_data->handoff_state.load() != HANDOFF_DONE) {
+        // the old stream stopped calling back, hand over without a fade
+        Pa_AbortStream(old_stream);
+        if (old_user_data->handoff_state.load() != HANDOFF_DONE) {
+            old_user_data->clock->reset(replacement->get_sample_rate());
+            // the old stream did not render the frames to replay, the replacement fades in its own first period
+            new_user_data->handoff_crossfade = false;
+            new_user_data->handoff_state.store(HANDOFF_FADE_IN, std::memory_order_release);
+        }
+    }
 
-PortAudio::PortAudioError PortAudio::stop_stream(Ref<PortAudioStream> p_stream) {
-    PaStream *stream = (PaStream *) p_stream->get_stream();
-    PaError err = Pa_StopStream(stream);
-    return get_error(err);
+    // the old callback no longer runs the script, move everything that is left
+    new_user_data->tracer.store(old_user_data->tracer.exchange(nullptr), std::memory_order_release);
+    // a marker that still reads the tracer through the old user data must be done before the new one owns it
+    old_user_data->wait_for_markers();
+    if (compatible) {
+        new_user_data->recorder.store(old_user_data->recorder.exchange(nullptr));
+    }
+    PortAudioShmEndpoint *endpoint = old_user_data->shm_endpoint.load();
+    int endpoint_channel_count = endpoint && endpoint->is_input() ? new_user_data->input_device_channel_count : new_user_data->output_device_channel_count;
+    if (endpoint && endpoint->get_channel_count() == endpoint_channel_count) {
+        new_user_data->shm_endpoint.store(old_user_data->shm_endpoint.exchange(nullptr));
+    }
+    apply_stream_parameters(p_stream, replacement, Dictionary());
+    {
+        MutexLock lock(data_map_mutex);
+        data_map.erase(replacement);
+        data_map[p_stream] = new_user_data;
+        p_stream->set_stream(new_stream);
+    }
+    replacement->set_stream(nullptr);
+
+    Pa_AbortStream(old_stream);
+    Pa_CloseStream(old_stream);
+    if (compatible) {
+        // shared with the replacement, must not be released
+        old_user_data->graph = Ref<PortAudioGraph>();
+        old_user_data->convolver = Ref<PortAudioConvolver>();
+        old_user_data->voice_gate = Ref<PortAudioVoiceGate>();
+        old_user_data->watchdog = Ref<PortAudioWatchdog>();
+        old_user_data->jitter_buffer = Ref<PortAudioJitterBuffer>();
+        old_user_data->broadcast = Ref<PortAudioBroadcast>();
+        if (old_user_data->limiter == new_user_data->limiter) {
+            old_user_data->limiter = Ref<PortAudioLimiter>();
+        }
+        old_user_data->scheduler.store(nullptr);
+        if (old_user_data->input_conditioner == new_user_data->input_conditioner) {
+            old_user_data->input_conditioner = nullptr;
+        }
+    }
+    release_processors(old_user_data);
+    delete old_user_data;
+    return PortAudioError::NO_ERROR;
 }
 
-PortAudio::PortAudioError PortAudio::abort_stream(Ref<PortAudioStream> p_stream) {
-    PaStream *stream = (PaStream *) p_stream->get_stream();
-    PaError err = Pa_AbortStream(stream);
-    return get_error(err);
+void PortAudio::control_thread_main(void *p_port_audio) {
+    PortAudio *port_audio = (PortAudio *) p_port_audio;
+    while (true) {
+        port_audio->control_semaphore.wait();
+        if (port_audio->control_thread_exit.load()) {
+            return;
+        }
+        ControlRequest request;
+        {
+            MutexLock lock(port_audio->control_mutex);
+            if (port_audio->control_queue.is_empty()) {
+                continue;
+            }
+            request = port_audio->control_queue[0];
+            port_audio->control_queue.remove_at(0);
+        }
+        // one thread runs every request, requests for the same stream complete in the order they were queued
+        PortAudioError err = PortAudioError::UNDEFINED;
+        switch (request.operation) {
+            case CONTROL_OPEN:
+                err = port_audio->open_stream(request.stream, request.audio_callback, request.user_data);
+                break;
+            case CONTROL_START:
+                err = port_audio->start_stream(request.stream);
+                break;
+            case CONTROL_STOP:
+                err = port_audio->stop_stream(request.stream);
+                break;
+            case CONTROL_ABORT:
+                err = port_audio->abort_stream(request.stream);
+                break;
+            case CONTROL_CLOSE:
+                err = port_audio->close_stream(request.stream);
+                break;
+            case CONTROL_RECONFIGURE:
+                err = port_audio->reconfigure_stream_internal(request.stream, request.user_data);
+                break;
+            case CONTROL_MEASURE_LATENCY: {
+                Dictionary parameters = request.user_data;
+                Dictionary result = port_audio->measure_round_trip_latency_internal(request.stream, parameters["max_latency"], parameters["apply"]);
+                port_audio->call_deferred("emit_signal", "round_trip_latency_measured", request.id, request.stream, result);
+                continue;
+            }
+        }
+        port_audio->call_deferred("emit_signal", "stream_request_completed", request.id, request.stream, err);
+    }
 }
 
-PortAudio::PortAudioError PortAudio::close_stream(Ref<PortAudioStream> p_stream) {
-    PaStream *stream = (PaStream *) p_stream->get_stream();
-    data_map.erase(p_stream);
-    PaError err = Pa_CloseStream(stream);
-    return get_error(err);
+void *PortAudio::find_user_data(Ref<PortAudioStream> p_stream) {
+    MutexLock lock(data_map_mutex);
+    std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.find(p_stream);
+    return it == data_map.end() ? nullptr : it->second;
 }
 
 PortAudio::PortAudioError
 PortAudio::set_stream_finished_callback(Ref<PortAudioStream> p_stream, Callable p_stream_finished_callback) {
+    MutexLock lock(data_map_mutex);
     std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.find(p_stream);
     if (it == data_map.end()) {
         print_line("PortAudio::set_stream_finished_callback: stream not found");
@@ -593,12 +2571,22 @@ PortAudio::set_stream_finished_callback(Ref<PortAudioStream> p_stream, Callable
 }
 
 PortAudio::PortAudioError PortAudio::is_stream_stopped(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data && user_data->warm) {
+        return (PortAudioError) (user_data->pool_state.load() != POOL_ACTIVE ? 1 : 0);
+    }
     PaStream *stream = (PaStream *) p_stream->get_stream();
     PaError err = Pa_IsStreamStopped(stream);
     return get_error(err);
 }
 
 PortAudio::PortAudioError PortAudio::is_stream_active(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data && user_data->warm) {
+        return (PortAudioError) (user_data->pool_state.load() == POOL_ACTIVE ? 1 : 0);
+    }
     PaStream *stream = (PaStream *) p_stream->get_stream();
     PaError err = Pa_IsStreamActive(stream);
     return get_error(err);
@@ -618,6 +2606,17 @@ Dictionary PortAudio::get_stream_info(Ref<PortAudioStream> p_stream) {
     stream_info["input_latency"] = pa_stream_info->inputLatency;
     stream_info["output_latency"] = pa_stream_info->outputLatency;
     stream_info["sample_rate"] = pa_stream_info->sampleRate;
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (user_data) {
+        // false means the format differs from the assumed native format of the host api, portaudio likely converts every buffer
+        if (user_data->input_channel_count > 0) {
+            stream_info["input_native_format"] = user_data->input_native_format;
+        }
+        if (user_data->output_channel_count > 0) {
+            stream_info["output_native_format"] = user_data->output_native_format;
+        }
+    }
     return stream_info;
 }
 
@@ -626,6 +2625,124 @@ double PortAudio::get_stream_cpu_load(Ref<PortAudioStream> p_stream) {
     return Pa_GetStreamCpuLoad(stream);
 }
 
+Dictionary PortAudio::get_stream_stats(Ref<PortAudioStream> p_stream) {
+    Dictionary stats;
+    // the stages are released with the user data, which only happens under the lifecycle lock
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        return stats;
+    }
+    stats["cpu_load"] = Pa_GetStreamCpuLoad((PaStream *) p_stream->get_stream());
+    stats["last_call_duration_usec"] = user_data->last_call_duration;
+    if (p_stream->get_frames_per_buffer() > 0) {
+        stats["period_usec"] = p_stream->get_frames_per_buffer() * 1000000.0 / p_stream->get_sample_rate();
+    }
+    if (user_data->watchdog.is_valid()) {
+        stats["watchdog"] = user_data->watchdog->get_stats();
+    }
+    if (user_data->jitter_buffer.is_valid()) {
+        stats["jitter_buffer"] = user_data->jitter_buffer->get_stats();
+    }
+    if (user_data->input_conditioner) {
+        stats["input_conditioning"] = user_data->input_conditioner->get_stats();
+    }
+    if (user_data->limiter.is_valid()) {
+        stats["limiter"] = user_data->limiter->get_stats();
+    }
+    PortAudioScheduler *scheduler = user_data->scheduler.load();
+    if (scheduler) {
+        stats["scheduler"] = scheduler->get_stats();
+    }
+    return stats;
+}
+
+void PortAudio::set_cpu_budget(double p_cpu_budget) {
+    cpu_budget.store(MAX(p_cpu_budget, 0.0));
+    if (p_cpu_budget > 0) {
+        start_watchdog_monitor();
+    }
+}
+
+double PortAudio::get_cpu_budget() {
+    return cpu_budget.load();
+}
+
+double PortAudio::get_total_cpu_load() {
+    return total_cpu_load.load();
+}
+
+void PortAudio::start_watchdog_monitor() {
+    if (watchdog_thread.is_started()) {
+        return;
+    }
+    watchdog_thread_exit.store(false);
+    watchdog_thread.start(&PortAudio::watchdog_monitor_main, this);
+}
+
+void PortAudio::poll_watchdogs(bool &r_budget_exceeded) {
+    // the lifecycle lock keeps streams from being closed while their load is read
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    MutexLock lock(data_map_mutex);
+    double total = 0.0;
+    double heaviest_load = 0.0;
+    CallbackUserDataGdBinding *heaviest = nullptr;
+    for (std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.begin(); it != data_map.end(); ++it) {
+        CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) it->second;
+        double load = Pa_GetStreamCpuLoad((PaStream *) it->first->get_stream());
+        total += load;
+        if (!user_data || user_data->watchdog.is_null()) {
+            continue;
+        }
+        PortAudioWatchdog::Transition transition;
+        while (user_data->watchdog->pop_transition(transition)) {
+            if (transition.state == PortAudioWatchdog::WATCHDOG_NORMAL) {
+                call_deferred("emit_signal", "stream_recovered", it->first);
+            } else {
+                call_deferred("emit_signal", "stream_degraded", it->first, transition.load);
+            }
+        }
+        if (!user_data->watchdog->is_forced() && load > heaviest_load) {
+            heaviest = user_data;
+            heaviest_load = load;
+        }
+    }
+    total_cpu_load.store(total);
+
+    // hysteresis, streams are released once the total load is clearly below the budget
+    double budget = cpu_budget.load();
+    if (budget > 0 && total > budget) {
+        if (!r_budget_exceeded) {
+            r_budget_exceeded = true;
+            call_deferred("emit_signal", "cpu_budget_exceeded", total);
+        }
+        // one stream per poll, the next poll sees the relieved load
+        if (heaviest) {
+            heaviest->watchdog->set_forced(true);
+        }
+    } else if (r_budget_exceeded && (budget <= 0 || total < budget * 0.8)) {
+        r_budget_exceeded = false;
+        for (std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.begin(); it != data_map.end(); ++it) {
+            CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) it->second;
+            if (user_data && user_data->watchdog.is_valid()) {
+                user_data->watchdog->set_forced(false);
+            }
+        }
+    }
+}
+
+void PortAudio::watchdog_monitor_main(void *p_port_audio) {
+    PortAudio *port_audio = (PortAudio *) p_port_audio;
+    bool budget_exceeded = false;
+    while (!port_audio->watchdog_thread_exit.load()) {
+        OS::get_singleton()->delay_usec(50000);
+        if (port_audio->watchdog_thread_exit.load()) {
+            break;
+        }
+        port_audio->poll_watchdogs(budget_exceeded);
+    }
+}
+
 PortAudio::PortAudioError
 PortAudio::read_stream(Ref<PortAudioStream> p_stream, PackedByteArray p_buffer, uint64_t p_frames) {
     PaStream *stream = (PaStream *) p_stream->get_stream();
@@ -664,7 +2781,548 @@ void PortAudio::sleep(unsigned int p_ms) {
     Pa_Sleep(p_ms);
 }
 
+int PortAudio::measure_round_trip_latency(Ref<PortAudioStream> p_stream, double p_max_latency, bool p_apply) {
+    Dictionary parameters;
+    parameters["max_latency"] = p_max_latency;
+    parameters["apply"] = p_apply;
+    return queue_control_request(CONTROL_MEASURE_LATENCY, p_stream, Callable(), parameters);
+}
+
+Dictionary PortAudio::measure_round_trip_latency_internal(Ref<PortAudioStream> p_stream, double p_max_latency, bool p_apply) {
+    Dictionary result;
+    result["error"] = PortAudioError::MEASUREMENT_FAILED;
+    // a non positive window captures nothing, a huge one allocates without bound
+    if (!(p_max_latency > 0.0)) {
+        print_line("PortAudio::measure_round_trip_latency: max_latency must be greater than 0");
+        return result;
+    }
+    p_max_latency = MIN(p_max_latency, 5.0);
+
+    PortAudioLatencyProbe *probe;
+    CallbackUserDataGdBinding *user_data;
+    double sample_rate = p_stream->get_sample_rate();
+    {
+        // a close on another thread must not free user_data between the lookup and arming the probe
+        MutexLock lifecycle_lock(lifecycle_mutex);
+        user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+        if (!user_data) {
+            print_line("PortAudio::measure_round_trip_latency: stream not found");
+            result["error"] = PortAudioError::STREAM_NOT_FOUND;
+            return result;
+        }
+        Ref<PortAudioStreamParameter> input_parameter = p_stream->get_input_stream_parameter();
+        Ref<PortAudioStreamParameter> output_parameter = p_stream->get_output_stream_parameter();
+        if (user_data->input_channel_count <= 0 || user_data->output_channel_count <= 0 || user_data->render_ahead) {
+            print_line("PortAudio::measure_round_trip_latency: requires a duplex callback stream");
+            result["error"] = PortAudioError::BAD_IO_DEVICE_COMBINATION;
+            return result;
+        }
+        if (input_parameter->get_sample_format() != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32 ||
+            output_parameter->get_sample_format() != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+            print_line("PortAudio::measure_round_trip_latency: requires FLOAT_32 input and output");
+            result["error"] = PortAudioError::SAMPLE_FORMAT_NOT_SUPPORTED;
+            return result;
+        }
+        if (Pa_IsStreamActive((PaStream *) p_stream->get_stream()) != 1) {
+            result["error"] = PortAudioError::STREAM_IS_STOPPED;
+            return result;
+        }
+        probe = new PortAudioLatencyProbe(user_data->input_device_channel_count,
+                                          user_data->output_device_channel_count, sample_rate, p_max_latency);
+        user_data->latency_probe.store(probe, std::memory_order_release);
+    }
+
+    // runs on the control thread for the length of the sequence plus max_latency, the lifecycle lock is not held
+    unsigned int timeout_ms = (unsigned int) (probe->get_capture_length() * 1000.0 / sample_rate) + 2000;
+    unsigned int waited_ms = 0;
+    while (!probe->is_finished() && waited_ms < timeout_ms) {
+        Pa_Sleep(10);
+        waited_ms += 10;
+    }
+
+    double reported_latency = 0.0;
+    {
+        MutexLock lifecycle_lock(lifecycle_mutex);
+        // a stream closed in the meantime took its callback with it, the probe is no longer reachable
+        if (find_user_data(p_stream) != user_data) {
+            print_line("PortAudio::measure_round_trip_latency: stream closed during the measurement");
+            delete probe;
+            result["error"] = PortAudioError::STREAM_NOT_FOUND;
+            return result;
+        }
+        // the callback clears the pointer itself once the capture is complete
+        user_data->latency_probe.exchange(nullptr);
+        if (!wait_for_callbacks(user_data, 1000000)) {
+            print_line("PortAudio::measure_round_trip_latency: callback did not return - probe leaked");
+            return result;
+        }
+        const PaStreamInfo *pa_stream_info = Pa_GetStreamInfo((PaStream *) p_stream->get_stream());
+        if (pa_stream_info) {
+            reported_latency = pa_stream_info->inputLatency + pa_stream_info->outputLatency;
+        }
+    }
+
+    int latency_frames = 0;
+    float confidence = 0.0f;
+    bool analyzed = probe->analyze(latency_frames, confidence);
+    delete probe;
+    if (!analyzed || confidence < 10.0f) {
+        print_line(vformat("PortAudio::measure_round_trip_latency: no clear correlation peak (confidence %f) - check the loopback", confidence));
+        result["confidence"] = confidence;
+        return result;
+    }
+
+    double latency = latency_frames / sample_rate;
+    result["error"] = PortAudioError::NO_ERROR;
+    result["latency"] = latency;
+    result["latency_frames"] = latency_frames;
+    result["confidence"] = confidence;
+    result["reported_latency"] = reported_latency;
+    if (p_apply) {
+        p_stream->set_input_alignment(latency);
+    }
+    return result;
+}
+
+PortAudio::PortAudioError PortAudio::schedule(Ref<PortAudioStream> p_stream, double p_dac_time, Dictionary p_event) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::schedule: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    if (!user_data->scheduler_supported) {
+        print_line("PortAudio::schedule: scheduling requires a FLOAT_32 output stream");
+        return PortAudioError::SAMPLE_FORMAT_NOT_SUPPORTED;
+    }
+    int type = p_event.get("type", START_VOICE);
+    if (type < START_VOICE || type > FIRE_CALLBACK) {
+        print_line(vformat("PortAudio::schedule: unknown event type %d", type));
+        return PortAudioError::INVALID_SCHEDULE_EVENT;
+    }
+    PortAudioScheduler *scheduler = user_data->scheduler.load(std::memory_order_acquire);
+    if (!scheduler) {
+        // most streams never schedule anything, the queues are allocated on first use
+        PortAudioScheduler *created = new PortAudioScheduler(p_stream->get_sample_rate(), user_data->output_channel_count);
+        if (user_data->scheduler.compare_exchange_strong(scheduler, created, std::memory_order_acq_rel)) {
+            scheduler = created;
+        } else {
+            delete created;
+        }
+    }
+
+    PortAudioScheduler::Event *event = new PortAudioScheduler::Event();
+    event->type = (PortAudioScheduleEventType) type;
+    event->dac_time = p_dac_time;
+    event->voice_id = p_event.get("voice", 0);
+    event->to_voice_id = p_event.get("to_voice", 0);
+    event->samples = p_event.get("samples", PackedFloat32Array());
+    event->sample_channel_count = p_event.get("channel_count", user_data->output_channel_count);
+    event->gain = p_event.get("gain", 1.0);
+    event->fade = p_event.get("fade", 0.0);
+    event->loop = p_event.get("loop", false);
+    event->callback = p_event.get("callback", Callable());
+    if (event->sample_channel_count != 1 && event->sample_channel_count != user_data->output_channel_count) {
+        delete event;
+        return PortAudioError::INVALID_CHANNEL_COUNT;
+    }
+    if (event->type == FIRE_CALLBACK && event->callback.is_null()) {
+        delete event;
+        return PortAudioError::INVALID_FUNC_REF;
+    }
+    if (!scheduler->push(event)) {
+        delete event;
+        return PortAudioError::SCHEDULE_QUEUE_FULL;
+    }
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::start_trace(Ref<PortAudioStream> p_stream, String p_path, int p_capacity) {
+    // the user data and its tracer only go away under the lifecycle lock
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::start_trace: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    if (user_data->tracer.load()) {
+        print_line("PortAudio::start_trace: stream is already traced");
+        return PortAudioError::TRACE_FAILED;
+    }
+    PortAudioTracer *tracer = new PortAudioTracer(p_capacity);
+    Error err = tracer->start(p_path, p_path.get_file().get_basename());
+    if (err != OK) {
+        print_line(vformat("PortAudio::start_trace: failed to open %s (%d)", p_path, err));
+        delete tracer;
+        return PortAudioError::TRACE_FAILED;
+    }
+    user_data->tracer.store(tracer, std::memory_order_release);
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::stop_trace(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::stop_trace: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    PortAudioTracer *tracer = user_data->tracer.exchange(nullptr);
+    if (!tracer) {
+        return PortAudioError::NO_ERROR;
+    }
+    if (!wait_for_callbacks(user_data, 1000000)) {
+        print_line("PortAudio::stop_trace: callback did not return - tracer leaked");
+        return PortAudioError::TRACE_FAILED;
+    }
+    user_data->wait_for_markers();
+    if (tracer->get_dropped_count() > 0) {
+        print_line(vformat("PortAudio::stop_trace: %d records dropped, increase the capacity", tracer->get_dropped_count()));
+    }
+    delete tracer;
+    return PortAudioError::NO_ERROR;
+}
+
+void PortAudio::add_trace_marker(Ref<PortAudioStream> p_stream, String p_name) {
+    // no lifecycle lock, it is held across stopping and reconfiguring streams. the pin keeps the user data and
+    // its tracer alive the same way a running callback does
+    CallbackUserDataGdBinding *user_data;
+    {
+        MutexLock lock(data_map_mutex);
+        std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.find(p_stream);
+        if (it == data_map.end() || !it->second) {
+            return;
+        }
+        user_data = (CallbackUserDataGdBinding *) it->second;
+        user_data->marker_pins.fetch_add(1);
+    }
+    PortAudioTracer *tracer = user_data->tracer.load();
+    if (tracer) {
+        tracer->add_marker(p_name);
+    }
+    user_data->marker_pins.fetch_sub(1);
+}
+
+PortAudio::PortAudioError PortAudio::publish_stream(Ref<PortAudioStream> p_stream, String p_name, bool p_input, int p_capacity_frames) {
+    if (!PortAudioShmEndpoint::is_supported()) {
+        print_line("PortAudio::publish_stream: shared memory endpoints are only supported on Linux");
+        return PortAudioError::PUBLISH_FAILED;
+    }
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::publish_stream: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    if (user_data->shm_endpoint.load()) {
+        print_line("PortAudio::publish_stream: stream is already published");
+        return PortAudioError::PUBLISH_FAILED;
+    }
+    // the device buffer is published as is, it has to be interleaved float
+    Ref<PortAudioStreamParameter> parameter = p_input ? p_stream->get_input_stream_parameter() : p_stream->get_output_stream_parameter();
+    int channel_count = p_input ? user_data->input_device_channel_count : user_data->output_device_channel_count;
+    if (parameter.is_null() || channel_count <= 0) {
+        return PortAudioError::INVALID_CHANNEL_COUNT;
+    }
+    if (parameter->get_sample_format() != PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32) {
+        print_line("PortAudio::publish_stream: requires FLOAT_32");
+        return PortAudioError::SAMPLE_FORMAT_NOT_SUPPORTED;
+    }
+    PortAudioShmEndpoint *endpoint = new PortAudioShmEndpoint();
+    Error err = endpoint->create(p_name, channel_count, p_stream->get_sample_rate(), p_capacity_frames, p_input);
+    if (err == ERR_ALREADY_EXISTS) {
+        print_line(vformat("PortAudio::publish_stream: %s already exists, unpublish it or pick another name", p_name));
+        delete endpoint;
+        return PortAudioError::PUBLISH_FAILED;
+    }
+    if (err != OK) {
+        print_line(vformat("PortAudio::publish_stream: failed to create %s (%d)", p_name, err));
+        delete endpoint;
+        return PortAudioError::PUBLISH_FAILED;
+    }
+    user_data->shm_endpoint.store(endpoint);
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::unpublish_stream(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::unpublish_stream: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    PortAudioShmEndpoint *endpoint = user_data->shm_endpoint.exchange(nullptr);
+    if (!endpoint) {
+        return PortAudioError::NO_ERROR;
+    }
+    if (!wait_for_callbacks(user_data, 1000000)) {
+        print_line("PortAudio::unpublish_stream: callback did not return - endpoint leaked");
+        return PortAudioError::PUBLISH_FAILED;
+    }
+    delete endpoint;
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::start_session_recording(Ref<PortAudioStream> p_stream, String p_path, int p_capacity_bytes) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::start_session_recording: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    if (user_data->render_ahead) {
+        print_line("PortAudio::start_session_recording: render ahead streams have no script callback");
+        return PortAudioError::RECORD_FAILED;
+    }
+    if (user_data->recorder.load()) {
+        print_line("PortAudio::start_session_recording: stream is already recorded");
+        return PortAudioError::RECORD_FAILED;
+    }
+    PortAudioSessionFormat::FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PortAudioSessionFormat::MAGIC;
+    header.version = PortAudioSessionFormat::VERSION;
+    header.sample_rate = p_stream->get_sample_rate();
+    header.frames_per_buffer = p_stream->get_frames_per_buffer();
+    header.input_channel_count = user_data->input_channel_count;
+    header.input_sample_size = user_data->input_sample_size;
+    header.output_channel_count = user_data->output_channel_count;
+    header.output_sample_size = user_data->output_sample_size;
+    PortAudioSessionRecorder *recorder = new PortAudioSessionRecorder(p_capacity_bytes);
+    // a callback larger than the ring would be dropped every time. with a variable buffer size the size is only known per callback
+    uint64_t record_size = sizeof(PortAudioSessionFormat::RecordHeader) +
+                           (uint64_t) header.frames_per_buffer * header.input_channel_count * header.input_sample_size;
+    if (user_data->voice_gate.is_valid()) {
+        // the callback that opens the gate carries the whole pre-roll
+        record_size += user_data->pre_roll_scratch.size() * sizeof(float);
+    }
+    if (record_size > (uint64_t) recorder->get_capacity()) {
+        print_line(vformat("PortAudio::start_session_recording: one callback needs %d bytes, capacity is %d", record_size, recorder->get_capacity()));
+        delete recorder;
+        return PortAudioError::RECORD_FAILED;
+    }
+    Error err = recorder->start(p_path, header);
+    if (err != OK) {
+        print_line(vformat("PortAudio::start_session_recording: failed to open %s (%d)", p_path, err));
+        delete recorder;
+        return PortAudioError::RECORD_FAILED;
+    }
+    user_data->recorder.store(recorder);
+    return PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudio::stop_session_recording(Ref<PortAudioStream> p_stream) {
+    MutexLock lifecycle_lock(lifecycle_mutex);
+    CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) find_user_data(p_stream);
+    if (!user_data) {
+        print_line("PortAudio::stop_session_recording: stream not found");
+        return PortAudioError::STREAM_NOT_FOUND;
+    }
+    PortAudioSessionRecorder *recorder = user_data->recorder.exchange(nullptr);
+    if (!recorder) {
+        return PortAudioError::NO_ERROR;
+    }
+    if (!wait_for_callbacks(user_data, 1000000)) {
+        print_line("PortAudio::stop_session_recording: callback did not return - recorder leaked");
+        return PortAudioError::RECORD_FAILED;
+    }
+    if (recorder->get_dropped_count() > 0) {
+        print_line(vformat("PortAudio::stop_session_recording: %d callbacks dropped, increase the capacity", recorder->get_dropped_count()));
+    }
+    delete recorder;
+    return PortAudioError::NO_ERROR;
+}
+
+Dictionary PortAudio::replay_session(String p_path, Callable p_audio_callback, Variant p_user_data, int p_first_callback,
+                                     int p_callback_count) {
+    Dictionary result;
+    result["error"] = PortAudioError::NO_ERROR;
+    if (p_audio_callback.is_null()) {
+        result["error"] = PortAudioError::INVALID_FUNC_REF;
+        return result;
+    }
+    PortAudioSessionReader reader;
+    Error err = reader.open(p_path);
+    if (err != OK) {
+        print_line(vformat("PortAudio::replay_session: failed to open %s (%d)", p_path, err));
+        result["error"] = PortAudioError::RECORD_FAILED;
+        return result;
+    }
+    const PortAudioSessionFormat::FileHeader &header = reader.get_header();
+    result["sample_rate"] = header.sample_rate;
+    result["frames_per_buffer"] = header.frames_per_buffer;
+
+    // the same callback data layout the stream had, no device or initialization needed
+    Ref<PortAudioCallbackData> audio_callback_data;
+    audio_callback_data.instantiate();
+    audio_callback_data->set_user_data(p_user_data);
+    Ref<StreamPeerBuffer> input_buffer;
+    if (header.input_channel_count > 0) {
+        input_buffer.instantiate();
+        audio_callback_data->set_input_buffer(input_buffer);
+    }
+    Ref<StreamPeerBuffer> output_buffer;
+    if (header.output_channel_count > 0) {
+        output_buffer.instantiate();
+        audio_callback_data->set_output_buffer(output_buffer);
+    }
+    Ref<StreamPeerBuffer> pre_roll_buffer;
+    if (header.input_channel_count > 0) {
+        pre_roll_buffer.instantiate();
+        audio_callback_data->set_pre_roll_buffer(pre_roll_buffer);
+    }
+    int output_frame_size = header.output_channel_count * header.output_sample_size;
+
+    PortAudioSessionFormat::RecordHeader record;
+    Vector<uint8_t> input;
+    Vector<uint8_t> pre_roll;
+    int index = 0;
+    int replayed = 0;
+    uint64_t dropped = 0;
+    uint64_t total_duration = 0;
+    uint64_t max_duration = 0;
+    int slowest_callback = -1;
+    uint64_t last_call_duration = 0;
+    while ((p_callback_count < 0 || replayed < p_callback_count) && reader.read_next(record, input, pre_roll)) {
+        dropped += record.dropped;
+        if (index++ < p_first_callback) {
+            continue;
+        }
+        if (input_buffer.is_valid()) {
+            input_buffer->resize(record.input_size);
+            input_buffer->seek(0);
+            input_buffer->put_data(input.ptr(), record.input_size);
+            input_buffer->seek(0);
+        }
+        if (output_buffer.is_valid()) {
+            if (output_buffer->get_size() != (int) (record.frames * output_frame_size)) {
+                output_buffer->resize(record.frames * output_frame_size);
+            }
+            output_buffer->seek(0);
+        }
+        audio_callback_data->set_input_buffer_adc_time(record.input_buffer_adc_time);
+        audio_callback_data->set_current_time(record.current_time);
+        audio_callback_data->set_output_buffer_dac_time(record.output_buffer_dac_time);
+        audio_callback_data->set_frames_per_buffer(record.frames);
+        audio_callback_data->set_status_flags(record.status_flags);
+        audio_callback_data->set_last_call_duration(last_call_duration);
+        audio_callback_data->set_voice_gate_event(record.voice_gate_event);
+        // the reader only accepts a pre-roll on streams with input
+        audio_callback_data->set_pre_roll_frames(0);
+        if (record.pre_roll_size > 0) {
+            audio_callback_data->set_pre_roll_frames(record.pre_roll_size / (header.input_channel_count * sizeof(float)));
+            if (pre_roll_buffer->get_size() < (int) record.pre_roll_size) {
+                pre_roll_buffer->resize(record.pre_roll_size);
+            }
+            pre_roll_buffer->seek(0);
+            pre_roll_buffer->put_data(pre_roll.ptr(), record.pre_roll_size);
+            pre_roll_buffer->seek(0);
+        }
+
+        uint64_t micro_seconds_start = OS::get_singleton()->get_ticks_usec();
+        Variant variant = audio_callback_data;
+        const Variant *variant_ptr = &variant;
+        const Variant **p_args = &variant_ptr;
+        Variant callback_result;
+        Callable::CallError error;
+        p_audio_callback.call(p_args, 1, callback_result, error);
+        last_call_duration = OS::get_singleton()->get_ticks_usec() - micro_seconds_start;
+        if (error.error != Callable::CallError::CALL_OK) {
+            print_line("PortAudio::replay_session: != Variant::CallError::CALL_OK");
+        }
+        total_duration += last_call_duration;
+        if (last_call_duration > max_duration) {
+            max_duration = last_call_duration;
+            slowest_callback = index - 1;
+        }
+        replayed++;
+        if (callback_result.get_type() == Variant::INT && (int) callback_result != PortAudioCallbackResult::CONTINUE) {
+            break;
+        }
+    }
+    result["callbacks"] = replayed;
+    result["dropped"] = dropped;
+    result["total_call_duration_usec"] = total_duration;
+    result["max_call_duration_usec"] = max_duration;
+    // index in the file, pass it as first_callback to bisect a glitch
+    result["slowest_callback"] = slowest_callback;
+    return result;
+}
+
+int64_t PortAudio::audio_time_to_ticks(Ref<PortAudioStream> p_stream, double p_audio_time) {
+    ERR_FAIL_COND_V(p_stream.is_null(), 0);
+    return p_stream->get_clock()->audio_time_to_ticks(p_audio_time);
+}
+
+double PortAudio::ticks_to_audio_time(Ref<PortAudioStream> p_stream, int64_t p_ticks_usec) {
+    ERR_FAIL_COND_V(p_stream.is_null(), 0.0);
+    return p_stream->get_clock()->ticks_to_audio_time(p_ticks_usec);
+}
+
+double PortAudio::get_clock_drift(Ref<PortAudioStream> p_stream) {
+    ERR_FAIL_COND_V(p_stream.is_null(), 0.0);
+    return p_stream->get_clock()->get_drift_ppm();
+}
+
+bool PortAudio::is_clock_locked(Ref<PortAudioStream> p_stream) {
+    ERR_FAIL_COND_V(p_stream.is_null(), false);
+    return p_stream->get_clock()->is_locked();
+}
+
+PortAudio::PortAudioError PortAudio::set_worker_thread_count(int p_worker_thread_count, bool p_pin_threads) {
+    MutexLock lock(data_map_mutex);
+    if (!data_map.empty()) {
+        print_line("PortAudio::set_worker_thread_count: close all streams before resizing the worker pool");
+        return PortAudioError::STREAM_IS_NOT_STOPPED;
+    }
+    worker_pool.start(p_worker_thread_count, p_pin_threads);
+    return PortAudioError::NO_ERROR;
+}
+
+int PortAudio::get_worker_thread_count() {
+    return worker_pool.get_worker_count();
+}
+
+PortAudioWorkerPool *PortAudio::get_worker_pool() {
+    return &worker_pool;
+}
+
+Dictionary PortAudio::benchmark_worker_pool(int p_channel_count, int p_frames, int p_iterations) {
+    Dictionary result;
+    if (p_channel_count <= 0 || p_frames <= 0 || p_iterations <= 0) {
+        return result;
+    }
+    Vector<float> samples;
+    samples.resize(p_channel_count * p_frames);
+    for (int i = 0; i < samples.size(); i++) {
+        samples.write[i] = Math::random(-1.0f, 1.0f);
+    }
+    WorkerPoolBenchmark benchmark;
+    benchmark.buffer = samples.ptrw();
+    benchmark.frames = p_frames;
+
+    // key: cores in use (workers + calling thread), value: average usec per period
+    int max_cores = MIN(OS::get_singleton()->get_processor_count(), p_channel_count);
+    for (int cores = 1; cores <= max_cores; cores++) {
+        PortAudioWorkerPool pool;
+        pool.start(cores - 1, true);
+        uint64_t start = OS::get_singleton()->get_ticks_usec();
+        for (int iteration = 0; iteration < p_iterations; iteration++) {
+            pool.execute(&WorkerPoolBenchmark::process_channel, &benchmark, p_channel_count, UINT32_MAX);
+        }
+        uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - start;
+        pool.stop();
+        result[cores] = (double) elapsed / p_iterations;
+    }
+    return result;
+}
+
 PortAudio::PortAudioError PortAudio::util_device_index_to_host_api_index(int p_device_index) {
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
     const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo((PaDeviceIndex) p_device_index);
     if (pa_device_info == nullptr) {
         return PortAudioError::INVALID_DEVICE;
@@ -674,6 +3332,11 @@ PortAudio::PortAudioError PortAudio::util_device_index_to_host_api_index(int p_d
 
 PortAudio::PortAudioError PortAudio::util_enable_exclusive_mode(Ref<PortAudioStreamParameter> p_stream_parameter) {
 #ifdef PA_USE_WASAPI
+    PortAudioError err = initialize();
+    if (err != PortAudioError::NO_ERROR) {
+        return err;
+    }
+    RWLockRead device_read_lock(device_lock);
     int device_index = p_stream_parameter->get_device_index();
     const PaDeviceInfo *pa_device_info = Pa_GetDeviceInfo((PaDeviceIndex) device_index);
     if (pa_device_info == NULL) {
@@ -730,6 +3393,8 @@ void PortAudio::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_error_text", "error"), &PortAudio::get_error_text);
     ClassDB::bind_method(D_METHOD("initialize"), &PortAudio::initialize);
     ClassDB::bind_method(D_METHOD("terminate"), &PortAudio::terminate);
+    ClassDB::bind_method(D_METHOD("initialize_async"), &PortAudio::initialize_async);
+    ClassDB::bind_method(D_METHOD("is_initialized"), &PortAudio::is_initialized);
     ClassDB::bind_method(D_METHOD("get_host_api_count"), &PortAudio::get_host_api_count);
     ClassDB::bind_method(D_METHOD("get_default_host_api"), &PortAudio::get_default_host_api);
     ClassDB::bind_method(D_METHOD("get_host_api_info", "host_api"), &PortAudio::get_host_api_info);
@@ -742,16 +3407,35 @@ void PortAudio::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_default_input_device"), &PortAudio::get_default_input_device);
     ClassDB::bind_method(D_METHOD("get_default_output_device"), &PortAudio::get_default_output_device);
     ClassDB::bind_method(D_METHOD("get_device_info", "device_index"), &PortAudio::get_device_info);
+    ClassDB::bind_method(D_METHOD("get_device_id", "device_index"), &PortAudio::get_device_id);
+    ClassDB::bind_method(D_METHOD("get_device_formats", "device_index"), &PortAudio::get_device_formats);
+    ClassDB::bind_method(D_METHOD("negotiate_stream_format", "stream"), &PortAudio::negotiate_stream_format);
+    ClassDB::bind_method(D_METHOD("get_device_index", "device_id"), &PortAudio::get_device_index);
+    ClassDB::bind_method(D_METHOD("get_devices"), &PortAudio::get_devices);
+    ClassDB::bind_method(D_METHOD("start_device_monitor", "interval"), &PortAudio::start_device_monitor, DEFVAL(2.0));
+    ClassDB::bind_method(D_METHOD("stop_device_monitor"), &PortAudio::stop_device_monitor);
+    ClassDB::bind_method(D_METHOD("is_device_monitor_running"), &PortAudio::is_device_monitor_running);
     ClassDB::bind_method(
             D_METHOD("is_format_supported", "input_stream_parameter", "output_stream_parameter", "sample_rate"),
             &PortAudio::is_format_supported);
     ClassDB::bind_method(D_METHOD("open_stream", "stream", "audio_callback", "user_data"), &PortAudio::open_stream);
     ClassDB::bind_method(D_METHOD("open_default_stream", "stream", "sample_format", "audio_callback", "user_data"),
                          &PortAudio::open_default_stream);
+    ClassDB::bind_method(D_METHOD("open_render_ahead_stream", "stream", "render_ahead", "user_data"),
+                         &PortAudio::open_render_ahead_stream);
 
     //ClassDB::bind_method(D_METHOD("connect", "signal", "callable", "binds", "flags"), &Object::connect, DEFVAL(Array()), DEFVAL(0));
 
     ClassDB::bind_method(D_METHOD("close_stream", "stream"), &PortAudio::close_stream);
+    ClassDB::bind_method(D_METHOD("open_stream_async", "stream", "audio_callback", "user_data"), &PortAudio::open_stream_async);
+    ClassDB::bind_method(D_METHOD("start_stream_async", "stream"), &PortAudio::start_stream_async);
+    ClassDB::bind_method(D_METHOD("stop_stream_async", "stream"), &PortAudio::stop_stream_async);
+    ClassDB::bind_method(D_METHOD("abort_stream_async", "stream"), &PortAudio::abort_stream_async);
+    ClassDB::bind_method(D_METHOD("close_stream_async", "stream"), &PortAudio::close_stream_async);
+    ClassDB::bind_method(D_METHOD("reconfigure_stream", "stream", "parameters"), &PortAudio::reconfigure_stream);
+    ClassDB::bind_method(D_METHOD("warm_stream", "stream"), &PortAudio::warm_stream);
+    ClassDB::bind_method(D_METHOD("release_warm_stream", "stream"), &PortAudio::release_warm_stream);
+    ClassDB::bind_method(D_METHOD("is_stream_warm", "stream"), &PortAudio::is_stream_warm);
     ClassDB::bind_method(D_METHOD("set_stream_finished_callback", "stream", "stream_finished_callback"),
                          &PortAudio::set_stream_finished_callback);
     ClassDB::bind_method(D_METHOD("start_stream", "stream"), &PortAudio::start_stream);
@@ -762,6 +3446,10 @@ void PortAudio::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_stream_info", "stream"), &PortAudio::get_stream_info);
     ClassDB::bind_method(D_METHOD("get_stream_time", "stream"), &PortAudio::get_stream_time);
     ClassDB::bind_method(D_METHOD("get_stream_cpu_load", "stream"), &PortAudio::get_stream_cpu_load);
+    ClassDB::bind_method(D_METHOD("get_stream_stats", "stream"), &PortAudio::get_stream_stats);
+    ClassDB::bind_method(D_METHOD("set_cpu_budget", "cpu_budget"), &PortAudio::set_cpu_budget);
+    ClassDB::bind_method(D_METHOD("get_cpu_budget"), &PortAudio::get_cpu_budget);
+    ClassDB::bind_method(D_METHOD("get_total_cpu_load"), &PortAudio::get_total_cpu_load);
     ClassDB::bind_method(D_METHOD("read_stream", "stream", "buffer", "frames"), &PortAudio::read_stream);
     ClassDB::bind_method(D_METHOD("write_stream", "stream", "buffer", "frames"), &PortAudio::write_stream);
     ClassDB::bind_method(D_METHOD("get_stream_read_available", "stream"), &PortAudio::get_stream_read_available);
@@ -769,6 +3457,40 @@ void PortAudio::_bind_methods() {
     ClassDB::bind_method(D_METHOD("get_sample_size", "sample_format"), &PortAudio::get_sample_size);
     ClassDB::bind_method(D_METHOD("sleep", "ms"), &PortAudio::sleep);
 
+    // Latency
+    ClassDB::bind_method(D_METHOD("measure_round_trip_latency", "stream", "max_latency", "apply"),
+                         &PortAudio::measure_round_trip_latency, DEFVAL(1.0), DEFVAL(true));
+
+    // Scheduler
+    ClassDB::bind_method(D_METHOD("schedule", "stream", "dac_time", "event"), &PortAudio::schedule);
+
+    // Clock
+    ClassDB::bind_method(D_METHOD("audio_time_to_ticks", "stream", "audio_time"), &PortAudio::audio_time_to_ticks);
+    ClassDB::bind_method(D_METHOD("ticks_to_audio_time", "stream", "ticks_usec"), &PortAudio::ticks_to_audio_time);
+    ClassDB::bind_method(D_METHOD("get_clock_drift", "stream"), &PortAudio::get_clock_drift);
+    ClassDB::bind_method(D_METHOD("is_clock_locked", "stream"), &PortAudio::is_clock_locked);
+
+    // Trace
+    ClassDB::bind_method(D_METHOD("start_trace", "stream", "path", "capacity"), &PortAudio::start_trace, DEFVAL(16384));
+    ClassDB::bind_method(D_METHOD("stop_trace", "stream"), &PortAudio::stop_trace);
+    ClassDB::bind_method(D_METHOD("add_trace_marker", "stream", "name"), &PortAudio::add_trace_marker);
+
+    // Publish
+    ClassDB::bind_method(D_METHOD("publish_stream", "stream", "name", "input", "capacity_frames"), &PortAudio::publish_stream, DEFVAL(false), DEFVAL(65536));
+    ClassDB::bind_method(D_METHOD("unpublish_stream", "stream"), &PortAudio::unpublish_stream);
+
+    // Session Recording
+    ClassDB::bind_method(D_METHOD("start_session_recording", "stream", "path", "capacity_bytes"), &PortAudio::start_session_recording, DEFVAL(4194304));
+    ClassDB::bind_method(D_METHOD("stop_session_recording", "stream"), &PortAudio::stop_session_recording);
+    ClassDB::bind_method(D_METHOD("replay_session", "path", "audio_callback", "user_data", "first_callback", "callback_count"), &PortAudio::replay_session, DEFVAL(0), DEFVAL(-1));
+
+    // Worker Pool
+    ClassDB::bind_method(D_METHOD("set_worker_thread_count", "worker_thread_count", "pin_threads"),
+                         &PortAudio::set_worker_thread_count, DEFVAL(true));
+    ClassDB::bind_method(D_METHOD("get_worker_thread_count"), &PortAudio::get_worker_thread_count);
+    ClassDB::bind_method(D_METHOD("benchmark_worker_pool", "channel_count", "frames", "iterations"),
+                         &PortAudio::benchmark_worker_pool);
+
     // Util
     ClassDB::bind_method(D_METHOD("util_device_index_to_host_api_index", "device_index"),
                          &PortAudio::util_device_index_to_host_api_index);
@@ -780,12 +3502,31 @@ void PortAudio::_bind_methods() {
     ClassDB::bind_method(D_METHOD("util_write_buffer", "source", "destination", "length"),
                          &PortAudio::util_write_buffer);
 
+    ADD_SIGNAL(MethodInfo("initialized", PropertyInfo(Variant::INT, "error")));
+    ADD_SIGNAL(MethodInfo("device_added", PropertyInfo(Variant::STRING, "device_id"), PropertyInfo(Variant::DICTIONARY, "device_info")));
+    ADD_SIGNAL(MethodInfo("device_removed", PropertyInfo(Variant::STRING, "device_id")));
+    ADD_SIGNAL(MethodInfo("default_device_changed", PropertyInfo(Variant::STRING, "input_device_id"), PropertyInfo(Variant::STRING, "output_device_id")));
+    ADD_SIGNAL(MethodInfo("stream_request_completed", PropertyInfo(Variant::INT, "request_id"), PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStream"), PropertyInfo(Variant::INT, "error")));
+    ADD_SIGNAL(MethodInfo("round_trip_latency_measured", PropertyInfo(Variant::INT, "request_id"), PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStream"), PropertyInfo(Variant::DICTIONARY, "result")));
+    ADD_SIGNAL(MethodInfo("stream_warmed", PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStream"), PropertyInfo(Variant::INT, "error")));
+    ADD_SIGNAL(MethodInfo("stream_degraded", PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStream"), PropertyInfo(Variant::FLOAT, "load")));
+    ADD_SIGNAL(MethodInfo("stream_recovered", PropertyInfo(Variant::OBJECT, "stream", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStream")));
+    ADD_SIGNAL(MethodInfo("cpu_budget_exceeded", PropertyInfo(Variant::FLOAT, "total_load")));
+
     // PortAudioError - Custom
     BIND_ENUM_CONSTANT(UNDEFINED);
     BIND_ENUM_CONSTANT(NOT_PORT_AUDIO_NODE);
     BIND_ENUM_CONSTANT(INVALID_FUNC_REF);
     BIND_ENUM_CONSTANT(STREAM_NOT_FOUND);
     BIND_ENUM_CONSTANT(STREAM_USER_DATA_NOT_FOUND);
+    BIND_ENUM_CONSTANT(INVALID_RENDER_AHEAD);
+    BIND_ENUM_CONSTANT(SCHEDULE_QUEUE_FULL);
+    BIND_ENUM_CONSTANT(MEASUREMENT_FAILED);
+    BIND_ENUM_CONSTANT(TRACE_FAILED);
+    BIND_ENUM_CONSTANT(PUBLISH_FAILED);
+    BIND_ENUM_CONSTANT(RECORD_FAILED);
+    BIND_ENUM_CONSTANT(RECONFIGURE_FAILED);
+    BIND_ENUM_CONSTANT(INVALID_SCHEDULE_EVENT);
     // PortAudioError - Origninal
     BIND_ENUM_CONSTANT(NO_ERROR);
     BIND_ENUM_CONSTANT(NOT_INITIALIZED);
@@ -822,20 +3563,72 @@ void PortAudio::_bind_methods() {
     BIND_ENUM_CONSTANT(CONTINUE);
     BIND_ENUM_CONSTANT(COMPLETE);
     BIND_ENUM_CONSTANT(ABORT);
+
+    // PortAudioScheduleEventType
+    BIND_ENUM_CONSTANT(START_VOICE);
+    BIND_ENUM_CONSTANT(STOP_VOICE);
+    BIND_ENUM_CONSTANT(CROSSFADE_VOICE);
+    BIND_ENUM_CONSTANT(FIRE_CALLBACK);
 }
 
 PortAudio::PortAudio() {
     singleton = this;
-    PortAudio::PortAudioError err = initialize();
-    if (err != PortAudio::PortAudioError::NO_ERROR) {
-        print_error(vformat("PortAudio::PortAudio: failed to initialize (%d)", err));
-    }
+    // Pa_Initialize scans every host api and device, it is deferred to the first use or initialize_async()
+    initialized.store(false);
+    initializing.store(false);
+    warm_thread_exit.store(false);
+    device_monitor_exit.store(false);
+    device_monitor_interval_usec.store(2000000);
+    control_thread_exit.store(false);
+    next_control_request_id.store(1);
+    watchdog_thread_exit.store(false);
+    cpu_budget.store(0.0);
+    total_cpu_load.store(0.0);
+    open_aggregate_streams = 0;
 }
 
 PortAudio::~PortAudio() {
+    stop_device_monitor();
+    if (watchdog_thread.is_started()) {
+        watchdog_thread_exit.store(true);
+        watchdog_thread.wait_to_finish();
+    }
+    if (control_thread.is_started()) {
+        // pending requests are dropped, their streams are closed below like any other
+        control_thread_exit.store(true);
+        control_semaphore.post();
+        control_thread.wait_to_finish();
+    }
+    if (initialize_thread.is_started()) {
+        initialize_thread.wait_to_finish();
+    }
+    if (warm_thread.is_started()) {
+        warm_thread_exit.store(true);
+        warm_semaphore.post();
+        warm_thread.wait_to_finish();
+    }
+    {
+        // Pa_Terminate would close streams still open at shutdown but leave their user data and stages behind
+        MutexLock lifecycle_lock(lifecycle_mutex);
+        MutexLock lock(data_map_mutex);
+        for (std::map<Ref<PortAudioStream>, void *>::iterator it = data_map.begin(); it != data_map.end(); ++it) {
+            PaStream *stream = (PaStream *) it->first->get_stream();
+            if (Pa_CloseStream(stream) != PaErrorCode::paNoError) {
+                Pa_AbortStream(stream);
+            }
+            CallbackUserDataGdBinding *user_data = (CallbackUserDataGdBinding *) it->second;
+            if (user_data) {
+                release_processors(user_data);
+                delete user_data;
+            }
+        }
+        data_map.clear();
+    }
+    // fails while aggregate streams are open, the library then stays initialized until the process exits
     PortAudio::PortAudioError err = terminate();
     if (err != PortAudio::PortAudioError::NO_ERROR) {
         print_error(vformat("PortAudio::PortAudio: failed to terminate (%d)", err));
     }
-    data_map.clear();
+    worker_pool.stop();
+    singleton = nullptr;
 }
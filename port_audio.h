@@ -2,10 +2,18 @@
 #define PORT_AUDIO_H
 
 #include "port_audio_stream.h"
+#include "port_audio_worker_pool.h"
+
+class PortAudioRenderAhead;
 
 #include "core/object/object.h"
 #include "core/io/stream_peer.h"
+#include "core/os/mutex.h"
+#include "core/os/rw_lock.h"
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
 
+#include <atomic>
 #include <map>
 
 class PortAudio : public Object {
@@ -19,6 +27,14 @@ public:
 		INVALID_FUNC_REF = -3,
 		STREAM_NOT_FOUND = -4,
 		STREAM_USER_DATA_NOT_FOUND = -5,
+		INVALID_RENDER_AHEAD = -6,
+		SCHEDULE_QUEUE_FULL = -7,
+		MEASUREMENT_FAILED = -8,
+		TRACE_FAILED = -9,
+		PUBLISH_FAILED = -10,
+		RECORD_FAILED = -11,
+		RECONFIGURE_FAILED = -12,
+		INVALID_SCHEDULE_EVENT = -13,
 		// PortAudio Library Error
 		NO_ERROR = 0,
 		NOT_INITIALIZED = -10000,
@@ -58,10 +74,96 @@ public:
 		ABORT = 2,
 	};
 
+	enum PortAudioScheduleEventType {
+		START_VOICE = 0,
+		STOP_VOICE = 1,
+		CROSSFADE_VOICE = 2,
+		FIRE_CALLBACK = 3,
+	};
+
 private:
 	static PortAudio *singleton;
 
 	std::map<Ref<PortAudioStream>, void *> data_map;
+	std::atomic<bool> initialized;
+	std::atomic<bool> initializing;
+	Mutex initialize_mutex;
+	Thread initialize_thread;
+
+	struct DeviceEntry {
+		String id;
+		int index = -1;
+		Dictionary info;
+	};
+	// device_lock is held for writing while the library is re-initialized, queries hold it for reading
+	RWLock device_lock;
+	Vector<DeviceEntry> devices;
+	// probed formats per device id, cleared with every scan
+	Mutex device_format_cache_mutex;
+	std::map<String, Dictionary> device_format_cache;
+	String default_input_device_id;
+	String default_output_device_id;
+	Thread device_monitor_thread;
+	std::atomic<bool> device_monitor_exit;
+	std::atomic<uint64_t> device_monitor_interval_usec;
+	// data_map_mutex guards data_map, warm_queue and open_aggregate_streams, lifecycle_mutex serializes opening and closing streams
+	Mutex data_map_mutex;
+	Mutex lifecycle_mutex;
+	// aggregate streams open their member streams outside data_map, the library must not be terminated under them
+	int open_aggregate_streams;
+	PortAudioWorkerPool worker_pool;
+
+	Thread warm_thread;
+	Semaphore warm_semaphore;
+	Vector<Ref<PortAudioStream>> warm_queue;
+	std::atomic<bool> warm_thread_exit;
+
+	enum ControlOperation {
+		CONTROL_OPEN,
+		CONTROL_START,
+		CONTROL_STOP,
+		CONTROL_ABORT,
+		CONTROL_CLOSE,
+		CONTROL_RECONFIGURE,
+		CONTROL_MEASURE_LATENCY,
+	};
+	struct ControlRequest {
+		int id = 0;
+		ControlOperation operation = CONTROL_OPEN;
+		Ref<PortAudioStream> stream;
+		Callable audio_callback;
+		Variant user_data;
+	};
+	Thread control_thread;
+	Semaphore control_semaphore;
+	Mutex control_mutex;
+	Vector<ControlRequest> control_queue;
+	std::atomic<bool> control_thread_exit;
+	std::atomic<int> next_control_request_id;
+
+	Thread watchdog_thread;
+	std::atomic<bool> watchdog_thread_exit;
+	std::atomic<double> cpu_budget;
+	std::atomic<double> total_cpu_load;
+
+	int queue_control_request(ControlOperation p_operation, Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data);
+	static void control_thread_main(void *p_port_audio);
+	PortAudio::PortAudioError reconfigure_stream_internal(Ref<PortAudioStream> p_stream, Dictionary p_parameters);
+	PortAudio::PortAudioError reopen_stream_internal(Ref<PortAudioStream> p_stream, Dictionary p_parameters);
+	Dictionary measure_round_trip_latency_internal(Ref<PortAudioStream> p_stream, double p_max_latency, bool p_apply);
+	void *find_user_data(Ref<PortAudioStream> p_stream);
+	PortAudio::PortAudioError open_stream_internal(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data, bool p_warm);
+	bool bind_warm_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data);
+	void park_warm_stream(void *p_user_data);
+	static void warm_thread_main(void *p_port_audio);
+	static void initialize_thread_main(void *p_port_audio);
+	void snapshot_devices();
+	String get_device_id_locked(int p_device_index);
+	bool rescan_devices();
+	static void device_monitor_main(void *p_port_audio);
+	void start_watchdog_monitor();
+	void poll_watchdogs(bool &r_budget_exceeded);
+	static void watchdog_monitor_main(void *p_port_audio);
 
 protected:
 	static void _bind_methods();
@@ -74,7 +176,13 @@ public:
 	Dictionary get_version_info();
 	String get_error_text(PortAudio::PortAudioError p_error);
 	PortAudio::PortAudioError initialize();
+	void initialize_async();
+	bool is_initialized();
 	PortAudio::PortAudioError terminate();
+	// PortAudioError for a PaError returned by a direct library call
+	static PortAudio::PortAudioError from_pa_error(int p_pa_error);
+	void register_aggregate_stream();
+	void unregister_aggregate_stream();
 	int get_host_api_count();
 	int get_default_host_api();
 	Dictionary get_host_api_info(int p_host_api);
@@ -85,10 +193,29 @@ public:
 	int get_default_input_device();
 	int get_default_output_device();
 	Dictionary get_device_info(int p_device_index);
+	String get_device_id(int p_device_index);
+	int get_device_index(const String &p_device_id);
+	Array get_devices();
+	PortAudio::PortAudioError start_device_monitor(double p_interval);
+	void stop_device_monitor();
+	bool is_device_monitor_running();
+	Dictionary get_device_formats(int p_device_index);
+	PortAudio::PortAudioError negotiate_stream_format(Ref<PortAudioStream> p_stream);
 	PortAudio::PortAudioError is_format_supported(Ref<PortAudioStreamParameter> p_input_stream_parameter, Ref<PortAudioStreamParameter> p_output_stream_parameter, double p_sample_rate);
 	PortAudio::PortAudioError open_stream(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data);
 	PortAudio::PortAudioError open_default_stream(Ref<PortAudioStream> p_stream, PortAudioStreamParameter::PortAudioSampleFormat p_sample_format, Callable p_audio_callback, Variant p_user_data);
+	PortAudio::PortAudioError open_render_ahead_stream(Ref<PortAudioStream> p_stream, PortAudioRenderAhead *p_render_ahead, Variant p_user_data);
 	PortAudio::PortAudioError close_stream(Ref<PortAudioStream> p_stream);
+	void close_render_ahead_stream(PortAudioRenderAhead *p_render_ahead);
+	int open_stream_async(Ref<PortAudioStream> p_stream, Callable p_audio_callback, Variant p_user_data);
+	int start_stream_async(Ref<PortAudioStream> p_stream);
+	int stop_stream_async(Ref<PortAudioStream> p_stream);
+	int abort_stream_async(Ref<PortAudioStream> p_stream);
+	int close_stream_async(Ref<PortAudioStream> p_stream);
+	int reconfigure_stream(Ref<PortAudioStream> p_stream, Dictionary p_parameters);
+	PortAudio::PortAudioError warm_stream(Ref<PortAudioStream> p_stream);
+	PortAudio::PortAudioError release_warm_stream(Ref<PortAudioStream> p_stream);
+	bool is_stream_warm(Ref<PortAudioStream> p_stream);
 	PortAudio::PortAudioError set_stream_finished_callback(Ref<PortAudioStream> p_stream, Callable p_stream_finished_callback);
 	PortAudio::PortAudioError start_stream(Ref<PortAudioStream> p_stream);
 	PortAudio::PortAudioError stop_stream(Ref<PortAudioStream> p_stream);
@@ -98,12 +225,34 @@ public:
 	Dictionary get_stream_info(Ref<PortAudioStream> p_stream);
 	double get_stream_time(Ref<PortAudioStream> p_stream);
 	double get_stream_cpu_load(Ref<PortAudioStream> p_stream);
+	Dictionary get_stream_stats(Ref<PortAudioStream> p_stream);
+	void set_cpu_budget(double p_cpu_budget);
+	double get_cpu_budget();
+	double get_total_cpu_load();
 	PortAudio::PortAudioError read_stream(Ref<PortAudioStream> p_stream, PackedByteArray p_buffer, uint64_t p_frames);
 	PortAudio::PortAudioError write_stream(Ref<PortAudioStream> p_stream, PackedByteArray p_buffer, uint64_t p_frames);
 	int64_t get_stream_read_available(Ref<PortAudioStream> p_stream);
 	int64_t get_stream_write_available(Ref<PortAudioStream> p_stream);
 	PortAudio::PortAudioError get_sample_size(PortAudioStreamParameter::PortAudioSampleFormat p_sample_format);
 	void sleep(unsigned int p_ms);
+	int measure_round_trip_latency(Ref<PortAudioStream> p_stream, double p_max_latency, bool p_apply);
+	PortAudio::PortAudioError schedule(Ref<PortAudioStream> p_stream, double p_dac_time, Dictionary p_event);
+	PortAudio::PortAudioError start_trace(Ref<PortAudioStream> p_stream, String p_path, int p_capacity);
+	PortAudio::PortAudioError stop_trace(Ref<PortAudioStream> p_stream);
+	void add_trace_marker(Ref<PortAudioStream> p_stream, String p_name);
+	PortAudio::PortAudioError publish_stream(Ref<PortAudioStream> p_stream, String p_name, bool p_input, int p_capacity_frames);
+	PortAudio::PortAudioError unpublish_stream(Ref<PortAudioStream> p_stream);
+	PortAudio::PortAudioError start_session_recording(Ref<PortAudioStream> p_stream, String p_path, int p_capacity_bytes);
+	PortAudio::PortAudioError stop_session_recording(Ref<PortAudioStream> p_stream);
+	Dictionary replay_session(String p_path, Callable p_audio_callback, Variant p_user_data, int p_first_callback, int p_callback_count);
+	int64_t audio_time_to_ticks(Ref<PortAudioStream> p_stream, double p_audio_time);
+	double ticks_to_audio_time(Ref<PortAudioStream> p_stream, int64_t p_ticks_usec);
+	double get_clock_drift(Ref<PortAudioStream> p_stream);
+	bool is_clock_locked(Ref<PortAudioStream> p_stream);
+	PortAudio::PortAudioError set_worker_thread_count(int p_worker_thread_count, bool p_pin_threads);
+	int get_worker_thread_count();
+	PortAudioWorkerPool *get_worker_pool();
+	Dictionary benchmark_worker_pool(int p_channel_count, int p_frames, int p_iterations);
 
 	PortAudio::PortAudioError util_device_index_to_host_api_index(int p_device_index);
 	PortAudio::PortAudioError util_enable_exclusive_mode(Ref<PortAudioStreamParameter> p_stream_parameter);
@@ -116,5 +265,6 @@ public:
 
 VARIANT_ENUM_CAST(PortAudio::PortAudioError);
 VARIANT_ENUM_CAST(PortAudio::PortAudioCallbackResult);
+VARIANT_ENUM_CAST(PortAudio::PortAudioScheduleEventType);
 
 #endif
@@ -0,0 +1,523 @@
+#include "port_audio_aggregate_stream.h"
+
+#include "core/os/memory.h"
+#include "core/os/os.h"
+#include "core/typedefs.h"
+
+#include <cstring>
+
+// slaves are allowed to drift this far from the master clock before the correction saturates
+#define AGGREGATE_MAX_DRIFT_PPM 1000.0
+
+int PortAudioAggregateStream::slave_callback(const void *p_input_buffer, void *p_output_buffer, unsigned long p_frames_per_buffer,
+		const PaStreamCallbackTimeInfo *p_time_info, PaStreamCallbackFlags p_status_flags, void *p_user_data) {
+	Member *member = (Member *)p_user_data;
+	if (p_input_buffer) {
+		ring_buffer_size_t frames = MIN((ring_buffer_size_t)p_frames_per_buffer, PaUtil_GetRingBufferWriteAvailable(&member->input_ring));
+		if (frames < (ring_buffer_size_t)p_frames_per_buffer) {
+			member->overrun_count.fetch_add(1, std::memory_order_relaxed);
+		}
+		PaUtil_WriteRingBuffer(&member->input_ring, p_input_buffer, frames);
+	}
+	if (p_output_buffer) {
+		ring_buffer_size_t frames = PaUtil_ReadRingBuffer(&member->output_ring, p_output_buffer, p_frames_per_buffer);
+		if (frames < (ring_buffer_size_t)p_frames_per_buffer) {
+			member->underrun_count.fetch_add(1, std::memory_order_relaxed);
+			memset((float *)p_output_buffer + (size_t)frames * member->output_channel_count, 0,
+					(p_frames_per_buffer - frames) * member->output_channel_count * sizeof(float));
+		}
+	}
+	return paContinue;
+}
+
+void PortAudioAggregateStream::gather_input(const float *p_master_input, unsigned long p_frames) {
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		if (member->input_channel_count <= 0) {
+			continue;
+		}
+		const float *source = p_master_input;
+		if ((int)i != master) {
+			// nothing is taken from the ring until it first reaches its target, the slave may start late
+			ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&member->input_ring);
+			if (!member->input_primed && available >= (ring_buffer_size_t)member->input_drift.get_target_fill()) {
+				member->input_primed = true;
+			}
+			float *resampled = member->resampled_scratch.data();
+			int produced = 0;
+			if (member->input_primed) {
+				// a faster slave fills the ring, a ratio above 1 consumes more of it per master frame
+				double ratio = member->input_drift.update(available + member->input_resampler.get_buffered_frames(), p_frames);
+				member->input_drift_ppm.store(member->input_drift.get_drift_ppm(), std::memory_order_relaxed);
+				int required = member->input_resampler.get_required_input(p_frames, ratio);
+				ring_buffer_size_t frames = PaUtil_ReadRingBuffer(&member->input_ring, member->input_scratch.data(), required);
+				if (frames < required) {
+					member->underrun_count.fetch_add(1, std::memory_order_relaxed);
+					memset(&member->input_scratch[(size_t)frames * member->input_channel_count], 0,
+							(required - frames) * member->input_channel_count * sizeof(float));
+				}
+				member->input_resampler.write(member->input_scratch.data(), required);
+				produced = member->input_resampler.read(resampled, p_frames, ratio);
+			}
+			memset(resampled + (size_t)produced * member->input_channel_count, 0, (p_frames - produced) * member->input_channel_count * sizeof(float));
+			source = resampled;
+		}
+		if (!source) {
+			continue;
+		}
+		for (unsigned long f = 0; f < p_frames; f++) {
+			memcpy(&combined_input[f * input_channel_count + member->input_channel_offset], &source[f * member->input_channel_count],
+					member->input_channel_count * sizeof(float));
+		}
+	}
+}
+
+void PortAudioAggregateStream::scatter_output(float *r_master_output, unsigned long p_frames) {
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		if (member->output_channel_count <= 0) {
+			continue;
+		}
+		float *target = (int)i == master ? r_master_output : member->output_scratch.data();
+		for (unsigned long f = 0; f < p_frames; f++) {
+			memcpy(&target[f * member->output_channel_count], &combined_output[f * output_channel_count + member->output_channel_offset],
+					member->output_channel_count * sizeof(float));
+		}
+		if ((int)i == master) {
+			continue;
+		}
+		// a faster slave drains the ring, a ratio below 1 produces more slave frames per master frame
+		ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&member->output_ring);
+		double ratio = member->output_drift.update(available, p_frames);
+		member->output_drift_ppm.store(member->output_drift.get_drift_ppm(), std::memory_order_relaxed);
+		member->output_resampler.write(target, p_frames);
+		int produced = member->output_resampler.read(member->resampled_scratch.data(), member->resampled_scratch.size() / member->output_channel_count, ratio);
+		ring_buffer_size_t frames = MIN((ring_buffer_size_t)produced, PaUtil_GetRingBufferWriteAvailable(&member->output_ring));
+		if (frames < produced) {
+			member->overrun_count.fetch_add(1, std::memory_order_relaxed);
+		}
+		PaUtil_WriteRingBuffer(&member->output_ring, member->resampled_scratch.data(), frames);
+	}
+}
+
+int PortAudioAggregateStream::master_callback(const void *p_input_buffer, void *p_output_buffer, unsigned long p_frames_per_buffer,
+		const PaStreamCallbackTimeInfo *p_time_info, PaStreamCallbackFlags p_status_flags, void *p_user_data) {
+	uint64_t micro_seconds_start = OS::get_singleton()->get_ticks_usec();
+	PortAudioAggregateStream *aggregate = (PortAudioAggregateStream *)p_user_data;
+	Member *master_member = aggregate->members[aggregate->master];
+	// scratch buffers are sized for frames_per_buffer, the streams are opened with exactly that
+	if (p_frames_per_buffer > aggregate->frames_per_buffer) {
+		if (p_output_buffer) {
+			memset(p_output_buffer, 0, p_frames_per_buffer * master_member->output_channel_count * sizeof(float));
+		}
+		return paContinue;
+	}
+
+	Ref<PortAudioCallbackData> audio_callback_data = aggregate->audio_callback_data;
+	if (aggregate->input_channel_count > 0) {
+		aggregate->gather_input((const float *)p_input_buffer, p_frames_per_buffer);
+		Ref<StreamPeerBuffer> input_buffer = audio_callback_data->get_input_buffer();
+		input_buffer->seek(0);
+		input_buffer->put_data((const uint8_t *)aggregate->combined_input.data(), p_frames_per_buffer * aggregate->input_channel_count * sizeof(float));
+		input_buffer->seek(0);
+	}
+	Ref<StreamPeerBuffer> output_buffer = audio_callback_data->get_output_buffer();
+	if (output_buffer.is_valid()) {
+		output_buffer->seek(0);
+	}
+	audio_callback_data->set_input_buffer_adc_time(p_time_info->inputBufferAdcTime);
+	audio_callback_data->set_current_time(p_time_info->currentTime);
+	audio_callback_data->set_output_buffer_dac_time(p_time_info->outputBufferDacTime);
+	audio_callback_data->set_frames_per_buffer(p_frames_per_buffer);
+	audio_callback_data->set_status_flags(p_status_flags);
+	audio_callback_data->set_last_call_duration(aggregate->last_call_duration);
+
+	// perform callback
+	Variant variant = audio_callback_data;
+	const Variant *variant_ptr = &variant;
+	const Variant **p_args = &variant_ptr;
+	Variant result;
+	Callable::CallError error;
+	aggregate->audio_callback.call(p_args, 1, result, error);
+	if (error.error != Callable::CallError::CALL_OK) {
+		print_line("PortAudioAggregateStream::master_callback: != Variant::CallError::CALL_OK");
+	}
+
+	// split the combined output across the devices, silence whatever the script did not write
+	if (output_buffer.is_valid()) {
+		int buffer_size = p_frames_per_buffer * aggregate->output_channel_count * sizeof(float);
+		int bytes_written = MIN(output_buffer->get_position(), buffer_size);
+		uint8_t *combined_output_ptr = (uint8_t *)aggregate->combined_output.data();
+		memcpy(combined_output_ptr, output_buffer->get_data_array().ptr(), bytes_written);
+		memset(combined_output_ptr + bytes_written, 0, buffer_size - bytes_written);
+		aggregate->scatter_output((float *)p_output_buffer, p_frames_per_buffer);
+	}
+
+	// evaluate callback result
+	int callback_result = 0;
+	if (result.get_type() != Variant::INT) {
+		print_line(vformat("PortAudioAggregateStream::master_callback: invalid return type: %s - returning 0", result.get_type()));
+	} else {
+		callback_result = result;
+	}
+	aggregate->last_call_duration = OS::get_singleton()->get_ticks_usec() - micro_seconds_start;
+	return callback_result;
+}
+
+int PortAudioAggregateStream::add_device(int p_device_index, int p_input_channel_count, int p_output_channel_count, double p_suggested_latency) {
+	ERR_FAIL_COND_V_MSG(open, -1, "Cannot add a device to an open aggregate stream.");
+	ERR_FAIL_COND_V_MSG(p_input_channel_count <= 0 && p_output_channel_count <= 0, -1, "A device needs input or output channels.");
+	Member *member = new Member;
+	member->device_index = p_device_index;
+	member->input_channel_count = MAX(p_input_channel_count, 0);
+	member->output_channel_count = MAX(p_output_channel_count, 0);
+	member->suggested_latency = p_suggested_latency;
+	members.push_back(member);
+	return (int)members.size() - 1;
+}
+
+int PortAudioAggregateStream::get_device_count() {
+	return members.size();
+}
+
+void PortAudioAggregateStream::set_master(int p_member) {
+	ERR_FAIL_COND_MSG(open, "Cannot change the master of an open aggregate stream.");
+	master = p_member;
+}
+
+int PortAudioAggregateStream::get_master() {
+	return master;
+}
+
+void PortAudioAggregateStream::set_sample_rate(double p_sample_rate) {
+	sample_rate = p_sample_rate;
+}
+
+double PortAudioAggregateStream::get_sample_rate() {
+	return sample_rate;
+}
+
+void PortAudioAggregateStream::set_frames_per_buffer(unsigned int p_frames_per_buffer) {
+	frames_per_buffer = p_frames_per_buffer;
+}
+
+unsigned int PortAudioAggregateStream::get_frames_per_buffer() {
+	return frames_per_buffer;
+}
+
+int PortAudioAggregateStream::get_input_channel_count() {
+	int count = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		count += members[i]->input_channel_count;
+	}
+	return count;
+}
+
+int PortAudioAggregateStream::get_output_channel_count() {
+	int count = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		count += members[i]->output_channel_count;
+	}
+	return count;
+}
+
+PortAudio::PortAudioError PortAudioAggregateStream::open_stream(Callable p_audio_callback, Variant p_user_data) {
+	if (open) {
+		return PortAudio::PortAudioError::STREAM_IS_NOT_STOPPED;
+	}
+	if (p_audio_callback.is_null()) {
+		return PortAudio::PortAudioError::INVALID_FUNC_REF;
+	}
+	if (master < 0 || master >= (int)members.size()) {
+		print_line(vformat("PortAudioAggregateStream::open_stream: invalid master %d for %d devices", master, (int)members.size()));
+		return PortAudio::PortAudioError::INVALID_DEVICE;
+	}
+	// the ring buffers and resamplers are sized per period, a variable buffer size has no upper bound
+	if (frames_per_buffer == 0) {
+		print_line("PortAudioAggregateStream::open_stream: frames_per_buffer must be set");
+		return PortAudio::PortAudioError::BUFFER_TOO_SMALL;
+	}
+	// registered before initializing, so no rescan terminates the library between initialize() and Pa_OpenStream
+	PortAudio::get_singleton()->register_aggregate_stream();
+	registered = true;
+	PortAudio::PortAudioError init_err = PortAudio::get_singleton()->initialize();
+	if (init_err != PortAudio::PortAudioError::NO_ERROR) {
+		release_members();
+		return init_err;
+	}
+
+	input_channel_count = 0;
+	output_channel_count = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		members[i]->input_channel_offset = input_channel_count;
+		members[i]->output_channel_offset = output_channel_count;
+		input_channel_count += members[i]->input_channel_count;
+		output_channel_count += members[i]->output_channel_count;
+	}
+	combined_input.assign((size_t)frames_per_buffer * input_channel_count, 0.0f);
+	combined_output.assign((size_t)frames_per_buffer * output_channel_count, 0.0f);
+	audio_callback = p_audio_callback;
+	audio_callback_data.instantiate();
+	audio_callback_data->set_user_data(p_user_data);
+	if (input_channel_count > 0) {
+		Ref<StreamPeerBuffer> input_buffer;
+		input_buffer.instantiate();
+		input_buffer->resize(frames_per_buffer * input_channel_count * sizeof(float));
+		audio_callback_data->set_input_buffer(input_buffer);
+	}
+	if (output_channel_count > 0) {
+		Ref<StreamPeerBuffer> output_buffer;
+		output_buffer.instantiate();
+		output_buffer->resize(frames_per_buffer * output_channel_count * sizeof(float));
+		audio_callback_data->set_output_buffer(output_buffer);
+	}
+	last_call_duration = 0;
+
+	// two periods of the slave clock in flight absorb the jitter between the two callbacks
+	double target_fill = frames_per_buffer * 2.0;
+	ring_buffer_size_t ring_frames = next_power_of_2(frames_per_buffer * 8);
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		member->underrun_count.store(0);
+		member->overrun_count.store(0);
+		member->input_drift_ppm.store(0);
+		member->output_drift_ppm.store(0);
+		if ((int)i == master) {
+			continue;
+		}
+		int max_channel_count = MAX(member->input_channel_count, member->output_channel_count);
+		member->resampled_scratch.assign((size_t)frames_per_buffer * 2 * max_channel_count, 0.0f);
+		if (member->input_channel_count > 0) {
+			ring_buffer_size_t frame_size = member->input_channel_count * sizeof(float);
+			member->input_ring_data = memalloc(ring_frames * frame_size);
+			PaUtil_InitializeRingBuffer(&member->input_ring, frame_size, ring_frames, member->input_ring_data);
+			member->input_scratch.assign((size_t)frames_per_buffer * 2 * member->input_channel_count, 0.0f);
+			member->input_resampler.setup(member->input_channel_count, frames_per_buffer);
+			member->input_drift.setup(target_fill, AGGREGATE_MAX_DRIFT_PPM);
+			member->input_primed = false;
+		}
+		if (member->output_channel_count > 0) {
+			ring_buffer_size_t frame_size = member->output_channel_count * sizeof(float);
+			member->output_ring_data = memalloc(ring_frames * frame_size);
+			PaUtil_InitializeRingBuffer(&member->output_ring, frame_size, ring_frames, member->output_ring_data);
+			member->output_scratch.assign((size_t)frames_per_buffer * member->output_channel_count, 0.0f);
+			member->output_resampler.setup(member->output_channel_count, frames_per_buffer);
+			member->output_drift.setup(target_fill, AGGREGATE_MAX_DRIFT_PPM);
+			// primed with silence so the slave has its target before the first master period arrives
+			std::vector<float> silence((size_t)target_fill * member->output_channel_count, 0.0f);
+			PaUtil_WriteRingBuffer(&member->output_ring, silence.data(), (ring_buffer_size_t)target_fill);
+		}
+	}
+
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		PaStreamParameters pa_input_parameter;
+		PaStreamParameters pa_output_parameter;
+		if (member->input_channel_count > 0) {
+			pa_input_parameter = { member->device_index, member->input_channel_count, paFloat32, member->suggested_latency, nullptr };
+		}
+		if (member->output_channel_count > 0) {
+			pa_output_parameter = { member->device_index, member->output_channel_count, paFloat32, member->suggested_latency, nullptr };
+		}
+		PaStream *stream;
+		PaError err = Pa_OpenStream(&stream,
+				member->input_channel_count > 0 ? &pa_input_parameter : nullptr,
+				member->output_channel_count > 0 ? &pa_output_parameter : nullptr,
+				sample_rate,
+				frames_per_buffer,
+				paNoFlag,
+				(int)i == master ? &PortAudioAggregateStream::master_callback : &PortAudioAggregateStream::slave_callback,
+				(int)i == master ? (void *)this : (void *)member);
+		if (err != paNoError) {
+			print_line(vformat("PortAudioAggregateStream::open_stream: device %d failed to open: %s", member->device_index, Pa_GetErrorText(err)));
+			release_members();
+			return PortAudio::from_pa_error(err);
+		}
+		member->stream = stream;
+	}
+	open = true;
+	return PortAudio::PortAudioError::NO_ERROR;
+}
+
+PortAudio::PortAudioError PortAudioAggregateStream::start_stream() {
+	if (!open) {
+		return PortAudio::PortAudioError::BAD_STREAM_PTR;
+	}
+	// slaves first, the master only takes slave input once their rings are primed anyway
+	for (size_t i = 0; i < members.size(); i++) {
+		if ((int)i == master) {
+			continue;
+		}
+		PaError err = Pa_StartStream(members[i]->stream);
+		if (err != paNoError) {
+			stop_stream();
+			return PortAudio::from_pa_error(err);
+		}
+	}
+	PaError err = Pa_StartStream(members[master]->stream);
+	if (err != paNoError) {
+		stop_stream();
+	}
+	return PortAudio::from_pa_error(err);
+}
+
+PortAudio::PortAudioError PortAudioAggregateStream::stop_stream() {
+	if (!open) {
+		return PortAudio::PortAudioError::BAD_STREAM_PTR;
+	}
+	// master first so no slave is left without the periods it is waiting for while others still play
+	PaError result = paNoError;
+	if (Pa_IsStreamStopped(members[master]->stream) == 0) {
+		result = Pa_StopStream(members[master]->stream);
+	}
+	for (size_t i = 0; i < members.size(); i++) {
+		if ((int)i == master || Pa_IsStreamStopped(members[i]->stream) != 0) {
+			continue;
+		}
+		PaError err = Pa_StopStream(members[i]->stream);
+		if (err != paNoError && result == paNoError) {
+			result = err;
+		}
+	}
+	return PortAudio::from_pa_error(result);
+}
+
+PortAudio::PortAudioError PortAudioAggregateStream::close_stream() {
+	if (!open) {
+		return PortAudio::PortAudioError::BAD_STREAM_PTR;
+	}
+	release_members();
+	return PortAudio::PortAudioError::NO_ERROR;
+}
+
+void PortAudioAggregateStream::release_members() {
+	// Pa_CloseStream stops a running stream first, no callback runs once it returns
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		if (member->stream) {
+			Pa_CloseStream(member->stream);
+			member->stream = nullptr;
+		}
+		if (member->input_ring_data) {
+			memfree(member->input_ring_data);
+			member->input_ring_data = nullptr;
+		}
+		if (member->output_ring_data) {
+			memfree(member->output_ring_data);
+			member->output_ring_data = nullptr;
+		}
+	}
+	open = false;
+	if (registered) {
+		registered = false;
+		// the singleton is gone when an aggregate outlives the module
+		if (PortAudio::get_singleton()) {
+			PortAudio::get_singleton()->unregister_aggregate_stream();
+		}
+	}
+}
+
+bool PortAudioAggregateStream::is_open() {
+	return open;
+}
+
+double PortAudioAggregateStream::get_input_latency() {
+	if (!open) {
+		return 0;
+	}
+	// the combined input is as late as its slowest device, slaves add their ring target
+	double latency = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		if (member->input_channel_count <= 0) {
+			continue;
+		}
+		const PaStreamInfo *pa_stream_info = Pa_GetStreamInfo(member->stream);
+		double member_latency = pa_stream_info ? pa_stream_info->inputLatency : 0;
+		if ((int)i != master) {
+			member_latency += member->input_drift.get_target_fill() / sample_rate;
+		}
+		latency = MAX(latency, member_latency);
+	}
+	return latency;
+}
+
+double PortAudioAggregateStream::get_output_latency() {
+	if (!open) {
+		return 0;
+	}
+	double latency = 0;
+	for (size_t i = 0; i < members.size(); i++) {
+		Member *member = members[i];
+		if (member->output_channel_count <= 0) {
+			continue;
+		}
+		const PaStreamInfo *pa_stream_info = Pa_GetStreamInfo(member->stream);
+		double member_latency = pa_stream_info ? pa_stream_info->outputLatency : 0;
+		if ((int)i != master) {
+			member_latency += member->output_drift.get_target_fill() / sample_rate;
+		}
+		latency = MAX(latency, member_latency);
+	}
+	return latency;
+}
+
+Dictionary PortAudioAggregateStream::get_device_stats(int p_member) {
+	Dictionary stats;
+	ERR_FAIL_INDEX_V(p_member, (int)members.size(), stats);
+	Member *member = members[p_member];
+	stats["device_index"] = member->device_index;
+	stats["master"] = p_member == master;
+	stats["input_drift_ppm"] = member->input_drift_ppm.load(std::memory_order_relaxed);
+	stats["output_drift_ppm"] = member->output_drift_ppm.load(std::memory_order_relaxed);
+	stats["input_fill"] = open && member->input_ring_data ? PaUtil_GetRingBufferReadAvailable(&member->input_ring) : 0;
+	stats["output_fill"] = open && member->output_ring_data ? PaUtil_GetRingBufferReadAvailable(&member->output_ring) : 0;
+	stats["underruns"] = member->underrun_count.load(std::memory_order_relaxed);
+	stats["overruns"] = member->overrun_count.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void PortAudioAggregateStream::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_device", "device_index", "input_channel_count", "output_channel_count", "suggested_latency"), &PortAudioAggregateStream::add_device, DEFVAL(0.0));
+	ClassDB::bind_method(D_METHOD("get_device_count"), &PortAudioAggregateStream::get_device_count);
+	ClassDB::bind_method(D_METHOD("set_master", "member"), &PortAudioAggregateStream::set_master);
+	ClassDB::bind_method(D_METHOD("get_master"), &PortAudioAggregateStream::get_master);
+	ClassDB::bind_method(D_METHOD("set_sample_rate", "sample_rate"), &PortAudioAggregateStream::set_sample_rate);
+	ClassDB::bind_method(D_METHOD("get_sample_rate"), &PortAudioAggregateStream::get_sample_rate);
+	ClassDB::bind_method(D_METHOD("set_frames_per_buffer", "frames_per_buffer"), &PortAudioAggregateStream::set_frames_per_buffer);
+	ClassDB::bind_method(D_METHOD("get_frames_per_buffer"), &PortAudioAggregateStream::get_frames_per_buffer);
+	ClassDB::bind_method(D_METHOD("get_input_channel_count"), &PortAudioAggregateStream::get_input_channel_count);
+	ClassDB::bind_method(D_METHOD("get_output_channel_count"), &PortAudioAggregateStream::get_output_channel_count);
+	ClassDB::bind_method(D_METHOD("open_stream", "audio_callback", "user_data"), &PortAudioAggregateStream::open_stream, DEFVAL(Variant()));
+	ClassDB::bind_method(D_METHOD("start_stream"), &PortAudioAggregateStream::start_stream);
+	ClassDB::bind_method(D_METHOD("stop_stream"), &PortAudioAggregateStream::stop_stream);
+	ClassDB::bind_method(D_METHOD("close_stream"), &PortAudioAggregateStream::close_stream);
+	ClassDB::bind_method(D_METHOD("is_open"), &PortAudioAggregateStream::is_open);
+	ClassDB::bind_method(D_METHOD("get_input_latency"), &PortAudioAggregateStream::get_input_latency);
+	ClassDB::bind_method(D_METHOD("get_output_latency"), &PortAudioAggregateStream::get_output_latency);
+	ClassDB::bind_method(D_METHOD("get_device_stats", "member"), &PortAudioAggregateStream::get_device_stats);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "master"), "set_master", "get_master");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "sample_rate"), "set_sample_rate", "get_sample_rate");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "frames_per_buffer"), "set_frames_per_buffer", "get_frames_per_buffer");
+}
+
+PortAudioAggregateStream::PortAudioAggregateStream() {
+	master = 0;
+	sample_rate = 44100.0;
+	frames_per_buffer = 256;
+	input_channel_count = 0;
+	output_channel_count = 0;
+	open = false;
+	registered = false;
+	last_call_duration = 0;
+}
+
+PortAudioAggregateStream::~PortAudioAggregateStream() {
+	if (open || registered) {
+		release_members();
+	}
+	for (size_t i = 0; i < members.size(); i++) {
+		delete members[i];
+	}
+}
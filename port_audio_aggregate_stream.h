@@ -0,0 +1,109 @@
+#ifndef PORT_AUDIO_AGGREGATE_STREAM_H
+#define PORT_AUDIO_AGGREGATE_STREAM_H
+
+#include "port_audio.h"
+#include "port_audio_callback_data.h"
+#include "port_audio_resampler.h"
+
+#include "core/object/ref_counted.h"
+
+#include <pa_ringbuffer.h>
+#include <portaudio.h>
+
+#include <atomic>
+#include <vector>
+
+// several device streams behind one callback, the master device clocks the callback and the others
+// are kept in sync with adaptive resampling driven by the fill level of their ring buffers
+class PortAudioAggregateStream : public RefCounted {
+	GDCLASS(PortAudioAggregateStream, RefCounted);
+
+	struct Member {
+		int device_index = -1;
+		int input_channel_count = 0;
+		int output_channel_count = 0;
+		double suggested_latency = 0;
+		// first channel of this device in the combined layout
+		int input_channel_offset = 0;
+		int output_channel_offset = 0;
+		void *stream = nullptr;
+
+		// slaves only, written and read by the slave callback on one side and the master callback on the other
+		PaUtilRingBuffer input_ring;
+		PaUtilRingBuffer output_ring;
+		void *input_ring_data = nullptr;
+		void *output_ring_data = nullptr;
+		PortAudioResampler input_resampler;
+		PortAudioResampler output_resampler;
+		PortAudioDriftController input_drift;
+		PortAudioDriftController output_drift;
+		bool input_primed = false;
+		std::vector<float> input_scratch;
+		std::vector<float> output_scratch;
+		std::vector<float> resampled_scratch;
+		std::atomic<uint64_t> underrun_count;
+		std::atomic<uint64_t> overrun_count;
+		std::atomic<double> input_drift_ppm;
+		std::atomic<double> output_drift_ppm;
+
+		Member() {
+			underrun_count.store(0);
+			overrun_count.store(0);
+			input_drift_ppm.store(0);
+			output_drift_ppm.store(0);
+		}
+	};
+
+	std::vector<Member *> members;
+	int master;
+	double sample_rate;
+	unsigned int frames_per_buffer;
+	int input_channel_count;
+	int output_channel_count;
+	bool open;
+	// counted by the PortAudio singleton from the first member stream opened until release_members()
+	bool registered;
+
+	Callable audio_callback;
+	Ref<PortAudioCallbackData> audio_callback_data;
+	std::vector<float> combined_input;
+	std::vector<float> combined_output;
+	uint64_t last_call_duration;
+
+	static int master_callback(const void *p_input_buffer, void *p_output_buffer, unsigned long p_frames_per_buffer,
+			const PaStreamCallbackTimeInfo *p_time_info, PaStreamCallbackFlags p_status_flags, void *p_user_data);
+	static int slave_callback(const void *p_input_buffer, void *p_output_buffer, unsigned long p_frames_per_buffer,
+			const PaStreamCallbackTimeInfo *p_time_info, PaStreamCallbackFlags p_status_flags, void *p_user_data);
+	void gather_input(const float *p_master_input, unsigned long p_frames);
+	void scatter_output(float *r_master_output, unsigned long p_frames);
+	void release_members();
+
+protected:
+	static void _bind_methods();
+
+public:
+	int add_device(int p_device_index, int p_input_channel_count, int p_output_channel_count, double p_suggested_latency);
+	int get_device_count();
+	void set_master(int p_member);
+	int get_master();
+	void set_sample_rate(double p_sample_rate);
+	double get_sample_rate();
+	void set_frames_per_buffer(unsigned int p_frames_per_buffer);
+	unsigned int get_frames_per_buffer();
+	int get_input_channel_count();
+	int get_output_channel_count();
+
+	PortAudio::PortAudioError open_stream(Callable p_audio_callback, Variant p_user_data);
+	PortAudio::PortAudioError start_stream();
+	PortAudio::PortAudioError stop_stream();
+	PortAudio::PortAudioError close_stream();
+	bool is_open();
+	double get_input_latency();
+	double get_output_latency();
+	Dictionary get_device_stats(int p_member);
+
+	PortAudioAggregateStream();
+	~PortAudioAggregateStream();
+};
+
+#endif
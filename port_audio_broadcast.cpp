@@ -0,0 +1,225 @@
+#include "port_audio_broadcast.h"
+
+#include "core/typedefs.h"
+
+#include <cstring>
+
+void PortAudioBroadcast::set_capacity(double p_capacity) {
+	// the storage is sized when the stream opens
+	ERR_FAIL_COND_MSG(prepared, "PortAudioBroadcast::set_capacity: broadcast is attached to an open stream");
+	capacity = MAX(p_capacity, 0.01);
+}
+
+double PortAudioBroadcast::get_capacity() {
+	return capacity;
+}
+
+Ref<PortAudioBroadcastReader> PortAudioBroadcast::create_reader() {
+	Ref<PortAudioBroadcastReader> reader;
+	reader.instantiate();
+	reader->set_broadcast(this);
+	return reader;
+}
+
+std::shared_ptr<PortAudioBroadcast::Storage> PortAudioBroadcast::get_storage() {
+	return std::atomic_load(&storage);
+}
+
+uint64_t PortAudioBroadcast::get_write_position() {
+	std::shared_ptr<Storage> current = get_storage();
+	return current ? current->write_position.load(std::memory_order_acquire) : 0;
+}
+
+int PortAudioBroadcast::get_frame_size() {
+	std::shared_ptr<Storage> current = get_storage();
+	return current ? current->frame_size : 0;
+}
+
+int PortAudioBroadcast::get_channel_count() {
+	std::shared_ptr<Storage> current = get_storage();
+	return current ? current->channel_count : 0;
+}
+
+double PortAudioBroadcast::get_sample_rate() {
+	std::shared_ptr<Storage> current = get_storage();
+	return current ? current->sample_rate : 0;
+}
+
+bool PortAudioBroadcast::prepare(int p_frame_size, int p_channel_count, double p_sample_rate) {
+	if (prepared) {
+		print_line("PortAudioBroadcast::prepare: broadcast is already attached to an open stream");
+		return false;
+	}
+	if (p_frame_size <= 0 || p_sample_rate <= 0) {
+		return false;
+	}
+	// a new storage per stream, readers still draining the previous one are not disturbed
+	std::shared_ptr<Storage> next = std::make_shared<Storage>();
+	next->capacity_frames = next_power_of_2((uint32_t)(capacity * p_sample_rate));
+	next->frame_size = p_frame_size;
+	next->channel_count = p_channel_count;
+	next->sample_rate = p_sample_rate;
+	next->data.assign(next->capacity_frames * p_frame_size, 0);
+	next->claim_position.store(0);
+	next->write_position.store(0);
+	active = next.get();
+	std::atomic_store(&storage, next);
+	prepared = true;
+	return true;
+}
+
+void PortAudioBroadcast::release() {
+	prepared = false;
+	active = nullptr;
+}
+
+void PortAudioBroadcast::write(const uint8_t *p_frames, unsigned long p_frame_count) {
+	Storage *target = active;
+	if (!target || p_frame_count == 0) {
+		return;
+	}
+	uint64_t position = target->write_position.load(std::memory_order_relaxed);
+	// a period longer than the storage only keeps its end
+	if (p_frame_count > target->capacity_frames) {
+		p_frames += (p_frame_count - target->capacity_frames) * target->frame_size;
+		position += p_frame_count - target->capacity_frames;
+		p_frame_count = target->capacity_frames;
+	}
+	uint64_t end = position + p_frame_count;
+	target->claim_position.store(end, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	uint64_t mask = target->capacity_frames - 1;
+	uint64_t first = MIN((uint64_t)p_frame_count, target->capacity_frames - (position & mask));
+	memcpy(&target->data[(position & mask) * target->frame_size], p_frames, first * target->frame_size);
+	if (first < p_frame_count) {
+		memcpy(target->data.data(), p_frames + first * target->frame_size, (p_frame_count - first) * target->frame_size);
+	}
+	target->write_position.store(end, std::memory_order_release);
+}
+
+void PortAudioBroadcast::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_capacity"), &PortAudioBroadcast::get_capacity);
+	ClassDB::bind_method(D_METHOD("set_capacity", "capacity"), &PortAudioBroadcast::set_capacity);
+	ClassDB::bind_method(D_METHOD("create_reader"), &PortAudioBroadcast::create_reader);
+	ClassDB::bind_method(D_METHOD("get_write_position"), &PortAudioBroadcast::get_write_position);
+	ClassDB::bind_method(D_METHOD("get_frame_size"), &PortAudioBroadcast::get_frame_size);
+	ClassDB::bind_method(D_METHOD("get_channel_count"), &PortAudioBroadcast::get_channel_count);
+	ClassDB::bind_method(D_METHOD("get_sample_rate"), &PortAudioBroadcast::get_sample_rate);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "capacity", PROPERTY_HINT_RANGE, "0.01,60,0.01"), "set_capacity", "get_capacity");
+}
+
+PortAudioBroadcast::PortAudioBroadcast() {
+	capacity = 2.0;
+	prepared = false;
+	active = nullptr;
+}
+
+PortAudioBroadcast::~PortAudioBroadcast() {
+}
+
+void PortAudioBroadcastReader::set_broadcast(const Ref<PortAudioBroadcast> &p_broadcast) {
+	broadcast = p_broadcast;
+	storage.reset();
+	update_storage();
+}
+
+bool PortAudioBroadcastReader::update_storage() {
+	if (broadcast.is_null()) {
+		return false;
+	}
+	std::shared_ptr<PortAudioBroadcast::Storage> current = broadcast->get_storage();
+	if (current && current != storage) {
+		// the stream was opened again, the previous storage is only followed until it is drained
+		if (!storage || position >= storage->write_position.load(std::memory_order_acquire)) {
+			storage = current;
+			position = current->write_position.load(std::memory_order_acquire);
+		}
+	}
+	return storage != nullptr;
+}
+
+PackedByteArray PortAudioBroadcastReader::read(int64_t p_max_frames) {
+	PackedByteArray result;
+	if (!update_storage()) {
+		return result;
+	}
+	uint64_t written = storage->write_position.load(std::memory_order_acquire);
+	if (written - position > storage->capacity_frames) {
+		overrun_count++;
+		dropped_frames += written - storage->capacity_frames - position;
+		position = written - storage->capacity_frames;
+	}
+	uint64_t frames = written - position;
+	if (p_max_frames >= 0) {
+		frames = MIN(frames, (uint64_t)p_max_frames);
+	}
+	if (frames == 0) {
+		return result;
+	}
+	int frame_size = storage->frame_size;
+	result.resize(frames * frame_size);
+	uint8_t *destination = result.ptrw();
+	uint64_t mask = storage->capacity_frames - 1;
+	uint64_t first = MIN(frames, storage->capacity_frames - (position & mask));
+	memcpy(destination, &storage->data[(position & mask) * frame_size], first * frame_size);
+	if (first < frames) {
+		memcpy(destination + first * frame_size, storage->data.data(), (frames - first) * frame_size);
+	}
+
+	// frames the writer claimed while we were copying may be torn, they are dropped from the front
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t claimed = storage->claim_position.load(std::memory_order_relaxed);
+	uint64_t valid_from = claimed > storage->capacity_frames ? claimed - storage->capacity_frames : 0;
+	if (valid_from > position) {
+		uint64_t torn = MIN(valid_from - position, frames);
+		overrun_count++;
+		dropped_frames += torn;
+		position += frames;
+		memmove(destination, destination + torn * frame_size, (frames - torn) * frame_size);
+		result.resize((frames - torn) * frame_size);
+		return result;
+	}
+	position += frames;
+	return result;
+}
+
+int64_t PortAudioBroadcastReader::get_available() {
+	if (!update_storage()) {
+		return 0;
+	}
+	uint64_t available = storage->write_position.load(std::memory_order_acquire) - position;
+	return MIN(available, storage->capacity_frames);
+}
+
+void PortAudioBroadcastReader::seek_latest() {
+	storage.reset();
+	update_storage();
+}
+
+uint64_t PortAudioBroadcastReader::get_position() {
+	return position;
+}
+
+uint64_t PortAudioBroadcastReader::get_overrun_count() {
+	return overrun_count;
+}
+
+uint64_t PortAudioBroadcastReader::get_dropped_frames() {
+	return dropped_frames;
+}
+
+void PortAudioBroadcastReader::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("read", "max_frames"), &PortAudioBroadcastReader::read, DEFVAL(-1));
+	ClassDB::bind_method(D_METHOD("get_available"), &PortAudioBroadcastReader::get_available);
+	ClassDB::bind_method(D_METHOD("seek_latest"), &PortAudioBroadcastReader::seek_latest);
+	ClassDB::bind_method(D_METHOD("get_position"), &PortAudioBroadcastReader::get_position);
+	ClassDB::bind_method(D_METHOD("get_overrun_count"), &PortAudioBroadcastReader::get_overrun_count);
+	ClassDB::bind_method(D_METHOD("get_dropped_frames"), &PortAudioBroadcastReader::get_dropped_frames);
+}
+
+PortAudioBroadcastReader::PortAudioBroadcastReader() {
+	position = 0;
+	overrun_count = 0;
+	dropped_frames = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef PORT_AUDIO_BROADCAST_H
+#define PORT_AUDIO_BROADCAST_H
+
+#include "core/io/resource.h"
+#include "core/object/ref_counted.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class PortAudioBroadcastReader;
+
+// the input of a stream written once per callback, any number of readers on any thread follow it with their own cursor
+class PortAudioBroadcast : public Resource {
+	GDCLASS(PortAudioBroadcast, Resource);
+
+public:
+	// one allocation per open stream, readers keep the storage they started on alive after the stream closed
+	struct Storage {
+		std::vector<uint8_t> data;
+		uint64_t capacity_frames;
+		int frame_size;
+		int channel_count;
+		double sample_rate;
+		// the writer claims a range before overwriting it and publishes it afterwards, a reader that finds
+		// the claim past its copy knows that part was overwritten while it was copying (seqlock)
+		std::atomic<uint64_t> claim_position;
+		std::atomic<uint64_t> write_position;
+	};
+
+private:
+	double capacity;
+
+	bool prepared;
+	std::shared_ptr<Storage> storage;
+	// audio thread, owned by storage
+	Storage *active;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_capacity(double p_capacity);
+	double get_capacity();
+	Ref<PortAudioBroadcastReader> create_reader();
+	uint64_t get_write_position();
+	int get_frame_size();
+	int get_channel_count();
+	double get_sample_rate();
+	std::shared_ptr<Storage> get_storage();
+
+	bool prepare(int p_frame_size, int p_channel_count, double p_sample_rate);
+	void release();
+	// audio thread, never blocks and does not know about readers
+	void write(const uint8_t *p_frames, unsigned long p_frame_count);
+
+	PortAudioBroadcast();
+	~PortAudioBroadcast();
+};
+
+// a cursor into a broadcast, use each reader from one thread at a time
+class PortAudioBroadcastReader : public RefCounted {
+	GDCLASS(PortAudioBroadcastReader, RefCounted);
+
+	Ref<PortAudioBroadcast> broadcast;
+	std::shared_ptr<PortAudioBroadcast::Storage> storage;
+	uint64_t position;
+	uint64_t overrun_count;
+	uint64_t dropped_frames;
+
+	bool update_storage();
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_broadcast(const Ref<PortAudioBroadcast> &p_broadcast);
+	// frames in the input format of the stream, at most p_max_frames (all available if negative)
+	PackedByteArray read(int64_t p_max_frames);
+	int64_t get_available();
+	// skips everything buffered, the next read starts with the next callback
+	void seek_latest();
+	uint64_t get_position();
+	uint64_t get_overrun_count();
+	uint64_t get_dropped_frames();
+
+	PortAudioBroadcastReader();
+};
+
+#endif
@@ -72,6 +72,38 @@ uint64_t PortAudioCallbackData::get_last_call_duration() {
 	return last_call_duration;
 }
 
+void PortAudioCallbackData::set_input_alignment_frames(uint64_t p_input_alignment_frames) {
+	input_alignment_frames = p_input_alignment_frames;
+}
+
+uint64_t PortAudioCallbackData::get_input_alignment_frames() {
+	return input_alignment_frames;
+}
+
+void PortAudioCallbackData::set_voice_gate_event(int p_voice_gate_event) {
+	voice_gate_event = p_voice_gate_event;
+}
+
+int PortAudioCallbackData::get_voice_gate_event() {
+	return voice_gate_event;
+}
+
+void PortAudioCallbackData::set_pre_roll_buffer(const Ref<StreamPeerBuffer> &p_pre_roll_buffer) {
+	pre_roll_buffer = p_pre_roll_buffer;
+}
+
+Ref<StreamPeerBuffer> PortAudioCallbackData::get_pre_roll_buffer() {
+	return pre_roll_buffer;
+}
+
+void PortAudioCallbackData::set_pre_roll_frames(uint64_t p_pre_roll_frames) {
+	pre_roll_frames = p_pre_roll_frames;
+}
+
+uint64_t PortAudioCallbackData::get_pre_roll_frames() {
+	return pre_roll_frames;
+}
+
 void PortAudioCallbackData::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_input_buffer_adc_time"), &PortAudioCallbackData::get_input_buffer_adc_time);
 	ClassDB::bind_method(D_METHOD("set_input_buffer_adc_time", "input_buffer_adc_time"), &PortAudioCallbackData::set_input_buffer_adc_time);
@@ -91,6 +123,14 @@ void PortAudioCallbackData::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_user_data", "user_data"), &PortAudioCallbackData::set_user_data);
 	ClassDB::bind_method(D_METHOD("get_last_call_duration"), &PortAudioCallbackData::get_last_call_duration);
 	ClassDB::bind_method(D_METHOD("set_last_call_duration", "last_call_duration"), &PortAudioCallbackData::set_last_call_duration);
+	ClassDB::bind_method(D_METHOD("get_input_alignment_frames"), &PortAudioCallbackData::get_input_alignment_frames);
+	ClassDB::bind_method(D_METHOD("set_input_alignment_frames", "input_alignment_frames"), &PortAudioCallbackData::set_input_alignment_frames);
+	ClassDB::bind_method(D_METHOD("get_voice_gate_event"), &PortAudioCallbackData::get_voice_gate_event);
+	ClassDB::bind_method(D_METHOD("set_voice_gate_event", "voice_gate_event"), &PortAudioCallbackData::set_voice_gate_event);
+	ClassDB::bind_method(D_METHOD("get_pre_roll_buffer"), &PortAudioCallbackData::get_pre_roll_buffer);
+	ClassDB::bind_method(D_METHOD("set_pre_roll_buffer", "pre_roll_buffer"), &PortAudioCallbackData::set_pre_roll_buffer);
+	ClassDB::bind_method(D_METHOD("get_pre_roll_frames"), &PortAudioCallbackData::get_pre_roll_frames);
+	ClassDB::bind_method(D_METHOD("set_pre_roll_frames", "pre_roll_frames"), &PortAudioCallbackData::set_pre_roll_frames);
 }
 
 PortAudioCallbackData::PortAudioCallbackData() {
@@ -102,6 +142,11 @@ PortAudioCallbackData::PortAudioCallbackData() {
 	frames_per_buffer = 0;
 	status_flags = 0;
 	user_data = Variant();
+	last_call_duration = 0;
+	input_alignment_frames = 0;
+	voice_gate_event = 0;
+	pre_roll_buffer = Ref<StreamPeerBuffer>();
+	pre_roll_frames = 0;
 }
 
 PortAudioCallbackData::~PortAudioCallbackData() {
@@ -17,6 +17,10 @@ private:
 	uint64_t status_flags;
 	Variant user_data;
 	uint64_t last_call_duration;
+	uint64_t input_alignment_frames;
+	int voice_gate_event;
+	Ref<StreamPeerBuffer> pre_roll_buffer;
+	uint64_t pre_roll_frames;
 
 protected:
 	static void _bind_methods();
@@ -40,6 +44,14 @@ public:
 	Variant get_user_data();
 	void set_last_call_duration(uint64_t p_last_call_duration);
 	uint64_t get_last_call_duration();
+	void set_input_alignment_frames(uint64_t p_input_alignment_frames);
+	uint64_t get_input_alignment_frames();
+	void set_voice_gate_event(int p_voice_gate_event);
+	int get_voice_gate_event();
+	void set_pre_roll_buffer(const Ref<StreamPeerBuffer> &p_pre_roll_buffer);
+	Ref<StreamPeerBuffer> get_pre_roll_buffer();
+	void set_pre_roll_frames(uint64_t p_pre_roll_frames);
+	uint64_t get_pre_roll_frames();
 
 	PortAudioCallbackData();
 	~PortAudioCallbackData();
@@ -0,0 +1,242 @@
+#include "port_audio_channel_routing.h"
+
+#include <algorithm>
+#include <cstring>
+
+int PortAudioChannelRouter::get_source_channel_count() const {
+	return source_channel_count;
+}
+
+int PortAudioChannelRouter::get_destination_channel_count() const {
+	return destination_channel_count;
+}
+
+void PortAudioChannelRouter::process(const float *p_source, float *r_destination, unsigned long p_frames) const {
+	const int source_stride = source_channel_count;
+	const int destination_stride = destination_channel_count;
+	if (runs.size() == 1 && runs[0].copy && runs[0].width == source_stride && runs[0].width == destination_stride) {
+		memcpy(r_destination, p_source, p_frames * destination_stride * sizeof(float));
+		return;
+	}
+	memset(r_destination, 0, p_frames * destination_stride * sizeof(float));
+	for (const Run &run : runs) {
+		const float *source = p_source + run.source;
+		float *destination = r_destination + run.destination;
+		const int width = run.width;
+		if (run.copy) {
+			const size_t bytes = width * sizeof(float);
+			for (unsigned long frame = 0; frame < p_frames; frame++) {
+				memcpy(destination + frame * destination_stride, source + frame * source_stride, bytes);
+			}
+		} else {
+			const float gain = run.gain;
+			for (unsigned long frame = 0; frame < p_frames; frame++) {
+				const float *source_frame = source + frame * source_stride;
+				float *destination_frame = destination + frame * destination_stride;
+				for (int c = 0; c < width; c++) {
+					destination_frame[c] += source_frame[c] * gain;
+				}
+			}
+		}
+	}
+}
+
+PortAudioChannelRouter::PortAudioChannelRouter(int p_source_channel_count, int p_destination_channel_count, const std::vector<Run> &p_runs) {
+	source_channel_count = p_source_channel_count;
+	destination_channel_count = p_destination_channel_count;
+	runs = p_runs;
+}
+
+PortAudioChannelRouter *PortAudioChannelRouting::create_router(int p_source_channel_count, int p_destination_channel_count) const {
+	std::vector<Route> valid;
+	std::vector<int> contributors(p_destination_channel_count, 0);
+	for (const Route &route : routes) {
+		if (route.source < 0 || route.source >= p_source_channel_count || route.destination < 0 || route.destination >= p_destination_channel_count) {
+			print_line(vformat("PortAudioChannelRouting::create_router: route %d -> %d out of range - route ignored", route.source, route.destination));
+			continue;
+		}
+		valid.push_back(route);
+		contributors[route.destination]++;
+	}
+	if (valid.empty()) {
+		return nullptr;
+	}
+	std::sort(valid.begin(), valid.end(), [](const Route &a, const Route &b) {
+		return a.source != b.source ? a.source < b.source : a.destination < b.destination;
+	});
+
+	// merge neighbouring channels with the same gain into runs, unity gain single contributors become copies
+	std::vector<PortAudioChannelRouter::Run> runs;
+	for (const Route &route : valid) {
+		bool copy = route.gain == 1.0f && contributors[route.destination] == 1;
+		if (!runs.empty()) {
+			PortAudioChannelRouter::Run &last = runs.back();
+			if (last.copy == copy && last.gain == route.gain && last.source + last.width == route.source && last.destination + last.width == route.destination) {
+				last.width++;
+				continue;
+			}
+		}
+		PortAudioChannelRouter::Run run;
+		run.source = route.source;
+		run.destination = route.destination;
+		run.width = 1;
+		run.gain = route.gain;
+		run.copy = copy;
+		runs.push_back(run);
+	}
+	return new PortAudioChannelRouter(p_source_channel_count, p_destination_channel_count, runs);
+}
+
+void PortAudioChannelRouting::add_route(int p_source_channel, int p_destination_channel, float p_gain) {
+	ERR_FAIL_COND(p_source_channel < 0 || p_destination_channel < 0);
+	for (Route &route : routes) {
+		if (route.source == p_source_channel && route.destination == p_destination_channel) {
+			route.gain = p_gain;
+			return;
+		}
+	}
+	Route route;
+	route.source = p_source_channel;
+	route.destination = p_destination_channel;
+	route.gain = p_gain;
+	routes.push_back(route);
+}
+
+void PortAudioChannelRouting::remove_route(int p_source_channel, int p_destination_channel) {
+	for (size_t i = 0; i < routes.size(); i++) {
+		if (routes[i].source == p_source_channel && routes[i].destination == p_destination_channel) {
+			routes.erase(routes.begin() + i);
+			return;
+		}
+	}
+}
+
+void PortAudioChannelRouting::clear_routes() {
+	routes.clear();
+}
+
+void PortAudioChannelRouting::apply_preset(PortAudioRoutingPreset p_preset, int p_channel_count, int p_source_offset, int p_destination_offset) {
+	// surround layouts use the wave channel order: L, R, C, LFE, back / side pairs
+	const float minus_3db = 0.7071f;
+	int s = p_source_offset;
+	int d = p_destination_offset;
+	clear_routes();
+	switch (p_preset) {
+		case SELECT: {
+			for (int i = 0; i < p_channel_count; i++) {
+				add_route(s + i, d + i, 1.0f);
+			}
+		} break;
+		case STEREO_TO_MONO: {
+			add_route(s, d, 0.5f);
+			add_route(s + 1, d, 0.5f);
+		} break;
+		case MONO_TO_STEREO: {
+			add_route(s, d, minus_3db);
+			add_route(s, d + 1, minus_3db);
+		} break;
+		case SURROUND_7_1_TO_STEREO: {
+			add_route(s + 6, d, minus_3db);
+			add_route(s + 7, d + 1, minus_3db);
+			[[fallthrough]];
+		}
+		case SURROUND_5_1_TO_STEREO: {
+			// itu-r bs.775 downmix, the lfe channel is dropped
+			add_route(s, d, 1.0f);
+			add_route(s + 1, d + 1, 1.0f);
+			add_route(s + 2, d, minus_3db);
+			add_route(s + 2, d + 1, minus_3db);
+			add_route(s + 4, d, minus_3db);
+			add_route(s + 5, d + 1, minus_3db);
+		} break;
+		case STEREO_TO_SURROUND_5_1: {
+			add_route(s, d, 1.0f);
+			add_route(s + 1, d + 1, 1.0f);
+			add_route(s, d + 2, 0.5f);
+			add_route(s + 1, d + 2, 0.5f);
+		} break;
+	}
+}
+
+void PortAudioChannelRouting::set_routes(Array p_routes) {
+	routes.clear();
+	for (int i = 0; i < p_routes.size(); i++) {
+		Dictionary route = p_routes[i];
+		add_route(route.get("source", 0), route.get("destination", 0), route.get("gain", 1.0));
+	}
+}
+
+Array PortAudioChannelRouting::get_routes() {
+	Array result;
+	for (const Route &route : routes) {
+		Dictionary entry;
+		entry["source"] = route.source;
+		entry["destination"] = route.destination;
+		entry["gain"] = route.gain;
+		result.push_back(entry);
+	}
+	return result;
+}
+
+int PortAudioChannelRouting::get_source_channel_count() {
+	int count = 0;
+	for (const Route &route : routes) {
+		count = MAX(count, route.source + 1);
+	}
+	return count;
+}
+
+int PortAudioChannelRouting::get_destination_channel_count() {
+	int count = 0;
+	for (const Route &route : routes) {
+		count = MAX(count, route.destination + 1);
+	}
+	return count;
+}
+
+PortAudioChannelRouter *PortAudioChannelRouting::create_input_router(int p_device_channel_count) const {
+	int logical_channel_count = 0;
+	for (const Route &route : routes) {
+		if (route.source < p_device_channel_count) {
+			logical_channel_count = MAX(logical_channel_count, route.destination + 1);
+		}
+	}
+	return create_router(p_device_channel_count, logical_channel_count);
+}
+
+PortAudioChannelRouter *PortAudioChannelRouting::create_output_router(int p_device_channel_count) const {
+	int logical_channel_count = 0;
+	for (const Route &route : routes) {
+		if (route.destination < p_device_channel_count) {
+			logical_channel_count = MAX(logical_channel_count, route.source + 1);
+		}
+	}
+	return create_router(logical_channel_count, p_device_channel_count);
+}
+
+void PortAudioChannelRouting::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_route", "source_channel", "destination_channel", "gain"), &PortAudioChannelRouting::add_route, DEFVAL(1.0));
+	ClassDB::bind_method(D_METHOD("remove_route", "source_channel", "destination_channel"), &PortAudioChannelRouting::remove_route);
+	ClassDB::bind_method(D_METHOD("clear_routes"), &PortAudioChannelRouting::clear_routes);
+	ClassDB::bind_method(D_METHOD("apply_preset", "preset", "channel_count", "source_offset", "destination_offset"), &PortAudioChannelRouting::apply_preset, DEFVAL(2), DEFVAL(0), DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("set_routes", "routes"), &PortAudioChannelRouting::set_routes);
+	ClassDB::bind_method(D_METHOD("get_routes"), &PortAudioChannelRouting::get_routes);
+	ClassDB::bind_method(D_METHOD("get_source_channel_count"), &PortAudioChannelRouting::get_source_channel_count);
+	ClassDB::bind_method(D_METHOD("get_destination_channel_count"), &PortAudioChannelRouting::get_destination_channel_count);
+
+	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "routes"), "set_routes", "get_routes");
+
+	// PortAudioRoutingPreset
+	BIND_ENUM_CONSTANT(SELECT);
+	BIND_ENUM_CONSTANT(STEREO_TO_MONO);
+	BIND_ENUM_CONSTANT(MONO_TO_STEREO);
+	BIND_ENUM_CONSTANT(SURROUND_5_1_TO_STEREO);
+	BIND_ENUM_CONSTANT(SURROUND_7_1_TO_STEREO);
+	BIND_ENUM_CONSTANT(STEREO_TO_SURROUND_5_1);
+}
+
+PortAudioChannelRouting::PortAudioChannelRouting() {
+}
+
+PortAudioChannelRouting::~PortAudioChannelRouting() {
+}
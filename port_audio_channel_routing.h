@@ -0,0 +1,79 @@
+#ifndef PORT_AUDIO_CHANNEL_ROUTING_H
+#define PORT_AUDIO_CHANNEL_ROUTING_H
+
+#include "core/io/resource.h"
+
+#include <vector>
+
+// applies a compiled routing matrix between two interleaved float buffers, used on the audio thread
+class PortAudioChannelRouter {
+public:
+	struct Run {
+		int source;
+		int destination;
+		int width;
+		float gain;
+		bool copy;
+	};
+
+private:
+	int source_channel_count;
+	int destination_channel_count;
+	std::vector<Run> runs;
+
+public:
+	int get_source_channel_count() const;
+	int get_destination_channel_count() const;
+	void process(const float *p_source, float *r_destination, unsigned long p_frames) const;
+
+	PortAudioChannelRouter(int p_source_channel_count, int p_destination_channel_count, const std::vector<Run> &p_runs);
+};
+
+class PortAudioChannelRouting : public Resource {
+	GDCLASS(PortAudioChannelRouting, Resource);
+
+public:
+	enum PortAudioRoutingPreset {
+		SELECT = 0,
+		STEREO_TO_MONO = 1,
+		MONO_TO_STEREO = 2,
+		SURROUND_5_1_TO_STEREO = 3,
+		SURROUND_7_1_TO_STEREO = 4,
+		STEREO_TO_SURROUND_5_1 = 5,
+	};
+
+private:
+	struct Route {
+		int source;
+		int destination;
+		float gain;
+	};
+
+	std::vector<Route> routes;
+
+	PortAudioChannelRouter *create_router(int p_source_channel_count, int p_destination_channel_count) const;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void add_route(int p_source_channel, int p_destination_channel, float p_gain);
+	void remove_route(int p_source_channel, int p_destination_channel);
+	void clear_routes();
+	void apply_preset(PortAudioRoutingPreset p_preset, int p_channel_count, int p_source_offset, int p_destination_offset);
+	void set_routes(Array p_routes);
+	Array get_routes();
+	int get_source_channel_count();
+	int get_destination_channel_count();
+
+	// input: device channels are the source, output: device channels are the destination
+	PortAudioChannelRouter *create_input_router(int p_device_channel_count) const;
+	PortAudioChannelRouter *create_output_router(int p_device_channel_count) const;
+
+	PortAudioChannelRouting();
+	~PortAudioChannelRouting();
+};
+
+VARIANT_ENUM_CAST(PortAudioChannelRouting::PortAudioRoutingPreset);
+
+#endif
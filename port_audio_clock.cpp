@@ -0,0 +1,142 @@
+#include "port_audio_clock.h"
+
+#include "core/math/math_funcs.h"
+
+bool PortAudioClock::read(Snapshot &r_snapshot) const {
+	for (int attempt = 0; attempt < 64; attempt++) {
+		uint32_t begin = sequence.load(std::memory_order_acquire);
+		if (begin & 1) {
+			continue;
+		}
+		r_snapshot.filtered_ticks = shared_filtered_ticks.load(std::memory_order_relaxed);
+		r_snapshot.usec_per_frame = shared_usec_per_frame.load(std::memory_order_relaxed);
+		r_snapshot.frame_position = shared_frame_position.load(std::memory_order_relaxed);
+		r_snapshot.audio_origin = shared_audio_origin.load(std::memory_order_relaxed);
+		r_snapshot.latency_usec = shared_latency_usec.load(std::memory_order_relaxed);
+		r_snapshot.sample_rate = shared_sample_rate.load(std::memory_order_relaxed);
+		r_snapshot.locked = shared_locked.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) == begin) {
+			return begin != 0 && r_snapshot.usec_per_frame > 0;
+		}
+	}
+	return false;
+}
+
+void PortAudioClock::reset(double p_sample_rate) {
+	started = false;
+	sample_rate = p_sample_rate;
+	filtered_ticks = 0;
+	usec_per_frame = p_sample_rate > 0 ? 1000000.0 / p_sample_rate : 0;
+	frame_position = 0;
+	previous_frames = 0;
+	audio_origin = 0;
+	latency_usec = 0;
+	error_usec = 0;
+	settled_periods = 0;
+	sequence.store(0, std::memory_order_release);
+}
+
+void PortAudioClock::set_bandwidth(double p_bandwidth) {
+	bandwidth = p_bandwidth;
+}
+
+void PortAudioClock::update(uint64_t p_ticks_usec, unsigned long p_frames, double p_current_time, double p_buffer_time) {
+	if (sample_rate <= 0 || p_frames == 0) {
+		return;
+	}
+	double measured = (double)p_ticks_usec;
+	double nominal_usec_per_frame = 1000000.0 / sample_rate;
+	double measured_latency = p_buffer_time > 0 ? (p_buffer_time - p_current_time) * 1000000.0 : 0;
+
+	if (!started) {
+		started = true;
+		filtered_ticks = measured;
+		usec_per_frame = nominal_usec_per_frame;
+		frame_position = 0;
+		audio_origin = p_buffer_time > 0 ? p_buffer_time : 0;
+		latency_usec = measured_latency;
+		error_usec = 0;
+		settled_periods = 0;
+	} else {
+		double period_usec = usec_per_frame * previous_frames;
+		double predicted = filtered_ticks + period_usec;
+		double error = measured - predicted;
+		frame_position += previous_frames;
+		if (Math::abs(error) > period_usec * 8.0) {
+			// stalled or restarted stream, relock instead of slewing for seconds
+			filtered_ticks = measured;
+			audio_origin = p_buffer_time > 0 ? p_buffer_time : audio_origin + frame_position / sample_rate;
+			frame_position = 0;
+			error_usec = 0;
+			settled_periods = 0;
+		} else {
+			double omega = Math_TAU * bandwidth * previous_frames / sample_rate;
+			filtered_ticks = predicted + Math_SQRT2 * omega * error;
+			usec_per_frame += omega * omega * error / previous_frames;
+			error_usec += (Math::abs(error) - error_usec) * 0.1;
+			settled_periods++;
+		}
+		latency_usec += (measured_latency - latency_usec) * 0.01;
+	}
+	previous_frames = (double)p_frames;
+	// settled when the callback jitter left after filtering stays below a quarter period
+	bool locked = settled_periods >= LOCK_PERIODS && error_usec < usec_per_frame * previous_frames * 0.25;
+
+	sequence.fetch_add(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	shared_filtered_ticks.store(filtered_ticks, std::memory_order_relaxed);
+	shared_usec_per_frame.store(usec_per_frame, std::memory_order_relaxed);
+	shared_frame_position.store(frame_position, std::memory_order_relaxed);
+	shared_audio_origin.store(audio_origin, std::memory_order_relaxed);
+	shared_latency_usec.store(latency_usec, std::memory_order_relaxed);
+	shared_sample_rate.store(sample_rate, std::memory_order_relaxed);
+	shared_locked.store(locked, std::memory_order_relaxed);
+	sequence.fetch_add(1, std::memory_order_release);
+}
+
+bool PortAudioClock::is_locked() const {
+	Snapshot snapshot;
+	return read(snapshot) && snapshot.locked;
+}
+
+int64_t PortAudioClock::audio_time_to_ticks(double p_audio_time) const {
+	Snapshot snapshot;
+	if (!read(snapshot)) {
+		return 0;
+	}
+	double audio_time = snapshot.audio_origin + snapshot.frame_position / snapshot.sample_rate;
+	double usec_per_second = snapshot.usec_per_frame * snapshot.sample_rate;
+	return (int64_t)(snapshot.filtered_ticks + snapshot.latency_usec + (p_audio_time - audio_time) * usec_per_second);
+}
+
+double PortAudioClock::ticks_to_audio_time(int64_t p_ticks_usec) const {
+	Snapshot snapshot;
+	if (!read(snapshot)) {
+		return 0;
+	}
+	double audio_time = snapshot.audio_origin + snapshot.frame_position / snapshot.sample_rate;
+	double usec_per_second = snapshot.usec_per_frame * snapshot.sample_rate;
+	return audio_time + ((double)p_ticks_usec - snapshot.filtered_ticks - snapshot.latency_usec) / usec_per_second;
+}
+
+double PortAudioClock::get_drift_ppm() const {
+	Snapshot snapshot;
+	if (!read(snapshot)) {
+		return 0;
+	}
+	// positive when the audio clock runs faster than the system clock
+	return ((1000000.0 / snapshot.sample_rate) / snapshot.usec_per_frame - 1.0) * 1000000.0;
+}
+
+PortAudioClock::PortAudioClock() {
+	bandwidth = 0.5;
+	shared_filtered_ticks.store(0);
+	shared_usec_per_frame.store(0);
+	shared_frame_position.store(0);
+	shared_audio_origin.store(0);
+	shared_latency_usec.store(0);
+	shared_sample_rate.store(0);
+	shared_locked.store(false);
+	reset(0);
+}
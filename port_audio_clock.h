@@ -0,0 +1,65 @@
+#ifndef PORT_AUDIO_CLOCK_H
+#define PORT_AUDIO_CLOCK_H
+
+#include "core/typedefs.h"
+
+#include <atomic>
+
+// delay locked loop mapping the stream time of a callback stream to OS::get_ticks_usec
+class PortAudioClock {
+private:
+	struct Snapshot {
+		double filtered_ticks;
+		double usec_per_frame;
+		double frame_position;
+		double audio_origin;
+		double latency_usec;
+		double sample_rate;
+		bool locked;
+	};
+
+	enum {
+		// periods after a (re)lock before the loop can report lock
+		LOCK_PERIODS = 8,
+	};
+
+	// written by the audio thread only
+	bool started;
+	double bandwidth;
+	double filtered_ticks;
+	double usec_per_frame;
+	double frame_position;
+	double previous_frames;
+	double audio_origin;
+	double latency_usec;
+	double sample_rate;
+	double error_usec;
+	int settled_periods;
+
+	// seqlock, readers retry while the audio thread is writing
+	std::atomic<uint32_t> sequence;
+	std::atomic<double> shared_filtered_ticks;
+	std::atomic<double> shared_usec_per_frame;
+	std::atomic<double> shared_frame_position;
+	std::atomic<double> shared_audio_origin;
+	std::atomic<double> shared_latency_usec;
+	std::atomic<double> shared_sample_rate;
+	std::atomic<bool> shared_locked;
+
+	bool read(Snapshot &r_snapshot) const;
+
+public:
+	void reset(double p_sample_rate);
+	void set_bandwidth(double p_bandwidth);
+	void update(uint64_t p_ticks_usec, unsigned long p_frames, double p_current_time, double p_buffer_time);
+
+	// true once the loop has settled, false again after a relock
+	bool is_locked() const;
+	int64_t audio_time_to_ticks(double p_audio_time) const;
+	double ticks_to_audio_time(int64_t p_ticks_usec) const;
+	double get_drift_ppm() const;
+
+	PortAudioClock();
+};
+
+#endif
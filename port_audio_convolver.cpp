@@ -0,0 +1,362 @@
+#include "port_audio_convolver.h"
+
+#include <string.h>
+
+void PortAudioConvolver::set_partition_size(int p_partition_size) {
+	if (prepared) {
+		print_line("PortAudioConvolver::set_partition_size: can not change the partition size of an open stream");
+		return;
+	}
+	int size = 16;
+	while (size < p_partition_size) {
+		size <<= 1;
+	}
+	partition_size = size;
+}
+
+int PortAudioConvolver::get_partition_size() {
+	return partition_size;
+}
+
+void PortAudioConvolver::set_max_length(double p_max_length) {
+	max_length = p_max_length;
+}
+
+double PortAudioConvolver::get_max_length() {
+	return max_length;
+}
+
+void PortAudioConvolver::set_wet_gain(float p_wet_gain) {
+	wet_gain = p_wet_gain;
+}
+
+float PortAudioConvolver::get_wet_gain() {
+	return wet_gain;
+}
+
+void PortAudioConvolver::set_dry_gain(float p_dry_gain) {
+	dry_gain = p_dry_gain;
+}
+
+float PortAudioConvolver::get_dry_gain() {
+	return dry_gain;
+}
+
+Error PortAudioConvolver::set_impulse_response(PackedFloat32Array p_impulse_response, int p_channel_count) {
+	if (p_channel_count <= 0 || p_impulse_response.size() < p_channel_count) {
+		return ERR_INVALID_PARAMETER;
+	}
+	impulse_response = p_impulse_response;
+	impulse_response_channel_count = p_channel_count;
+	if (!prepared) {
+		return OK;
+	}
+	// partition and transform off the audio thread, the kernel is swapped in with a crossfade
+	if (load_thread.is_started()) {
+		load_thread.wait_to_finish();
+	}
+	// the kernel faded out by the last load is freed here, on the main thread
+	collect();
+	load_impulse_response = p_impulse_response;
+	load_impulse_response_channel_count = p_channel_count;
+	loading.store(true, std::memory_order_release);
+	load_thread.start(&PortAudioConvolver::load_thread_main, this);
+	return OK;
+}
+
+PackedFloat32Array PortAudioConvolver::get_impulse_response() {
+	return impulse_response;
+}
+
+bool PortAudioConvolver::is_loading() {
+	return loading.load(std::memory_order_acquire);
+}
+
+void PortAudioConvolver::load_thread_main(void *p_convolver) {
+	PortAudioConvolver *convolver = (PortAudioConvolver *)p_convolver;
+	Kernel *kernel = convolver->build_kernel(convolver->load_impulse_response, convolver->load_impulse_response_channel_count);
+	convolver->publish(kernel);
+	convolver->loading.store(false, std::memory_order_release);
+	convolver->call_deferred("emit_signal", "impulse_response_loaded");
+}
+
+PortAudioConvolver::Kernel *PortAudioConvolver::build_kernel(const PackedFloat32Array &p_impulse_response, int p_impulse_response_channel_count) {
+	int block = partition_size;
+	int fft_size = block * 2;
+	int length = p_impulse_response.size() / p_impulse_response_channel_count;
+	int partition_count = length > block ? (length - block + block - 1) / block : 0;
+	if (partition_count > max_partitions) {
+		print_line(vformat("PortAudioConvolver::build_kernel: impulse response truncated to %f seconds", max_length));
+		partition_count = max_partitions;
+	}
+
+	Kernel *kernel = new Kernel();
+	kernel->channel_count = p_impulse_response_channel_count;
+	kernel->partition_count = partition_count;
+	kernel->head.resize((size_t)kernel->channel_count * block, 0.0f);
+	kernel->tail_real.resize((size_t)kernel->channel_count * MAX(partition_count, 1) * fft_size, 0.0f);
+	kernel->tail_imag.resize(kernel->tail_real.size(), 0.0f);
+
+	const float *samples = p_impulse_response.ptr();
+	int channels = kernel->channel_count;
+	for (int channel = 0; channel < channels; channel++) {
+		// head taps are stored reversed so the direct form is a contiguous dot product
+		float *head = &kernel->head[(size_t)channel * block];
+		for (int i = 0; i < block && i < length; i++) {
+			head[block - 1 - i] = samples[i * channels + channel];
+		}
+		for (int partition = 0; partition < partition_count; partition++) {
+			size_t offset = ((size_t)channel * partition_count + partition) * fft_size;
+			float *real = &kernel->tail_real[offset];
+			float *imag = &kernel->tail_imag[offset];
+			for (int i = 0; i < block; i++) {
+				int index = block + partition * block + i;
+				real[i] = index < length ? samples[index * channels + channel] : 0.0f;
+			}
+			fft.forward(real, imag);
+		}
+	}
+	return kernel;
+}
+
+void PortAudioConvolver::collect() {
+	Kernel *retired = retired_kernel.exchange(nullptr, std::memory_order_acquire);
+	if (retired) {
+		delete retired;
+	}
+}
+
+void PortAudioConvolver::publish(Kernel *p_kernel) {
+	Kernel *replaced = pending_kernel.exchange(p_kernel, std::memory_order_acq_rel);
+	if (replaced) {
+		delete replaced;
+	}
+}
+
+bool PortAudioConvolver::prepare(int p_channel_count, double p_sample_rate) {
+	if (prepared) {
+		print_line("PortAudioConvolver::prepare: convolver is already attached to an open stream");
+		return false;
+	}
+	if (p_channel_count <= 0 || p_sample_rate <= 0 || impulse_response.size() == 0) {
+		return false;
+	}
+	channel_count = p_channel_count;
+	sample_rate = p_sample_rate;
+	int block = partition_size;
+	int fft_size = block * 2;
+	max_partitions = MAX(1, (int)(max_length * sample_rate) / block);
+	fft.setup(fft_size);
+
+	// delay lines are sized for the longest impulse response so later loads never allocate here
+	states.resize(channel_count);
+	for (int channel = 0; channel < channel_count; channel++) {
+		ChannelState &state = states[channel];
+		state.time_buffer.assign(fft_size, 0.0f);
+		state.fdl_real.assign((size_t)max_partitions * fft_size, 0.0f);
+		state.fdl_imag.assign((size_t)max_partitions * fft_size, 0.0f);
+		state.tail_output.assign(block, 0.0f);
+		state.fade_tail_output.assign(block, 0.0f);
+		state.scratch_real.assign(fft_size, 0.0f);
+		state.scratch_imag.assign(fft_size, 0.0f);
+	}
+	block_position = 0;
+	fdl_position = 0;
+	current_kernel = build_kernel(impulse_response, impulse_response_channel_count);
+	fade_kernel = nullptr;
+	prepared = true;
+	return true;
+}
+
+void PortAudioConvolver::release() {
+	if (load_thread.is_started()) {
+		load_thread.wait_to_finish();
+	}
+	prepared = false;
+	if (current_kernel) {
+		delete current_kernel;
+		current_kernel = nullptr;
+	}
+	if (fade_kernel) {
+		delete fade_kernel;
+		fade_kernel = nullptr;
+	}
+	Kernel *pending = pending_kernel.exchange(nullptr);
+	if (pending) {
+		delete pending;
+	}
+	collect();
+	states.clear();
+}
+
+void PortAudioConvolver::accumulate_tail(ChannelState &r_state, const Kernel *p_kernel, int p_kernel_channel, int p_newest_slot, float *r_output) {
+	int block = partition_size;
+	int fft_size = block * 2;
+	float *real = r_state.scratch_real.data();
+	float *imag = r_state.scratch_imag.data();
+	memset(real, 0, fft_size * sizeof(float));
+	memset(imag, 0, fft_size * sizeof(float));
+	for (int partition = 0; partition < p_kernel->partition_count; partition++) {
+		int slot = (p_newest_slot - partition + max_partitions) % max_partitions;
+		size_t kernel_offset = ((size_t)p_kernel_channel * p_kernel->partition_count + partition) * fft_size;
+		port_audio_complex_multiply_accumulate(&r_state.fdl_real[(size_t)slot * fft_size], &r_state.fdl_imag[(size_t)slot * fft_size],
+				&p_kernel->tail_real[kernel_offset], &p_kernel->tail_imag[kernel_offset], real, imag, fft_size);
+	}
+	fft.inverse(real, imag);
+	// overlap-save keeps the second half
+	memcpy(r_output, real + block, block * sizeof(float));
+}
+
+void PortAudioConvolver::run_segment(SegmentTask *p_task, int p_channel) {
+	ChannelState &state = states[p_channel];
+	int block = partition_size;
+	int fft_size = block * 2;
+	int kernel_channel = p_channel % current_kernel->channel_count;
+	const float *head = &current_kernel->head[(size_t)kernel_channel * block];
+	const float *fade_head = nullptr;
+	int fade_channel = 0;
+	if (fade_kernel) {
+		fade_channel = p_channel % fade_kernel->channel_count;
+		fade_head = &fade_kernel->head[(size_t)fade_channel * block];
+	}
+	if (p_task->kernel_swapped) {
+		// the tail already computed for this block belongs to the old kernel
+		memcpy(state.fade_tail_output.data(), state.tail_output.data(), block * sizeof(float));
+		accumulate_tail(state, current_kernel, kernel_channel, fdl_position, state.tail_output.data());
+	}
+
+	float *time_buffer = state.time_buffer.data();
+	for (int i = 0; i < p_task->frames; i++) {
+		int position = block_position + i;
+		float *sample = &p_task->buffer[(size_t)(p_task->offset + i) * channel_count + p_channel];
+		float input = *sample;
+		time_buffer[block + position] = input;
+
+		// first partition as direct form, no added latency
+		const float *history = &time_buffer[position + 1];
+		float wet = 0;
+		for (int k = 0; k < block; k++) {
+			wet += head[k] * history[k];
+		}
+		wet += state.tail_output[position];
+		if (fade_head) {
+			float fade_wet = state.fade_tail_output[position];
+			for (int k = 0; k < block; k++) {
+				fade_wet += fade_head[k] * history[k];
+			}
+			float fade = (float)position / block;
+			wet = wet * fade + fade_wet * (1.0f - fade);
+		}
+		*sample = dry_gain * input + wet_gain * wet;
+	}
+
+	if (block_position + p_task->frames == block) {
+		int slot = (fdl_position + 1) % max_partitions;
+		float *real = &state.fdl_real[(size_t)slot * fft_size];
+		float *imag = &state.fdl_imag[(size_t)slot * fft_size];
+		memcpy(real, time_buffer, fft_size * sizeof(float));
+		memset(imag, 0, fft_size * sizeof(float));
+		fft.forward(real, imag);
+		memmove(time_buffer, time_buffer + block, block * sizeof(float));
+
+		// the remaining partitions produce the tail of the next block
+		accumulate_tail(state, current_kernel, kernel_channel, slot, state.tail_output.data());
+	}
+}
+
+void PortAudioConvolver::run_segment_task(void *p_user_data, int p_channel) {
+	SegmentTask *task = (SegmentTask *)p_user_data;
+	task->convolver->run_segment(task, p_channel);
+}
+
+void PortAudioConvolver::process(float *p_buffer, unsigned long p_frames, PortAudioWorkerPool *p_worker_pool) {
+	if (!prepared || !current_kernel) {
+		return;
+	}
+	int block = partition_size;
+	int offset = 0;
+	while (offset < (int)p_frames) {
+		SegmentTask task;
+		task.convolver = this;
+		task.buffer = p_buffer;
+		task.offset = offset;
+		task.frames = MIN((int)p_frames - offset, block - block_position);
+		task.kernel_swapped = false;
+
+		// new impulse responses are only picked up at partition boundaries
+		if (block_position == 0 && !fade_kernel && retired_kernel.load(std::memory_order_acquire) == nullptr) {
+			Kernel *next = pending_kernel.exchange(nullptr, std::memory_order_acq_rel);
+			if (next) {
+				fade_kernel = current_kernel;
+				current_kernel = next;
+				task.kernel_swapped = true;
+			}
+		}
+
+		if (p_worker_pool && p_worker_pool->get_worker_count() > 0 && channel_count > 1) {
+			uint64_t budget_usec = (uint64_t)(task.frames * 500000.0 / sample_rate);
+			p_worker_pool->execute(&PortAudioConvolver::run_segment_task, &task, channel_count, budget_usec);
+		} else {
+			for (int channel = 0; channel < channel_count; channel++) {
+				run_segment(&task, channel);
+			}
+		}
+
+		block_position += task.frames;
+		offset += task.frames;
+		if (block_position == block) {
+			block_position = 0;
+			fdl_position = (fdl_position + 1) % max_partitions;
+			if (fade_kernel) {
+				// crossfade finished, the main thread frees the old kernel
+				retired_kernel.store(fade_kernel, std::memory_order_release);
+				fade_kernel = nullptr;
+			}
+		}
+	}
+}
+
+void PortAudioConvolver::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_partition_size"), &PortAudioConvolver::get_partition_size);
+	ClassDB::bind_method(D_METHOD("set_partition_size", "partition_size"), &PortAudioConvolver::set_partition_size);
+	ClassDB::bind_method(D_METHOD("get_max_length"), &PortAudioConvolver::get_max_length);
+	ClassDB::bind_method(D_METHOD("set_max_length", "max_length"), &PortAudioConvolver::set_max_length);
+	ClassDB::bind_method(D_METHOD("get_wet_gain"), &PortAudioConvolver::get_wet_gain);
+	ClassDB::bind_method(D_METHOD("set_wet_gain", "wet_gain"), &PortAudioConvolver::set_wet_gain);
+	ClassDB::bind_method(D_METHOD("get_dry_gain"), &PortAudioConvolver::get_dry_gain);
+	ClassDB::bind_method(D_METHOD("set_dry_gain", "dry_gain"), &PortAudioConvolver::set_dry_gain);
+	ClassDB::bind_method(D_METHOD("get_impulse_response"), &PortAudioConvolver::get_impulse_response);
+	ClassDB::bind_method(D_METHOD("set_impulse_response", "impulse_response", "channel_count"), &PortAudioConvolver::set_impulse_response, DEFVAL(1));
+	ClassDB::bind_method(D_METHOD("is_loading"), &PortAudioConvolver::is_loading);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "partition_size"), "set_partition_size", "get_partition_size");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_length"), "set_max_length", "get_max_length");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "wet_gain"), "set_wet_gain", "get_wet_gain");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "dry_gain"), "set_dry_gain", "get_dry_gain");
+
+	ADD_SIGNAL(MethodInfo("impulse_response_loaded"));
+}
+
+PortAudioConvolver::PortAudioConvolver() {
+	impulse_response_channel_count = 1;
+	partition_size = 256;
+	max_length = 5.0;
+	wet_gain = 1.0f;
+	dry_gain = 0.0f;
+	prepared = false;
+	channel_count = 0;
+	sample_rate = 0;
+	max_partitions = 0;
+	block_position = 0;
+	fdl_position = 0;
+	current_kernel = nullptr;
+	fade_kernel = nullptr;
+	pending_kernel.store(nullptr);
+	retired_kernel.store(nullptr);
+	load_impulse_response_channel_count = 1;
+	loading.store(false);
+}
+
+PortAudioConvolver::~PortAudioConvolver() {
+	release();
+}
@@ -0,0 +1,102 @@
+#ifndef PORT_AUDIO_CONVOLVER_H
+#define PORT_AUDIO_CONVOLVER_H
+
+#include "port_audio_fft.h"
+#include "port_audio_worker_pool.h"
+
+#include "core/io/resource.h"
+#include "core/os/thread.h"
+
+#include <atomic>
+#include <vector>
+
+class PortAudioConvolver : public Resource {
+	GDCLASS(PortAudioConvolver, Resource);
+
+private:
+	// frequency domain partitions of one impulse response, immutable once published
+	struct Kernel {
+		int channel_count;
+		int partition_count;
+		std::vector<float> head;
+		std::vector<float> tail_real;
+		std::vector<float> tail_imag;
+	};
+
+	struct ChannelState {
+		std::vector<float> time_buffer;
+		std::vector<float> fdl_real;
+		std::vector<float> fdl_imag;
+		std::vector<float> tail_output;
+		std::vector<float> fade_tail_output;
+		std::vector<float> scratch_real;
+		std::vector<float> scratch_imag;
+	};
+
+	struct SegmentTask {
+		PortAudioConvolver *convolver;
+		float *buffer;
+		int offset;
+		int frames;
+		bool kernel_swapped;
+	};
+
+	PackedFloat32Array impulse_response;
+	int impulse_response_channel_count;
+	int partition_size;
+	double max_length;
+	float wet_gain;
+	float dry_gain;
+
+	bool prepared;
+	int channel_count;
+	double sample_rate;
+	int max_partitions;
+	PortAudioFFT fft;
+	std::vector<ChannelState> states;
+	int block_position;
+	int fdl_position;
+	Kernel *current_kernel;
+	Kernel *fade_kernel;
+	std::atomic<Kernel *> pending_kernel;
+	// handed back by the audio thread after the crossfade, freed on the main thread by the next load or release
+	std::atomic<Kernel *> retired_kernel;
+
+	Thread load_thread;
+	PackedFloat32Array load_impulse_response;
+	int load_impulse_response_channel_count;
+	std::atomic<bool> loading;
+
+	Kernel *build_kernel(const PackedFloat32Array &p_impulse_response, int p_impulse_response_channel_count);
+	void publish(Kernel *p_kernel);
+	void collect();
+	static void load_thread_main(void *p_convolver);
+	static void run_segment_task(void *p_user_data, int p_channel);
+	void accumulate_tail(ChannelState &r_state, const Kernel *p_kernel, int p_kernel_channel, int p_newest_slot, float *r_output);
+	void run_segment(SegmentTask *p_task, int p_channel);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_partition_size(int p_partition_size);
+	int get_partition_size();
+	void set_max_length(double p_max_length);
+	double get_max_length();
+	void set_wet_gain(float p_wet_gain);
+	float get_wet_gain();
+	void set_dry_gain(float p_dry_gain);
+	float get_dry_gain();
+	Error set_impulse_response(PackedFloat32Array p_impulse_response, int p_channel_count);
+	PackedFloat32Array get_impulse_response();
+	bool is_loading();
+
+	bool prepare(int p_channel_count, double p_sample_rate);
+	void release();
+	void process(float *p_buffer, unsigned long p_frames, PortAudioWorkerPool *p_worker_pool);
+
+	PortAudioConvolver();
+	~PortAudioConvolver();
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "port_audio_device_changes.h"
+
+#include "core/templates/vector.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#elif defined(__APPLE__)
+#include <CoreAudio/CoreAudio.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#include <mmsystem.h>
+#ifndef DRVM_MAPPER_PREFERRED_GET
+#define DRVM_MAPPER_PREFERRED_GET (0x2000 + 21)
+#endif
+#endif
+
+#if defined(__APPLE__)
+static String get_core_audio_token(AudioObjectPropertySelector p_selector) {
+	AudioObjectPropertyAddress address = { p_selector, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster };
+	UInt32 size = 0;
+	if (AudioObjectGetPropertyDataSize(kAudioObjectSystemObject, &address, 0, nullptr, &size) != noErr || size == 0) {
+		return String();
+	}
+	Vector<AudioObjectID> ids;
+	ids.resize(size / sizeof(AudioObjectID));
+	if (AudioObjectGetPropertyData(kAudioObjectSystemObject, &address, 0, nullptr, &size, ids.ptrw()) != noErr) {
+		return String();
+	}
+	String token;
+	for (int i = 0; i < ids.size(); i++) {
+		token += itos(ids[i]) + ";";
+	}
+	return token;
+}
+#endif
+
+String PortAudioDeviceChanges::get_token() {
+#if defined(__linux__)
+	// alsa creates and removes the /dev/snd nodes on hot-plug, listing them is far cheaper than Pa_Initialize
+	Vector<String> entries;
+	DIR *dir = opendir("/dev/snd");
+	if (dir == nullptr) {
+		return String();
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != nullptr) {
+		entries.push_back(String(entry->d_name));
+	}
+	closedir(dir);
+	entries.sort();
+	String token;
+	for (int i = 0; i < entries.size(); i++) {
+		token += entries[i] + ";";
+	}
+	return token;
+#elif defined(__APPLE__)
+	// core audio object ids are unique per device connection
+	return get_core_audio_token(kAudioHardwarePropertyDevices) + "|" +
+			get_core_audio_token(kAudioHardwarePropertyDefaultInputDevice) + "|" +
+			get_core_audio_token(kAudioHardwarePropertyDefaultOutputDevice);
+#elif defined(_WIN32)
+	// the multimedia api mirrors the endpoint list and the preferred devices without initializing any host api
+	String token;
+	UINT output_count = waveOutGetNumDevs();
+	for (UINT i = 0; i < output_count; i++) {
+		WAVEOUTCAPSW caps;
+		if (waveOutGetDevCapsW(i, &caps, sizeof(caps)) == MMSYSERR_NOERROR) {
+			token += String((const wchar_t *)caps.szPname) + ";";
+		}
+	}
+	token += "|";
+	UINT input_count = waveInGetNumDevs();
+	for (UINT i = 0; i < input_count; i++) {
+		WAVEINCAPSW caps;
+		if (waveInGetDevCapsW(i, &caps, sizeof(caps)) == MMSYSERR_NOERROR) {
+			token += String((const wchar_t *)caps.szPname) + ";";
+		}
+	}
+	DWORD preferred = 0;
+	DWORD flags = 0;
+	if (waveOutMessage((HWAVEOUT)WAVE_MAPPER, DRVM_MAPPER_PREFERRED_GET, (DWORD_PTR)&preferred, (DWORD_PTR)&flags) == MMSYSERR_NOERROR) {
+		token += "|" + itos(preferred);
+	}
+	if (waveInMessage((HWAVEIN)WAVE_MAPPER, DRVM_MAPPER_PREFERRED_GET, (DWORD_PTR)&preferred, (DWORD_PTR)&flags) == MMSYSERR_NOERROR) {
+		token += "|" + itos(preferred);
+	}
+	return token;
+#else
+	return String();
+#endif
+}
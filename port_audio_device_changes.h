@@ -0,0 +1,14 @@
+#ifndef PORT_AUDIO_DEVICE_CHANGES_H
+#define PORT_AUDIO_DEVICE_CHANGES_H
+
+#include "core/string/ustring.h"
+
+// platform code lives here so port_audio.cpp never sees windows.h (NO_ERROR is a macro there)
+class PortAudioDeviceChanges {
+public:
+	// changes whenever the os adds or removes an audio device or changes a default device. an empty token means the
+	// platform offers no cheap change signal, the library is never re-initialized on a guess
+	static String get_token();
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include "port_audio_fft.h"
+
+#include "core/math/math_funcs.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define PORT_AUDIO_FFT_SSE
+#endif
+
+int PortAudioFFT::get_size() const {
+	return size;
+}
+
+void PortAudioFFT::setup(int p_size) {
+	size = p_size;
+	int bits = 0;
+	while ((1 << bits) < size) {
+		bits++;
+	}
+	bit_reverse.resize(size);
+	for (int i = 0; i < size; i++) {
+		int reversed = 0;
+		for (int bit = 0; bit < bits; bit++) {
+			reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+		}
+		bit_reverse[i] = reversed;
+	}
+	cos_table.resize(size / 2);
+	sin_table.resize(size / 2);
+	for (int i = 0; i < size / 2; i++) {
+		cos_table[i] = (float)Math::cos(Math_TAU * i / size);
+		sin_table[i] = (float)Math::sin(Math_TAU * i / size);
+	}
+}
+
+void PortAudioFFT::transform(float *r_real, float *r_imag, bool p_inverse) const {
+	for (int i = 0; i < size; i++) {
+		int j = bit_reverse[i];
+		if (j > i) {
+			float real = r_real[i];
+			r_real[i] = r_real[j];
+			r_real[j] = real;
+			float imag = r_imag[i];
+			r_imag[i] = r_imag[j];
+			r_imag[j] = imag;
+		}
+	}
+	float direction = p_inverse ? 1.0f : -1.0f;
+	for (int length = 2; length <= size; length <<= 1) {
+		int half = length >> 1;
+		int step = size / length;
+		for (int start = 0; start < size; start += length) {
+			for (int k = 0; k < half; k++) {
+				float w_real = cos_table[k * step];
+				float w_imag = direction * sin_table[k * step];
+				int even = start + k;
+				int odd = even + half;
+				float t_real = r_real[odd] * w_real - r_imag[odd] * w_imag;
+				float t_imag = r_real[odd] * w_imag + r_imag[odd] * w_real;
+				r_real[odd] = r_real[even] - t_real;
+				r_imag[odd] = r_imag[even] - t_imag;
+				r_real[even] += t_real;
+				r_imag[even] += t_imag;
+			}
+		}
+	}
+}
+
+void PortAudioFFT::forward(float *r_real, float *r_imag) const {
+	transform(r_real, r_imag, false);
+}
+
+void PortAudioFFT::inverse(float *r_real, float *r_imag) const {
+	transform(r_real, r_imag, true);
+	float scale = 1.0f / size;
+	for (int i = 0; i < size; i++) {
+		r_real[i] *= scale;
+		r_imag[i] *= scale;
+	}
+}
+
+PortAudioFFT::PortAudioFFT() {
+	size = 0;
+}
+
+void port_audio_complex_multiply_accumulate(const float *p_a_real, const float *p_a_imag, const float *p_b_real, const float *p_b_imag, float *r_real, float *r_imag, int p_count) {
+	int i = 0;
+#ifdef PORT_AUDIO_FFT_SSE
+	for (; i + 4 <= p_count; i += 4) {
+		__m128 a_real = _mm_loadu_ps(p_a_real + i);
+		__m128 a_imag = _mm_loadu_ps(p_a_imag + i);
+		__m128 b_real = _mm_loadu_ps(p_b_real + i);
+		__m128 b_imag = _mm_loadu_ps(p_b_imag + i);
+		__m128 real = _mm_sub_ps(_mm_mul_ps(a_real, b_real), _mm_mul_ps(a_imag, b_imag));
+		__m128 imag = _mm_add_ps(_mm_mul_ps(a_real, b_imag), _mm_mul_ps(a_imag, b_real));
+		_mm_storeu_ps(r_real + i, _mm_add_ps(_mm_loadu_ps(r_real + i), real));
+		_mm_storeu_ps(r_imag + i, _mm_add_ps(_mm_loadu_ps(r_imag + i), imag));
+	}
+#endif
+	for (; i < p_count; i++) {
+		r_real[i] += p_a_real[i] * p_b_real[i] - p_a_imag[i] * p_b_imag[i];
+		r_imag[i] += p_a_real[i] * p_b_imag[i] + p_a_imag[i] * p_b_real[i];
+	}
+}
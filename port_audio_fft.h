@@ -0,0 +1,29 @@
+#ifndef PORT_AUDIO_FFT_H
+#define PORT_AUDIO_FFT_H
+
+#include <vector>
+
+// radix-2 complex fft on split real / imaginary arrays, tables are built once per size
+class PortAudioFFT {
+private:
+	int size;
+	std::vector<int> bit_reverse;
+	std::vector<float> cos_table;
+	std::vector<float> sin_table;
+
+	void transform(float *r_real, float *r_imag, bool p_inverse) const;
+
+public:
+	int get_size() const;
+	void setup(int p_size);
+	void forward(float *r_real, float *r_imag) const;
+	// scaled by 1 / size
+	void inverse(float *r_real, float *r_imag) const;
+
+	PortAudioFFT();
+};
+
+// r_real / r_imag += a * b, the inner loop of every frequency domain convolution
+void port_audio_complex_multiply_accumulate(const float *p_a_real, const float *p_a_imag, const float *p_b_real, const float *p_b_imag, float *r_real, float *r_imag, int p_count);
+
+#endif
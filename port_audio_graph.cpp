@@ -0,0 +1,537 @@
+#include "port_audio_graph.h"
+
+#include "core/math/math_funcs.h"
+
+#include <string.h>
+
+int PortAudioGraph::add_node(PortAudioGraphNodeType p_type, Dictionary p_parameters) {
+	GraphNode node;
+	node.type = p_type;
+	node.gain = 1.0f;
+	node.frequency = 1000.0f;
+	node.q = Math_SQRT12;
+	node.analyzer_slot = -1;
+	if (p_type == ANALYZER) {
+		for (int slot = 0; slot < MAX_ANALYZERS; slot++) {
+			if (!analyzer_slot_used[slot]) {
+				analyzer_slot_used[slot] = true;
+				node.analyzer_slot = slot;
+				break;
+			}
+		}
+		if (node.analyzer_slot < 0) {
+			print_line(vformat("PortAudioGraph::add_node: analyzer limit (%d) reached", MAX_ANALYZERS));
+			return -1;
+		}
+		analyzer_peak[node.analyzer_slot].store(0);
+		analyzer_square_sum[node.analyzer_slot].store(0);
+		analyzer_frames[node.analyzer_slot].store(0);
+	}
+	Array keys = p_parameters.keys();
+	for (int i = 0; i < keys.size(); i++) {
+		String key = keys[i];
+		if (!apply_parameter(node, key, p_parameters[key])) {
+			print_line(vformat("PortAudioGraph::add_node: unknown parameter %s", key));
+		}
+	}
+	int node_id = next_node_id++;
+	nodes[node_id] = node;
+	if (prepared) {
+		publish(compile());
+	}
+	return node_id;
+}
+
+void PortAudioGraph::remove_node(int p_node_id) {
+	std::map<int, GraphNode>::iterator it = nodes.find(p_node_id);
+	if (it == nodes.end()) {
+		return;
+	}
+	if (it->second.analyzer_slot >= 0) {
+		analyzer_slot_used[it->second.analyzer_slot] = false;
+	}
+	nodes.erase(it);
+	for (int i = (int)connections.size() - 1; i >= 0; i--) {
+		if (connections[i].from == p_node_id || connections[i].to == p_node_id) {
+			connections.erase(connections.begin() + i);
+		}
+	}
+	if (prepared) {
+		publish(compile());
+	}
+}
+
+bool PortAudioGraph::apply_parameter(GraphNode &r_node, const String &p_name, const Variant &p_value) {
+	if (p_name == "gain") {
+		r_node.gain = p_value;
+	} else if (p_name == "frequency") {
+		r_node.frequency = p_value;
+	} else if (p_name == "q") {
+		r_node.q = p_value;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+void PortAudioGraph::set_node_parameter(int p_node_id, String p_name, Variant p_value) {
+	std::map<int, GraphNode>::iterator it = nodes.find(p_node_id);
+	if (it == nodes.end()) {
+		print_line(vformat("PortAudioGraph::set_node_parameter: node %d not found", p_node_id));
+		return;
+	}
+	if (!apply_parameter(it->second, p_name, p_value)) {
+		print_line(vformat("PortAudioGraph::set_node_parameter: unknown parameter %s", p_name));
+		return;
+	}
+	if (prepared) {
+		publish(compile());
+	}
+}
+
+Error PortAudioGraph::connect_nodes(int p_from, int p_to) {
+	if (nodes.find(p_from) == nodes.end() || nodes.find(p_to) == nodes.end()) {
+		return ERR_DOES_NOT_EXIST;
+	}
+	if (nodes[p_from].type == OUTPUT || nodes[p_to].type == INPUT) {
+		return ERR_INVALID_PARAMETER;
+	}
+	for (size_t i = 0; i < connections.size(); i++) {
+		if (connections[i].from == p_from && connections[i].to == p_to) {
+			return ERR_ALREADY_EXISTS;
+		}
+	}
+	connections.push_back({ p_from, p_to });
+	if (prepared) {
+		Program *program = compile();
+		if (!program) {
+			connections.pop_back();
+			return ERR_CYCLIC_LINK;
+		}
+		publish(program);
+	}
+	return OK;
+}
+
+void PortAudioGraph::disconnect_nodes(int p_from, int p_to) {
+	for (size_t i = 0; i < connections.size(); i++) {
+		if (connections[i].from == p_from && connections[i].to == p_to) {
+			connections.erase(connections.begin() + i);
+			if (prepared) {
+				publish(compile());
+			}
+			return;
+		}
+	}
+}
+
+void PortAudioGraph::clear() {
+	nodes.clear();
+	connections.clear();
+	for (int slot = 0; slot < MAX_ANALYZERS; slot++) {
+		analyzer_slot_used[slot] = false;
+	}
+	if (prepared) {
+		publish(compile());
+	}
+}
+
+float PortAudioGraph::get_analyzer_peak(int p_node_id) {
+	std::map<int, GraphNode>::iterator it = nodes.find(p_node_id);
+	if (it == nodes.end() || it->second.analyzer_slot < 0) {
+		return 0;
+	}
+	// peak since the last read
+	return analyzer_peak[it->second.analyzer_slot].exchange(0, std::memory_order_relaxed);
+}
+
+float PortAudioGraph::get_analyzer_rms(int p_node_id) {
+	std::map<int, GraphNode>::iterator it = nodes.find(p_node_id);
+	if (it == nodes.end() || it->second.analyzer_slot < 0) {
+		return 0;
+	}
+	// rms over all channels since the last read. frames are taken first, a block landing in between is counted next time
+	uint64_t frames = analyzer_frames[it->second.analyzer_slot].exchange(0, std::memory_order_relaxed);
+	double square_sum = analyzer_square_sum[it->second.analyzer_slot].exchange(0, std::memory_order_relaxed);
+	if (frames == 0) {
+		return 0;
+	}
+	return (float)Math::sqrt(square_sum / frames);
+}
+
+PortAudioGraph::Program *PortAudioGraph::compile() {
+	// topological sort (kahn), a cycle leaves nodes unsorted
+	std::map<int, int> in_degree;
+	for (std::map<int, GraphNode>::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+		in_degree[it->first] = 0;
+	}
+	for (size_t i = 0; i < connections.size(); i++) {
+		in_degree[connections[i].to]++;
+	}
+	std::vector<int> order;
+	for (std::map<int, int>::iterator it = in_degree.begin(); it != in_degree.end(); ++it) {
+		if (it->second == 0) {
+			order.push_back(it->first);
+		}
+	}
+	for (size_t i = 0; i < order.size(); i++) {
+		for (size_t c = 0; c < connections.size(); c++) {
+			if (connections[c].from == order[i] && --in_degree[connections[c].to] == 0) {
+				order.push_back(connections[c].to);
+			}
+		}
+	}
+	if (order.size() != nodes.size()) {
+		print_line("PortAudioGraph::compile: graph contains a cycle");
+		return nullptr;
+	}
+
+	// prune nodes that neither reach an output nor an analyzer
+	std::map<int, bool> live;
+	for (int i = (int)order.size() - 1; i >= 0; i--) {
+		int node_id = order[i];
+		PortAudioGraphNodeType type = nodes[node_id].type;
+		bool is_live = type == OUTPUT || type == ANALYZER;
+		for (size_t c = 0; c < connections.size() && !is_live; c++) {
+			if (connections[c].from == node_id && live[connections[c].to]) {
+				is_live = true;
+			}
+		}
+		live[node_id] = is_live;
+	}
+	std::vector<int> schedule;
+	std::map<int, int> position;
+	for (size_t i = 0; i < order.size(); i++) {
+		if (live[order[i]]) {
+			position[order[i]] = (int)schedule.size();
+			schedule.push_back(order[i]);
+		}
+	}
+
+	// liveness: a slot can be reused once its last consumer has run
+	std::map<int, int> last_use;
+	for (size_t i = 0; i < schedule.size(); i++) {
+		last_use[schedule[i]] = nodes[schedule[i]].type == OUTPUT ? (int)schedule.size() : (int)i;
+	}
+	for (size_t c = 0; c < connections.size(); c++) {
+		if (live[connections[c].from] && live[connections[c].to]) {
+			int consumer = position[connections[c].to];
+			if (consumer > last_use[connections[c].from]) {
+				last_use[connections[c].from] = consumer;
+			}
+		}
+	}
+
+	Program *program = new Program();
+	program->slot_count = 0;
+	program->input_slot = -1;
+	program->output_slot = -1;
+	program->channel_count = channel_count;
+	std::vector<int> free_slots;
+	std::map<int, int> node_slot;
+	int state_count = 0;
+	for (size_t i = 0; i < schedule.size(); i++) {
+		int node_id = schedule[i];
+		const GraphNode &node = nodes[node_id];
+		Operation operation;
+		memset(&operation, 0, sizeof(Operation));
+		operation.node_id = node_id;
+		operation.type = node.type;
+		operation.gain = node.gain;
+		operation.analyzer_slot = node.analyzer_slot;
+		operation.state_offset = -1;
+		if (free_slots.empty()) {
+			operation.output_slot = program->slot_count++;
+		} else {
+			operation.output_slot = free_slots.back();
+			free_slots.pop_back();
+		}
+		node_slot[node_id] = operation.output_slot;
+
+		operation.input_offset = (int)program->operation_inputs.size();
+		for (size_t c = 0; c < connections.size(); c++) {
+			if (connections[c].to == node_id && live[connections[c].from]) {
+				program->operation_inputs.push_back(node_slot[connections[c].from]);
+			}
+		}
+		operation.input_count = (int)program->operation_inputs.size() - operation.input_offset;
+
+		if (node.type == LOW_PASS || node.type == HIGH_PASS) {
+			double w0 = Math_TAU * CLAMP((double)node.frequency, 1.0, sample_rate * 0.49) / sample_rate;
+			double alpha = Math::sin(w0) / (2.0 * MAX((double)node.q, 0.01));
+			double cos_w0 = Math::cos(w0);
+			double a0 = 1.0 + alpha;
+			if (node.type == LOW_PASS) {
+				operation.b0 = (float)((1.0 - cos_w0) / 2.0 / a0);
+				operation.b1 = (float)((1.0 - cos_w0) / a0);
+			} else {
+				operation.b0 = (float)((1.0 + cos_w0) / 2.0 / a0);
+				operation.b1 = (float)(-(1.0 + cos_w0) / a0);
+			}
+			operation.b2 = operation.b0;
+			operation.a1 = (float)(-2.0 * cos_w0 / a0);
+			operation.a2 = (float)((1.0 - alpha) / a0);
+			operation.state_offset = state_count;
+			state_count += 2;
+		}
+		if (node.type == INPUT) {
+			program->input_slot = operation.output_slot;
+		} else if (node.type == OUTPUT) {
+			program->output_slot = operation.output_slot;
+		}
+
+		for (int input = 0; input < operation.input_count; input++) {
+			int input_slot = program->operation_inputs[operation.input_offset + input];
+			for (size_t c = 0; c < connections.size(); c++) {
+				if (connections[c].to == node_id && node_slot[connections[c].from] == input_slot && last_use[connections[c].from] == (int)i) {
+					free_slots.push_back(input_slot);
+					break;
+				}
+			}
+		}
+		if (last_use[node_id] == (int)i) {
+			free_slots.push_back(operation.output_slot);
+		}
+		program->operations.push_back(operation);
+	}
+
+	program->slots.resize((size_t)channel_count * MAX(program->slot_count, 1) * MAX_BLOCK_FRAMES);
+	program->states.resize((size_t)channel_count * MAX(state_count, 1));
+	return program;
+}
+
+void PortAudioGraph::collect() {
+	Program *retired = retired_program.exchange(nullptr, std::memory_order_acquire);
+	if (retired) {
+		delete retired;
+	}
+}
+
+void PortAudioGraph::publish(Program *p_program) {
+	if (!p_program) {
+		return;
+	}
+	collect();
+	Program *replaced = pending_program.exchange(p_program, std::memory_order_acq_rel);
+	if (replaced) {
+		// never picked up by the audio thread
+		delete replaced;
+	}
+}
+
+bool PortAudioGraph::prepare(int p_channel_count, double p_sample_rate) {
+	if (prepared) {
+		print_line("PortAudioGraph::prepare: graph is already attached to an open stream");
+		return false;
+	}
+	if (p_channel_count <= 0 || p_sample_rate <= 0) {
+		return false;
+	}
+	channel_count = p_channel_count;
+	sample_rate = p_sample_rate;
+	current_program = compile();
+	if (!current_program) {
+		return false;
+	}
+	prepared = true;
+	return true;
+}
+
+void PortAudioGraph::release() {
+	prepared = false;
+	if (current_program) {
+		delete current_program;
+		current_program = nullptr;
+	}
+	Program *pending = pending_program.exchange(nullptr);
+	if (pending) {
+		delete pending;
+	}
+	collect();
+}
+
+void PortAudioGraph::run_channel(Program *p_program, float *p_buffer, unsigned long p_frames, int p_channel) {
+	int channels = p_program->channel_count;
+	float *slots = &p_program->slots[(size_t)p_channel * p_program->slot_count * MAX_BLOCK_FRAMES];
+	float *states = &p_program->states[(size_t)p_channel * (p_program->states.size() / channels)];
+	const int *operation_inputs = p_program->operation_inputs.data();
+
+	for (unsigned long block_start = 0; block_start < p_frames; block_start += MAX_BLOCK_FRAMES) {
+		int frames = (int)MIN((unsigned long)MAX_BLOCK_FRAMES, p_frames - block_start);
+		float *interleaved = p_buffer + block_start * channels + p_channel;
+
+		for (size_t o = 0; o < p_program->operations.size(); o++) {
+			const Operation &operation = p_program->operations[o];
+			float *output = &slots[operation.output_slot * MAX_BLOCK_FRAMES];
+			if (operation.type == INPUT) {
+				for (int i = 0; i < frames; i++) {
+					output[i] = interleaved[i * channels];
+				}
+				continue;
+			}
+			if (operation.input_count == 0) {
+				memset(output, 0, frames * sizeof(float));
+			} else {
+				const float *first = &slots[operation_inputs[operation.input_offset] * MAX_BLOCK_FRAMES];
+				memcpy(output, first, frames * sizeof(float));
+				for (int input_index = 1; input_index < operation.input_count; input_index++) {
+					const float *source = &slots[operation_inputs[operation.input_offset + input_index] * MAX_BLOCK_FRAMES];
+					for (int i = 0; i < frames; i++) {
+						output[i] += source[i];
+					}
+				}
+			}
+
+			switch (operation.type) {
+				case OUTPUT:
+				case GAIN:
+				case MIXER: {
+					if (operation.gain != 1.0f) {
+						for (int i = 0; i < frames; i++) {
+							output[i] *= operation.gain;
+						}
+					}
+				} break;
+				case LOW_PASS:
+				case HIGH_PASS: {
+					float z1 = states[operation.state_offset];
+					float z2 = states[operation.state_offset + 1];
+					for (int i = 0; i < frames; i++) {
+						float x = output[i];
+						float y = operation.b0 * x + z1;
+						z1 = operation.b1 * x - operation.a1 * y + z2;
+						z2 = operation.b2 * x - operation.a2 * y;
+						output[i] = y;
+					}
+					states[operation.state_offset] = z1;
+					states[operation.state_offset + 1] = z2;
+				} break;
+				case ANALYZER: {
+					float peak = 0;
+					float sum = 0;
+					for (int i = 0; i < frames; i++) {
+						float sample = output[i];
+						peak = MAX(peak, Math::abs(sample));
+						sum += sample * sample;
+					}
+					float stored = analyzer_peak[operation.analyzer_slot].load(std::memory_order_relaxed);
+					while (peak > stored && !analyzer_peak[operation.analyzer_slot].compare_exchange_weak(stored, peak, std::memory_order_relaxed)) {
+					}
+					// channels may run on different workers, the sum is added before the frames it covers
+					double square_sum = analyzer_square_sum[operation.analyzer_slot].load(std::memory_order_relaxed);
+					while (!analyzer_square_sum[operation.analyzer_slot].compare_exchange_weak(square_sum, square_sum + sum, std::memory_order_relaxed)) {
+					}
+					analyzer_frames[operation.analyzer_slot].fetch_add(frames, std::memory_order_relaxed);
+				} break;
+				default:
+					break;
+			}
+		}
+
+		const float *output = &slots[p_program->output_slot * MAX_BLOCK_FRAMES];
+		for (int i = 0; i < frames; i++) {
+			interleaved[i * channels] = output[i];
+		}
+	}
+}
+
+void PortAudioGraph::carry_state(const Program *p_from, Program *r_to) {
+	// filters that survive an edit keep their history, a reset would click
+	if (p_from->channel_count != r_to->channel_count) {
+		return;
+	}
+	size_t from_stride = p_from->states.size() / p_from->channel_count;
+	size_t to_stride = r_to->states.size() / r_to->channel_count;
+	for (size_t o = 0; o < r_to->operations.size(); o++) {
+		const Operation &operation = r_to->operations[o];
+		if (operation.state_offset < 0) {
+			continue;
+		}
+		for (size_t f = 0; f < p_from->operations.size(); f++) {
+			const Operation &previous = p_from->operations[f];
+			if (previous.node_id != operation.node_id || previous.state_offset < 0) {
+				continue;
+			}
+			for (int channel = 0; channel < r_to->channel_count; channel++) {
+				const float *from = &p_from->states[channel * from_stride + previous.state_offset];
+				float *to = &r_to->states[channel * to_stride + operation.state_offset];
+				to[0] = from[0];
+				to[1] = from[1];
+			}
+			break;
+		}
+	}
+}
+
+void PortAudioGraph::run_channel_task(void *p_user_data, int p_channel) {
+	ChannelTask *channel_task = (ChannelTask *)p_user_data;
+	channel_task->graph->run_channel(channel_task->program, channel_task->buffer, channel_task->frames, p_channel);
+}
+
+void PortAudioGraph::process(float *p_buffer, unsigned long p_frames, PortAudioWorkerPool *p_worker_pool) {
+	// swap in an edited graph at the period boundary, the main thread frees the old one
+	if (retired_program.load(std::memory_order_acquire) == nullptr) {
+		Program *next = pending_program.exchange(nullptr, std::memory_order_acq_rel);
+		if (next) {
+			if (current_program) {
+				carry_state(current_program, next);
+			}
+			retired_program.store(current_program, std::memory_order_release);
+			current_program = next;
+		}
+	}
+	Program *program = current_program;
+	if (!program || program->input_slot < 0 || program->output_slot < 0) {
+		return;
+	}
+	if (p_worker_pool && p_worker_pool->get_worker_count() > 0 && program->channel_count > 1) {
+		// channels are independent, split them across the pool within half the period
+		ChannelTask channel_task = { this, program, p_buffer, p_frames };
+		uint64_t budget_usec = (uint64_t)(p_frames * 500000.0 / sample_rate);
+		p_worker_pool->execute(&PortAudioGraph::run_channel_task, &channel_task, program->channel_count, budget_usec);
+		return;
+	}
+	for (int channel = 0; channel < program->channel_count; channel++) {
+		run_channel(program, p_buffer, p_frames, channel);
+	}
+}
+
+void PortAudioGraph::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("add_node", "type", "parameters"), &PortAudioGraph::add_node, DEFVAL(Dictionary()));
+	ClassDB::bind_method(D_METHOD("remove_node", "node_id"), &PortAudioGraph::remove_node);
+	ClassDB::bind_method(D_METHOD("set_node_parameter", "node_id", "name", "value"), &PortAudioGraph::set_node_parameter);
+	ClassDB::bind_method(D_METHOD("connect_nodes", "from", "to"), &PortAudioGraph::connect_nodes);
+	ClassDB::bind_method(D_METHOD("disconnect_nodes", "from", "to"), &PortAudioGraph::disconnect_nodes);
+	ClassDB::bind_method(D_METHOD("clear"), &PortAudioGraph::clear);
+	ClassDB::bind_method(D_METHOD("get_analyzer_peak", "node_id"), &PortAudioGraph::get_analyzer_peak);
+	ClassDB::bind_method(D_METHOD("get_analyzer_rms", "node_id"), &PortAudioGraph::get_analyzer_rms);
+
+	// PortAudioGraphNodeType
+	BIND_ENUM_CONSTANT(INPUT);
+	BIND_ENUM_CONSTANT(OUTPUT);
+	BIND_ENUM_CONSTANT(GAIN);
+	BIND_ENUM_CONSTANT(LOW_PASS);
+	BIND_ENUM_CONSTANT(HIGH_PASS);
+	BIND_ENUM_CONSTANT(MIXER);
+	BIND_ENUM_CONSTANT(ANALYZER);
+}
+
+PortAudioGraph::PortAudioGraph() {
+	next_node_id = 1;
+	for (int slot = 0; slot < MAX_ANALYZERS; slot++) {
+		analyzer_slot_used[slot] = false;
+		analyzer_peak[slot].store(0);
+		analyzer_square_sum[slot].store(0);
+		analyzer_frames[slot].store(0);
+	}
+	channel_count = 0;
+	sample_rate = 0;
+	prepared = false;
+	current_program = nullptr;
+	pending_program.store(nullptr);
+	retired_program.store(nullptr);
+}
+
+PortAudioGraph::~PortAudioGraph() {
+	release();
+}
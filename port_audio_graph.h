@@ -0,0 +1,124 @@
+#ifndef PORT_AUDIO_GRAPH_H
+#define PORT_AUDIO_GRAPH_H
+
+#include "port_audio_worker_pool.h"
+
+#include "core/io/resource.h"
+
+#include <atomic>
+#include <map>
+#include <vector>
+
+class PortAudioGraph : public Resource {
+	GDCLASS(PortAudioGraph, Resource);
+
+public:
+	enum PortAudioGraphNodeType {
+		INPUT = 0,
+		OUTPUT = 1,
+		GAIN = 2,
+		LOW_PASS = 3,
+		HIGH_PASS = 4,
+		MIXER = 5,
+		ANALYZER = 6,
+	};
+
+	enum {
+		MAX_ANALYZERS = 16,
+		MAX_BLOCK_FRAMES = 1024,
+	};
+
+private:
+	struct GraphNode {
+		PortAudioGraphNodeType type;
+		float gain;
+		float frequency;
+		float q;
+		int analyzer_slot;
+	};
+
+	struct GraphConnection {
+		int from;
+		int to;
+	};
+
+	struct Operation {
+		int node_id;
+		PortAudioGraphNodeType type;
+		int input_offset;
+		int input_count;
+		int output_slot;
+		float gain;
+		float b0, b1, b2, a1, a2;
+		int state_offset;
+		int analyzer_slot;
+	};
+
+	// flat execution list, built on the main thread and only read by the audio thread
+	struct Program {
+		std::vector<Operation> operations;
+		std::vector<int> operation_inputs;
+		std::vector<float> slots;
+		std::vector<float> states;
+		int slot_count;
+		int input_slot;
+		int output_slot;
+		int channel_count;
+	};
+
+	std::map<int, GraphNode> nodes;
+	std::vector<GraphConnection> connections;
+	int next_node_id;
+	bool analyzer_slot_used[MAX_ANALYZERS];
+	std::atomic<float> analyzer_peak[MAX_ANALYZERS];
+	// sum of squares and frame count since the last read, every channel adds to them
+	std::atomic<double> analyzer_square_sum[MAX_ANALYZERS];
+	std::atomic<uint64_t> analyzer_frames[MAX_ANALYZERS];
+
+	int channel_count;
+	double sample_rate;
+	bool prepared;
+
+	Program *current_program;
+	std::atomic<Program *> pending_program;
+	std::atomic<Program *> retired_program;
+
+	bool apply_parameter(GraphNode &r_node, const String &p_name, const Variant &p_value);
+	Program *compile();
+	void publish(Program *p_program);
+	void collect();
+	static void carry_state(const Program *p_from, Program *r_to);
+	struct ChannelTask {
+		PortAudioGraph *graph;
+		Program *program;
+		float *buffer;
+		unsigned long frames;
+	};
+
+	static void run_channel_task(void *p_user_data, int p_channel);
+	void run_channel(Program *p_program, float *p_buffer, unsigned long p_frames, int p_channel);
+
+protected:
+	static void _bind_methods();
+
+public:
+	int add_node(PortAudioGraphNodeType p_type, Dictionary p_parameters);
+	void remove_node(int p_node_id);
+	void set_node_parameter(int p_node_id, String p_name, Variant p_value);
+	Error connect_nodes(int p_from, int p_to);
+	void disconnect_nodes(int p_from, int p_to);
+	void clear();
+	float get_analyzer_peak(int p_node_id);
+	float get_analyzer_rms(int p_node_id);
+
+	bool prepare(int p_channel_count, double p_sample_rate);
+	void release();
+	void process(float *p_buffer, unsigned long p_frames, PortAudioWorkerPool *p_worker_pool);
+
+	PortAudioGraph();
+	~PortAudioGraph();
+};
+
+VARIANT_ENUM_CAST(PortAudioGraph::PortAudioGraphNodeType);
+
+#endif
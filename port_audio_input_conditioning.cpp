@@ -0,0 +1,340 @@
+#include "port_audio_input_conditioning.h"
+
+#include "core/math/math_funcs.h"
+#include "core/typedefs.h"
+
+#include <cmath>
+#include <cstring>
+
+// corner of the dc blocker, low enough to leave the voice band untouched
+#define CONDITIONING_DC_BLOCK_FREQUENCY 10.0
+// the agc measures the level over this window, short enough to follow speech, long enough to ignore single peaks
+#define CONDITIONING_AGC_LEVEL_TIME 0.05
+// 60 db below the target there is nothing left to bring up, the agc holds its gain
+#define CONDITIONING_AGC_FLOOR 1e-6f
+
+static float time_to_coefficient(double p_time, double p_sample_rate) {
+	if (p_time <= 0) {
+		return 1.0f;
+	}
+	return (float)(1.0 - Math::exp(-1.0 / (p_time * p_sample_rate)));
+}
+
+static float db_to_linear(float p_db) {
+	return powf(10.0f, p_db / 20.0f);
+}
+
+int PortAudioInputConditioner::get_channel_count() const {
+	return channel_count;
+}
+
+void PortAudioInputConditioner::process_sections(float *r_buffer, unsigned long p_frames) {
+	const int channels = channel_count;
+	for (size_t s = 0; s < sections.size(); s++) {
+		const Section section = sections[s];
+		float *state1 = &z1[s * channels];
+		float *state2 = &z2[s * channels];
+		for (unsigned long frame = 0; frame < p_frames; frame++) {
+			float *samples = r_buffer + frame * channels;
+			for (int c = 0; c < channels; c++) {
+				float x = samples[c];
+				float y = section.b0 * x + state1[c];
+				state1[c] = section.b1 * x - section.a1 * y + state2[c];
+				state2[c] = section.b2 * x - section.a2 * y;
+				samples[c] = y;
+			}
+		}
+		// a decaying filter on silence ends in denormals, which are slow on most cpus
+		for (int c = 0; c < channels; c++) {
+			if (Math::abs(state1[c]) < 1e-15f) {
+				state1[c] = 0.0f;
+			}
+			if (Math::abs(state2[c]) < 1e-15f) {
+				state2[c] = 0.0f;
+			}
+		}
+	}
+}
+
+void PortAudioInputConditioner::process(const float *p_input, float *r_output, unsigned long p_frames) {
+	const int channels = channel_count;
+	if (p_input != r_output) {
+		memcpy(r_output, p_input, p_frames * channels * sizeof(float));
+	}
+	process_sections(r_output, p_frames);
+	if (!gate_enabled && !agc_enabled) {
+		return;
+	}
+
+	// gate and agc share one detector over all channels, the same gain on every channel keeps the stereo image
+	const float channel_scale = 1.0f / channels;
+	for (unsigned long frame = 0; frame < p_frames; frame++) {
+		float *samples = r_output + frame * channels;
+		float peak = 0.0f;
+		float power = 0.0f;
+		for (int c = 0; c < channels; c++) {
+			float x = samples[c];
+			peak = MAX(peak, Math::abs(x));
+			power += x * x;
+		}
+		power *= channel_scale;
+
+		float gain = 1.0f;
+		bool open = true;
+		if (gate_enabled) {
+			envelope += (peak > envelope ? detector_attack : detector_release) * (peak - envelope);
+			open = envelope > gate_threshold;
+			float target = open ? 1.0f : 0.0f;
+			gate_gain += (open ? gate_attack : gate_release) * (target - gate_gain);
+			gain = gate_gain;
+		}
+		if (agc_enabled) {
+			// noise between words is not brought up, the gain is held while the gate is closed
+			if (open) {
+				level += level_coefficient * (power - level);
+			}
+			if (--agc_countdown <= 0) {
+				agc_countdown = AGC_UPDATE_FRAMES;
+				if (open && level > agc_target_power * CONDITIONING_AGC_FLOOR) {
+					agc_desired_gain = MIN(Math::sqrt(agc_target_power / level), agc_max_gain);
+				}
+			}
+			agc_gain += (agc_desired_gain < agc_gain ? agc_attack : agc_release) * (agc_desired_gain - agc_gain);
+			gain *= agc_gain;
+		}
+		for (int c = 0; c < channels; c++) {
+			samples[c] *= gain;
+		}
+	}
+	if (Math::abs(envelope) < 1e-15f) {
+		envelope = 0.0f;
+	}
+	if (level < 1e-20f) {
+		level = 0.0f;
+	}
+	float total_gain = (gate_enabled ? gate_gain : 1.0f) * (agc_enabled ? agc_gain : 1.0f);
+	last_gain_db.store(20.0f * log10f(total_gain + 1e-9f), std::memory_order_relaxed);
+	last_level_db.store(10.0f * log10f(level + 1e-12f), std::memory_order_relaxed);
+	gate_open.store(!gate_enabled || envelope > gate_threshold, std::memory_order_relaxed);
+}
+
+Dictionary PortAudioInputConditioner::get_stats() const {
+	Dictionary stats;
+	stats["gain_db"] = last_gain_db.load(std::memory_order_relaxed);
+	stats["level_db"] = last_level_db.load(std::memory_order_relaxed);
+	stats["gate_open"] = gate_open.load(std::memory_order_relaxed);
+	return stats;
+}
+
+PortAudioInputConditioner::PortAudioInputConditioner(int p_channel_count, const std::vector<Section> &p_sections, bool p_gate_enabled,
+		float p_gate_threshold_db, float p_gate_attack, float p_gate_release, bool p_agc_enabled, float p_agc_target_db, float p_agc_max_gain_db,
+		float p_agc_attack, float p_agc_release, double p_sample_rate) {
+	channel_count = MAX(p_channel_count, 1);
+	sections = p_sections;
+	z1.assign(sections.size() * channel_count, 0.0f);
+	z2.assign(sections.size() * channel_count, 0.0f);
+
+	gate_enabled = p_gate_enabled;
+	gate_threshold = db_to_linear(p_gate_threshold_db);
+	gate_attack = time_to_coefficient(p_gate_attack, p_sample_rate);
+	gate_release = time_to_coefficient(p_gate_release, p_sample_rate);
+	// the detector catches onsets immediately and decays slower than the gate closes, so it does not chatter
+	detector_attack = time_to_coefficient(0.0005, p_sample_rate);
+	detector_release = time_to_coefficient(MAX(p_gate_release, 0.02f), p_sample_rate);
+	envelope = 0.0f;
+	gate_gain = 0.0f;
+
+	agc_enabled = p_agc_enabled;
+	float target = db_to_linear(p_agc_target_db);
+	agc_target_power = target * target;
+	agc_max_gain = db_to_linear(MAX(p_agc_max_gain_db, 0.0f));
+	agc_attack = time_to_coefficient(p_agc_attack, p_sample_rate);
+	agc_release = time_to_coefficient(p_agc_release, p_sample_rate);
+	level_coefficient = time_to_coefficient(CONDITIONING_AGC_LEVEL_TIME, p_sample_rate);
+	level = 0.0f;
+	agc_gain = 1.0f;
+	agc_desired_gain = 1.0f;
+	agc_countdown = 0;
+
+	last_gain_db.store(0.0f);
+	last_level_db.store(-120.0f);
+	gate_open.store(!gate_enabled);
+}
+
+void PortAudioInputConditioning::set_dc_block(bool p_dc_block) {
+	dc_block = p_dc_block;
+}
+
+bool PortAudioInputConditioning::get_dc_block() {
+	return dc_block;
+}
+
+void PortAudioInputConditioning::set_high_pass_frequency(float p_high_pass_frequency) {
+	high_pass_frequency = MAX(p_high_pass_frequency, 0.0f);
+}
+
+float PortAudioInputConditioning::get_high_pass_frequency() {
+	return high_pass_frequency;
+}
+
+void PortAudioInputConditioning::set_noise_gate(bool p_noise_gate) {
+	noise_gate = p_noise_gate;
+}
+
+bool PortAudioInputConditioning::get_noise_gate() {
+	return noise_gate;
+}
+
+void PortAudioInputConditioning::set_gate_threshold_db(float p_gate_threshold_db) {
+	gate_threshold_db = p_gate_threshold_db;
+}
+
+float PortAudioInputConditioning::get_gate_threshold_db() {
+	return gate_threshold_db;
+}
+
+void PortAudioInputConditioning::set_gate_attack(float p_gate_attack) {
+	gate_attack = MAX(p_gate_attack, 0.0f);
+}
+
+float PortAudioInputConditioning::get_gate_attack() {
+	return gate_attack;
+}
+
+void PortAudioInputConditioning::set_gate_release(float p_gate_release) {
+	gate_release = MAX(p_gate_release, 0.0f);
+}
+
+float PortAudioInputConditioning::get_gate_release() {
+	return gate_release;
+}
+
+void PortAudioInputConditioning::set_agc(bool p_agc) {
+	agc = p_agc;
+}
+
+bool PortAudioInputConditioning::get_agc() {
+	return agc;
+}
+
+void PortAudioInputConditioning::set_agc_target_db(float p_agc_target_db) {
+	agc_target_db = MIN(p_agc_target_db, 0.0f);
+}
+
+float PortAudioInputConditioning::get_agc_target_db() {
+	return agc_target_db;
+}
+
+void PortAudioInputConditioning::set_agc_max_gain_db(float p_agc_max_gain_db) {
+	agc_max_gain_db = MAX(p_agc_max_gain_db, 0.0f);
+}
+
+float PortAudioInputConditioning::get_agc_max_gain_db() {
+	return agc_max_gain_db;
+}
+
+void PortAudioInputConditioning::set_agc_attack(float p_agc_attack) {
+	agc_attack = MAX(p_agc_attack, 0.0f);
+}
+
+float PortAudioInputConditioning::get_agc_attack() {
+	return agc_attack;
+}
+
+void PortAudioInputConditioning::set_agc_release(float p_agc_release) {
+	agc_release = MAX(p_agc_release, 0.0f);
+}
+
+float PortAudioInputConditioning::get_agc_release() {
+	return agc_release;
+}
+
+PortAudioInputConditioner *PortAudioInputConditioning::create_conditioner(int p_channel_count, double p_sample_rate) const {
+	if (p_channel_count <= 0 || p_sample_rate <= 0) {
+		return nullptr;
+	}
+	std::vector<PortAudioInputConditioner::Section> sections;
+	if (dc_block) {
+		// one pole high pass written as a biquad, y = x - x1 + r * y1
+		PortAudioInputConditioner::Section section;
+		section.b0 = 1.0f;
+		section.b1 = -1.0f;
+		section.b2 = 0.0f;
+		section.a1 = (float)-Math::exp(-Math_TAU * CONDITIONING_DC_BLOCK_FREQUENCY / p_sample_rate);
+		section.a2 = 0.0f;
+		sections.push_back(section);
+	}
+	if (high_pass_frequency > 0) {
+		// butterworth, q = 1/sqrt(2)
+		double w0 = Math_TAU * CLAMP((double)high_pass_frequency, 1.0, p_sample_rate * 0.49) / p_sample_rate;
+		double alpha = Math::sin(w0) / (2.0 * Math_SQRT12);
+		double cos_w0 = Math::cos(w0);
+		double a0 = 1.0 + alpha;
+		PortAudioInputConditioner::Section section;
+		section.b0 = (float)((1.0 + cos_w0) / 2.0 / a0);
+		section.b1 = (float)(-(1.0 + cos_w0) / a0);
+		section.b2 = section.b0;
+		section.a1 = (float)(-2.0 * cos_w0 / a0);
+		section.a2 = (float)((1.0 - alpha) / a0);
+		sections.push_back(section);
+	}
+	if (sections.empty() && !noise_gate && !agc) {
+		return nullptr;
+	}
+	return new PortAudioInputConditioner(p_channel_count, sections, noise_gate, gate_threshold_db, gate_attack, gate_release, agc,
+			agc_target_db, agc_max_gain_db, agc_attack, agc_release, p_sample_rate);
+}
+
+void PortAudioInputConditioning::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_dc_block"), &PortAudioInputConditioning::get_dc_block);
+	ClassDB::bind_method(D_METHOD("set_dc_block", "dc_block"), &PortAudioInputConditioning::set_dc_block);
+	ClassDB::bind_method(D_METHOD("get_high_pass_frequency"), &PortAudioInputConditioning::get_high_pass_frequency);
+	ClassDB::bind_method(D_METHOD("set_high_pass_frequency", "high_pass_frequency"), &PortAudioInputConditioning::set_high_pass_frequency);
+	ClassDB::bind_method(D_METHOD("get_noise_gate"), &PortAudioInputConditioning::get_noise_gate);
+	ClassDB::bind_method(D_METHOD("set_noise_gate", "noise_gate"), &PortAudioInputConditioning::set_noise_gate);
+	ClassDB::bind_method(D_METHOD("get_gate_threshold_db"), &PortAudioInputConditioning::get_gate_threshold_db);
+	ClassDB::bind_method(D_METHOD("set_gate_threshold_db", "gate_threshold_db"), &PortAudioInputConditioning::set_gate_threshold_db);
+	ClassDB::bind_method(D_METHOD("get_gate_attack"), &PortAudioInputConditioning::get_gate_attack);
+	ClassDB::bind_method(D_METHOD("set_gate_attack", "gate_attack"), &PortAudioInputConditioning::set_gate_attack);
+	ClassDB::bind_method(D_METHOD("get_gate_release"), &PortAudioInputConditioning::get_gate_release);
+	ClassDB::bind_method(D_METHOD("set_gate_release", "gate_release"), &PortAudioInputConditioning::set_gate_release);
+	ClassDB::bind_method(D_METHOD("get_agc"), &PortAudioInputConditioning::get_agc);
+	ClassDB::bind_method(D_METHOD("set_agc", "agc"), &PortAudioInputConditioning::set_agc);
+	ClassDB::bind_method(D_METHOD("get_agc_target_db"), &PortAudioInputConditioning::get_agc_target_db);
+	ClassDB::bind_method(D_METHOD("set_agc_target_db", "agc_target_db"), &PortAudioInputConditioning::set_agc_target_db);
+	ClassDB::bind_method(D_METHOD("get_agc_max_gain_db"), &PortAudioInputConditioning::get_agc_max_gain_db);
+	ClassDB::bind_method(D_METHOD("set_agc_max_gain_db", "agc_max_gain_db"), &PortAudioInputConditioning::set_agc_max_gain_db);
+	ClassDB::bind_method(D_METHOD("get_agc_attack"), &PortAudioInputConditioning::get_agc_attack);
+	ClassDB::bind_method(D_METHOD("set_agc_attack", "agc_attack"), &PortAudioInputConditioning::set_agc_attack);
+	ClassDB::bind_method(D_METHOD("get_agc_release"), &PortAudioInputConditioning::get_agc_release);
+	ClassDB::bind_method(D_METHOD("set_agc_release", "agc_release"), &PortAudioInputConditioning::set_agc_release);
+
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "dc_block"), "set_dc_block", "get_dc_block");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "high_pass_frequency", PROPERTY_HINT_RANGE, "0,1000,1"), "set_high_pass_frequency", "get_high_pass_frequency");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "noise_gate"), "set_noise_gate", "get_noise_gate");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "gate_threshold_db", PROPERTY_HINT_RANGE, "-100,0,0.1"), "set_gate_threshold_db", "get_gate_threshold_db");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "gate_attack", PROPERTY_HINT_RANGE, "0,1,0.001"), "set_gate_attack", "get_gate_attack");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "gate_release", PROPERTY_HINT_RANGE, "0,5,0.001"), "set_gate_release", "get_gate_release");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "agc"), "set_agc", "get_agc");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agc_target_db", PROPERTY_HINT_RANGE, "-60,0,0.1"), "set_agc_target_db", "get_agc_target_db");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agc_max_gain_db", PROPERTY_HINT_RANGE, "0,60,0.1"), "set_agc_max_gain_db", "get_agc_max_gain_db");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agc_attack", PROPERTY_HINT_RANGE, "0,5,0.001"), "set_agc_attack", "get_agc_attack");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "agc_release", PROPERTY_HINT_RANGE, "0,30,0.01"), "set_agc_release", "get_agc_release");
+}
+
+PortAudioInputConditioning::PortAudioInputConditioning() {
+	dc_block = true;
+	high_pass_frequency = 0.0f;
+	noise_gate = false;
+	gate_threshold_db = -50.0f;
+	gate_attack = 0.002f;
+	gate_release = 0.15f;
+	agc = false;
+	agc_target_db = -20.0f;
+	agc_max_gain_db = 24.0f;
+	agc_attack = 0.02f;
+	agc_release = 1.0f;
+}
+
+PortAudioInputConditioning::~PortAudioInputConditioning() {
+}
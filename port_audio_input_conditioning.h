@@ -0,0 +1,121 @@
+#ifndef PORT_AUDIO_INPUT_CONDITIONING_H
+#define PORT_AUDIO_INPUT_CONDITIONING_H
+
+#include "core/io/resource.h"
+#include "core/variant/dictionary.h"
+
+#include <atomic>
+#include <vector>
+
+// compiled conditioning chain for interleaved float input, used on the audio thread.
+// per channel state is stored side by side so each section walks the interleaved frames in order. the channel loop is
+// short and sized at runtime, it is not expected to vectorize
+class PortAudioInputConditioner {
+public:
+	struct Section {
+		float b0;
+		float b1;
+		float b2;
+		float a1;
+		float a2;
+	};
+
+	enum {
+		// the agc target gain is recomputed once per block, the gain itself is smoothed every frame
+		AGC_UPDATE_FRAMES = 16,
+	};
+
+private:
+	int channel_count;
+	std::vector<Section> sections;
+	// transposed direct form II state, [section * channel_count + channel]
+	std::vector<float> z1;
+	std::vector<float> z2;
+
+	bool gate_enabled;
+	float gate_threshold;
+	float gate_attack;
+	float gate_release;
+	float detector_attack;
+	float detector_release;
+	float envelope;
+	float gate_gain;
+
+	bool agc_enabled;
+	float agc_target_power;
+	float agc_max_gain;
+	float agc_attack;
+	float agc_release;
+	float level_coefficient;
+	float level;
+	float agc_gain;
+	float agc_desired_gain;
+	int agc_countdown;
+
+	std::atomic<float> last_gain_db;
+	std::atomic<float> last_level_db;
+	std::atomic<bool> gate_open;
+
+	void process_sections(float *r_buffer, unsigned long p_frames);
+
+public:
+	int get_channel_count() const;
+	void process(const float *p_input, float *r_output, unsigned long p_frames);
+	Dictionary get_stats() const;
+
+	PortAudioInputConditioner(int p_channel_count, const std::vector<Section> &p_sections, bool p_gate_enabled, float p_gate_threshold_db,
+			float p_gate_attack, float p_gate_release, bool p_agc_enabled, float p_agc_target_db, float p_agc_max_gain_db, float p_agc_attack,
+			float p_agc_release, double p_sample_rate);
+};
+
+// dc blocking, high pass, noise gate and automatic gain control applied to input before the script sees it
+class PortAudioInputConditioning : public Resource {
+	GDCLASS(PortAudioInputConditioning, Resource);
+
+	bool dc_block;
+	float high_pass_frequency;
+	bool noise_gate;
+	float gate_threshold_db;
+	float gate_attack;
+	float gate_release;
+	bool agc;
+	float agc_target_db;
+	float agc_max_gain_db;
+	float agc_attack;
+	float agc_release;
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_dc_block(bool p_dc_block);
+	bool get_dc_block();
+	void set_high_pass_frequency(float p_high_pass_frequency);
+	float get_high_pass_frequency();
+	void set_noise_gate(bool p_noise_gate);
+	bool get_noise_gate();
+	void set_gate_threshold_db(float p_gate_threshold_db);
+	float get_gate_threshold_db();
+	void set_gate_attack(float p_gate_attack);
+	float get_gate_attack();
+	void set_gate_release(float p_gate_release);
+	float get_gate_release();
+	void set_agc(bool p_agc);
+	bool get_agc();
+	void set_agc_target_db(float p_agc_target_db);
+	float get_agc_target_db();
+	void set_agc_max_gain_db(float p_agc_max_gain_db);
+	float get_agc_max_gain_db();
+	void set_agc_attack(float p_agc_attack);
+	float get_agc_attack();
+	void set_agc_release(float p_agc_release);
+	float get_agc_release();
+
+	// nullptr if no stage is enabled, the settings are copied and later changes apply the next time a stream opens
+	PortAudioInputConditioner *create_conditioner(int p_channel_count, double p_sample_rate) const;
+
+	PortAudioInputConditioning();
+	~PortAudioInputConditioning();
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include "port_audio_jitter_buffer.h"
+
+#include "core/math/math_funcs.h"
+#include "core/os/memory.h"
+#include "core/typedefs.h"
+
+#include <cstring>
+
+// timestamps of decoders and emulators are rounded, offsets below this are treated as contiguous
+#define JITTER_TIMESTAMP_TOLERANCE 0.002
+
+void PortAudioJitterBuffer::set_source_sample_rate(double p_source_sample_rate) {
+	// ring and resampler are sized when the stream opens
+	ERR_FAIL_COND_MSG(prepared, "PortAudioJitterBuffer::set_source_sample_rate: jitter buffer is attached to an open stream");
+	source_sample_rate = MAX(p_source_sample_rate, 0.0);
+}
+
+double PortAudioJitterBuffer::get_source_sample_rate() {
+	return source_sample_rate;
+}
+
+void PortAudioJitterBuffer::set_target_latency(double p_target_latency) {
+	ERR_FAIL_COND_MSG(prepared, "PortAudioJitterBuffer::set_target_latency: jitter buffer is attached to an open stream");
+	target_latency = MAX(p_target_latency, 0.001);
+}
+
+double PortAudioJitterBuffer::get_target_latency() {
+	return target_latency;
+}
+
+void PortAudioJitterBuffer::set_capacity(double p_capacity) {
+	ERR_FAIL_COND_MSG(prepared, "PortAudioJitterBuffer::set_capacity: jitter buffer is attached to an open stream");
+	capacity = MAX(p_capacity, 0.01);
+}
+
+double PortAudioJitterBuffer::get_capacity() {
+	return capacity;
+}
+
+void PortAudioJitterBuffer::set_max_correction_ppm(double p_max_correction_ppm) {
+	ERR_FAIL_COND_MSG(prepared, "PortAudioJitterBuffer::set_max_correction_ppm: jitter buffer is attached to an open stream");
+	max_correction_ppm = CLAMP(p_max_correction_ppm, 0.0, 20000.0);
+}
+
+double PortAudioJitterBuffer::get_max_correction_ppm() {
+	return max_correction_ppm;
+}
+
+int PortAudioJitterBuffer::write_frames(const float *p_samples, int p_frames) {
+	ring_buffer_size_t frames = MIN((ring_buffer_size_t)p_frames, PaUtil_GetRingBufferWriteAvailable(&ring));
+	if (frames > 0) {
+		PaUtil_WriteRingBuffer(&ring, p_samples, frames);
+	}
+	return frames;
+}
+
+int PortAudioJitterBuffer::push_chunk(const PackedFloat32Array &p_samples, double p_timestamp) {
+	MutexLock lock(push_mutex);
+	// the ring only exists while the stream is open
+	if (!prepared) {
+		return 0;
+	}
+	const float *samples = p_samples.ptr();
+	int frames = p_samples.size() / channel_count;
+	double rate = nominal_ratio * sample_rate;
+	double chunk_end = p_timestamp + (double)frames / rate;
+	if (p_timestamp >= 0 && expected_timestamp >= 0) {
+		double offset = p_timestamp - expected_timestamp;
+		if (offset > JITTER_TIMESTAMP_TOLERANCE) {
+			// the producer skipped ahead, silence keeps what follows at its time
+			int gap = (int)Math::round(offset * rate);
+			int inserted = 0;
+			while (inserted < gap) {
+				int written = write_frames(silence.data(), MIN(gap - inserted, (int)MAX_BLOCK_FRAMES));
+				if (written == 0) {
+					break;
+				}
+				inserted += written;
+			}
+			gap_frames.fetch_add(inserted, std::memory_order_relaxed);
+		} else if (offset < -JITTER_TIMESTAMP_TOLERANCE) {
+			// late or repeated, only the part past what is already queued is used
+			int skip = (int)Math::round(-offset * rate);
+			late_chunk_count.fetch_add(1, std::memory_order_relaxed);
+			if (skip >= frames) {
+				return 0;
+			}
+			samples += (size_t)skip * channel_count;
+			frames -= skip;
+		}
+	}
+	if (p_timestamp >= 0) {
+		expected_timestamp = chunk_end;
+	} else if (expected_timestamp >= 0) {
+		expected_timestamp += (double)frames / rate;
+	}
+	int written = write_frames(samples, frames);
+	pushed_frames.fetch_add(written, std::memory_order_relaxed);
+	if (written < frames) {
+		overrun_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	return written;
+}
+
+void PortAudioJitterBuffer::clear() {
+	MutexLock lock(push_mutex);
+	expected_timestamp = -1;
+	// only the audio thread may move the read index
+	clear_requested.store(true);
+}
+
+double PortAudioJitterBuffer::get_latency() {
+	if (!prepared) {
+		return 0;
+	}
+	return fill_frames.load(std::memory_order_relaxed) / (nominal_ratio * sample_rate);
+}
+
+Dictionary PortAudioJitterBuffer::get_stats() {
+	Dictionary stats;
+	stats["latency"] = get_latency();
+	stats["target_latency"] = target_latency;
+	stats["fill_frames"] = fill_frames.load(std::memory_order_relaxed);
+	stats["drift_ppm"] = drift_ppm.load(std::memory_order_relaxed);
+	stats["buffering"] = buffering.load(std::memory_order_relaxed);
+	stats["pushed_frames"] = pushed_frames.load(std::memory_order_relaxed);
+	stats["played_frames"] = played_frames.load(std::memory_order_relaxed);
+	stats["underruns"] = underrun_count.load(std::memory_order_relaxed);
+	stats["overruns"] = overrun_count.load(std::memory_order_relaxed);
+	stats["late_chunks"] = late_chunk_count.load(std::memory_order_relaxed);
+	stats["gap_frames"] = gap_frames.load(std::memory_order_relaxed);
+	stats["resyncs"] = resync_count.load(std::memory_order_relaxed);
+	return stats;
+}
+
+bool PortAudioJitterBuffer::prepare(int p_channel_count, double p_sample_rate) {
+	MutexLock lock(push_mutex);
+	if (prepared) {
+		print_line("PortAudioJitterBuffer::prepare: jitter buffer is already attached to an open stream");
+		return false;
+	}
+	if (p_channel_count <= 0 || p_sample_rate <= 0) {
+		return false;
+	}
+	channel_count = p_channel_count;
+	sample_rate = p_sample_rate;
+	double rate = source_sample_rate > 0 ? source_sample_rate : sample_rate;
+	nominal_ratio = rate / sample_rate;
+	target_fill = MAX(target_latency * rate, 1.0);
+	// PaUtilRingBuffer needs a power of two element count
+	ring_buffer_size_t ring_frames = next_power_of_2((uint32_t)(MAX(capacity, target_latency * 2.0) * rate));
+	ring_data = memalloc((size_t)ring_frames * channel_count * sizeof(float));
+	PaUtil_InitializeRingBuffer(&ring, channel_count * sizeof(float), ring_frames, ring_data);
+	silence.assign((size_t)MAX_BLOCK_FRAMES * channel_count, 0.0f);
+	// one output block consumes up to its length times the largest ratio the controller may ask for
+	int max_input_frames = (int)Math::ceil(MAX_BLOCK_FRAMES * nominal_ratio * (1.0 + max_correction_ppm / 1000000.0)) + 4;
+	resampler.setup(channel_count, max_input_frames);
+	drift.setup(target_fill, max_correction_ppm);
+	input_scratch.assign((size_t)max_input_frames * channel_count, 0.0f);
+	output_scratch.assign((size_t)MAX_BLOCK_FRAMES * channel_count, 0.0f);
+	expected_timestamp = -1;
+	buffering.store(true);
+	clear_requested.store(false);
+	pushed_frames.store(0);
+	played_frames.store(0);
+	underrun_count.store(0);
+	overrun_count.store(0);
+	late_chunk_count.store(0);
+	gap_frames.store(0);
+	resync_count.store(0);
+	fill_frames.store(0);
+	drift_ppm.store(0);
+	prepared = true;
+	return true;
+}
+
+void PortAudioJitterBuffer::release() {
+	MutexLock lock(push_mutex);
+	if (!prepared) {
+		return;
+	}
+	prepared = false;
+	memfree(ring_data);
+	ring_data = nullptr;
+	silence.clear();
+	input_scratch.clear();
+	output_scratch.clear();
+}
+
+void PortAudioJitterBuffer::mix(float *r_output, unsigned long p_frames) {
+	if (!prepared) {
+		return;
+	}
+	if (clear_requested.exchange(false)) {
+		PaUtil_AdvanceRingBufferReadIndex(&ring, PaUtil_GetRingBufferReadAvailable(&ring));
+		resampler.reset();
+		buffering.store(true, std::memory_order_relaxed);
+	}
+	ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&ring);
+	double fill = available + resampler.get_buffered_frames();
+	// a producer that stalled and then caught up in one burst would take minutes to correct at a few hundred ppm
+	if (available > ring.bufferSize / 2 && fill > target_fill * 2.0) {
+		ring_buffer_size_t drop = MIN(available, (ring_buffer_size_t)(fill - target_fill));
+		PaUtil_AdvanceRingBufferReadIndex(&ring, drop);
+		available -= drop;
+		fill -= drop;
+		resync_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	fill_frames.store(fill, std::memory_order_relaxed);
+	if (buffering.load(std::memory_order_relaxed)) {
+		// after an underrun the buffer refills to its target first, playing each chunk as it arrives would stutter
+		if (fill < target_fill) {
+			return;
+		}
+		buffering.store(false, std::memory_order_relaxed);
+	}
+
+	// a fast producer fills the ring, a ratio above nominal consumes more of it per output frame
+	double ratio = nominal_ratio * drift.update(fill, p_frames * nominal_ratio);
+	drift_ppm.store(drift.get_drift_ppm(), std::memory_order_relaxed);
+	unsigned long mixed = 0;
+	while (mixed < p_frames) {
+		int block = (int)MIN((unsigned long)MAX_BLOCK_FRAMES, p_frames - mixed);
+		int required = resampler.get_required_input(block, ratio);
+		ring_buffer_size_t frames = PaUtil_ReadRingBuffer(&ring, input_scratch.data(), required);
+		resampler.write(input_scratch.data(), frames);
+		int produced = resampler.read(output_scratch.data(), block, ratio);
+		float *output = r_output + mixed * channel_count;
+		int sample_count = produced * channel_count;
+		for (int i = 0; i < sample_count; i++) {
+			output[i] += output_scratch[i];
+		}
+		mixed += produced;
+		if (produced < block) {
+			underrun_count.fetch_add(1, std::memory_order_relaxed);
+			buffering.store(true, std::memory_order_relaxed);
+			break;
+		}
+	}
+	played_frames.fetch_add(mixed, std::memory_order_relaxed);
+}
+
+void PortAudioJitterBuffer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_source_sample_rate"), &PortAudioJitterBuffer::get_source_sample_rate);
+	ClassDB::bind_method(D_METHOD("set_source_sample_rate", "source_sample_rate"), &PortAudioJitterBuffer::set_source_sample_rate);
+	ClassDB::bind_method(D_METHOD("get_target_latency"), &PortAudioJitterBuffer::get_target_latency);
+	ClassDB::bind_method(D_METHOD("set_target_latency", "target_latency"), &PortAudioJitterBuffer::set_target_latency);
+	ClassDB::bind_method(D_METHOD("get_capacity"), &PortAudioJitterBuffer::get_capacity);
+	ClassDB::bind_method(D_METHOD("set_capacity", "capacity"), &PortAudioJitterBuffer::set_capacity);
+	ClassDB::bind_method(D_METHOD("get_max_correction_ppm"), &PortAudioJitterBuffer::get_max_correction_ppm);
+	ClassDB::bind_method(D_METHOD("set_max_correction_ppm", "max_correction_ppm"), &PortAudioJitterBuffer::set_max_correction_ppm);
+	ClassDB::bind_method(D_METHOD("push_chunk", "samples", "timestamp"), &PortAudioJitterBuffer::push_chunk, DEFVAL(-1.0));
+	ClassDB::bind_method(D_METHOD("clear"), &PortAudioJitterBuffer::clear);
+	ClassDB::bind_method(D_METHOD("get_latency"), &PortAudioJitterBuffer::get_latency);
+	ClassDB::bind_method(D_METHOD("get_stats"), &PortAudioJitterBuffer::get_stats);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "source_sample_rate"), "set_source_sample_rate", "get_source_sample_rate");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "target_latency", PROPERTY_HINT_RANGE, "0.001,1,0.001"), "set_target_latency", "get_target_latency");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "capacity", PROPERTY_HINT_RANGE, "0.01,10,0.01"), "set_capacity", "get_capacity");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_correction_ppm", PROPERTY_HINT_RANGE, "0,20000,1"), "set_max_correction_ppm", "get_max_correction_ppm");
+}
+
+PortAudioJitterBuffer::PortAudioJitterBuffer() {
+	source_sample_rate = 0;
+	target_latency = 0.06;
+	capacity = 0.5;
+	max_correction_ppm = 2000;
+	prepared = false;
+	channel_count = 0;
+	sample_rate = 0;
+	nominal_ratio = 1.0;
+	target_fill = 1.0;
+	ring_data = nullptr;
+	expected_timestamp = -1;
+	buffering.store(true);
+	clear_requested.store(false);
+	pushed_frames.store(0);
+	played_frames.store(0);
+	underrun_count.store(0);
+	overrun_count.store(0);
+	late_chunk_count.store(0);
+	gap_frames.store(0);
+	resync_count.store(0);
+	fill_frames.store(0);
+	drift_ppm.store(0);
+}
+
+PortAudioJitterBuffer::~PortAudioJitterBuffer() {
+	release();
+}
@@ -0,0 +1,93 @@
+#ifndef PORT_AUDIO_JITTER_BUFFER_H
+#define PORT_AUDIO_JITTER_BUFFER_H
+
+#include "port_audio_resampler.h"
+
+#include "core/io/resource.h"
+#include "core/os/mutex.h"
+#include "core/variant/dictionary.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+#include <vector>
+
+// audio pushed from outside the callback (emulators, decoders, voip) in irregular chunks and on its own clock,
+// mixed into the output of a stream at a fill level held around target_latency by small resampling corrections
+class PortAudioJitterBuffer : public Resource {
+	GDCLASS(PortAudioJitterBuffer, Resource);
+
+public:
+	enum {
+		MAX_BLOCK_FRAMES = 1024,
+	};
+
+private:
+	double source_sample_rate;
+	double target_latency;
+	double capacity;
+	double max_correction_ppm;
+
+	bool prepared;
+	int channel_count;
+	double sample_rate;
+	double nominal_ratio;
+	double target_fill;
+	PaUtilRingBuffer ring;
+	void *ring_data;
+
+	// producer side, push_chunk() may be called from any thread
+	Mutex push_mutex;
+	double expected_timestamp;
+	std::vector<float> silence;
+
+	// audio thread
+	PortAudioResampler resampler;
+	PortAudioDriftController drift;
+	std::vector<float> input_scratch;
+	std::vector<float> output_scratch;
+	std::atomic<bool> buffering;
+	std::atomic<bool> clear_requested;
+
+	std::atomic<uint64_t> pushed_frames;
+	std::atomic<uint64_t> played_frames;
+	std::atomic<uint64_t> underrun_count;
+	std::atomic<uint64_t> overrun_count;
+	std::atomic<uint64_t> late_chunk_count;
+	std::atomic<uint64_t> gap_frames;
+	std::atomic<uint64_t> resync_count;
+	std::atomic<double> fill_frames;
+	std::atomic<double> drift_ppm;
+
+	int write_frames(const float *p_samples, int p_frames);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_source_sample_rate(double p_source_sample_rate);
+	double get_source_sample_rate();
+	void set_target_latency(double p_target_latency);
+	double get_target_latency();
+	void set_capacity(double p_capacity);
+	double get_capacity();
+	void set_max_correction_ppm(double p_max_correction_ppm);
+	double get_max_correction_ppm();
+
+	// interleaved frames with the channel count of the stream output. p_timestamp is the source time of the first
+	// frame in seconds, gaps are filled with silence and frames already covered are dropped. negative: contiguous
+	int push_chunk(const PackedFloat32Array &p_samples, double p_timestamp);
+	void clear();
+	double get_latency();
+	Dictionary get_stats();
+
+	bool prepare(int p_channel_count, double p_sample_rate);
+	void release();
+	// audio thread, adds the buffered audio to p_output (interleaved float frames)
+	void mix(float *r_output, unsigned long p_frames);
+
+	PortAudioJitterBuffer();
+	~PortAudioJitterBuffer();
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "port_audio_latency_probe.h"
+
+#include "port_audio_fft.h"
+
+#include "core/math/math_funcs.h"
+
+int PortAudioLatencyProbe::get_capture_length() const {
+	return (int)capture.size();
+}
+
+bool PortAudioLatencyProbe::process(const float *p_input, float *r_output, unsigned long p_frames) {
+	if (finished.load(std::memory_order_relaxed)) {
+		return true;
+	}
+	int capture_length = (int)capture.size();
+	for (unsigned long frame = 0; frame < p_frames; frame++) {
+		float sample = play_position < SEQUENCE_LENGTH ? sequence[play_position++] : 0.0f;
+		for (int c = 0; c < output_channel_count; c++) {
+			r_output[frame * output_channel_count + c] = sample;
+		}
+		if (capture_position < capture_length) {
+			float sum = 0.0f;
+			for (int c = 0; c < input_channel_count; c++) {
+				sum += p_input[frame * input_channel_count + c];
+			}
+			capture[capture_position++] = sum;
+		}
+	}
+	if (capture_position >= capture_length) {
+		// last access to the probe, the main thread may free it right after this store
+		finished.store(true, std::memory_order_release);
+		return true;
+	}
+	return false;
+}
+
+bool PortAudioLatencyProbe::is_finished() const {
+	return finished.load(std::memory_order_acquire);
+}
+
+bool PortAudioLatencyProbe::analyze(int &r_latency_frames, float &r_confidence) const {
+	r_latency_frames = 0;
+	r_confidence = 0.0f;
+	if (!is_finished()) {
+		return false;
+	}
+	int capture_length = (int)capture.size();
+	int size = 1;
+	while (size < capture_length + SEQUENCE_LENGTH) {
+		size <<= 1;
+	}
+	PortAudioFFT fft;
+	fft.setup(size);
+	std::vector<float> capture_real(size, 0.0f);
+	std::vector<float> capture_imag(size, 0.0f);
+	std::vector<float> sequence_real(size, 0.0f);
+	std::vector<float> sequence_imag(size, 0.0f);
+	for (int i = 0; i < capture_length; i++) {
+		capture_real[i] = capture[i];
+	}
+	for (int i = 0; i < SEQUENCE_LENGTH; i++) {
+		sequence_real[i] = sequence[i];
+	}
+	fft.forward(capture_real.data(), capture_imag.data());
+	fft.forward(sequence_real.data(), sequence_imag.data());
+
+	// cross correlation, capture * conj(sequence)
+	for (int i = 0; i < size; i++) {
+		float real = capture_real[i] * sequence_real[i] + capture_imag[i] * sequence_imag[i];
+		float imag = capture_imag[i] * sequence_real[i] - capture_real[i] * sequence_imag[i];
+		capture_real[i] = real;
+		capture_imag[i] = imag;
+	}
+	fft.inverse(capture_real.data(), capture_imag.data());
+
+	// the loopback path may invert polarity, search the magnitude
+	int peak_lag = 0;
+	float peak = 0.0f;
+	double energy = 0.0;
+	for (int lag = 0; lag <= max_latency_frames; lag++) {
+		float value = Math::abs(capture_real[lag]);
+		energy += (double)value * value;
+		if (value > peak) {
+			peak = value;
+			peak_lag = lag;
+		}
+	}
+	float rms = (float)Math::sqrt(energy / (max_latency_frames + 1));
+	if (rms <= 0.0f) {
+		return false;
+	}
+	r_latency_frames = peak_lag;
+	r_confidence = peak / rms;
+	return true;
+}
+
+PortAudioLatencyProbe::PortAudioLatencyProbe(int p_input_channel_count, int p_output_channel_count, double p_sample_rate, double p_max_latency) {
+	input_channel_count = p_input_channel_count;
+	output_channel_count = p_output_channel_count;
+	max_latency_frames = (int)(p_max_latency * p_sample_rate);
+	play_position = 0;
+	capture_position = 0;
+	finished.store(false);
+
+	// fibonacci lfsr with taps 14, 5, 3, 1 at -12 dBFS
+	sequence.resize(SEQUENCE_LENGTH);
+	uint32_t state = 1;
+	for (int i = 0; i < SEQUENCE_LENGTH; i++) {
+		uint32_t bit = ((state >> 13) ^ (state >> 4) ^ (state >> 2) ^ state) & 1;
+		state = ((state << 1) | bit) & SEQUENCE_LENGTH;
+		sequence[i] = (state & 1) ? 0.25f : -0.25f;
+	}
+	capture.resize(SEQUENCE_LENGTH + max_latency_frames, 0.0f);
+}
@@ -0,0 +1,38 @@
+#ifndef PORT_AUDIO_LATENCY_PROBE_H
+#define PORT_AUDIO_LATENCY_PROBE_H
+
+#include <atomic>
+#include <vector>
+
+// plays a maximum length sequence on a duplex stream and locates it in the captured input
+class PortAudioLatencyProbe {
+public:
+	enum {
+		SEQUENCE_ORDER = 14,
+		SEQUENCE_LENGTH = (1 << SEQUENCE_ORDER) - 1,
+	};
+
+private:
+	int input_channel_count;
+	int output_channel_count;
+	int max_latency_frames;
+	std::vector<float> sequence;
+	std::vector<float> capture;
+	int play_position;
+	int capture_position;
+	std::atomic<bool> finished;
+
+public:
+	int get_capture_length() const;
+
+	// audio thread, returns true once the capture is complete
+	bool process(const float *p_input, float *r_output, unsigned long p_frames);
+
+	// main thread
+	bool is_finished() const;
+	bool analyze(int &r_latency_frames, float &r_confidence) const;
+
+	PortAudioLatencyProbe(int p_input_channel_count, int p_output_channel_count, double p_sample_rate, double p_max_latency);
+};
+
+#endif
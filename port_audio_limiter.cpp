@@ -0,0 +1,256 @@
+#include "port_audio_limiter.h"
+
+#include "core/math/math_funcs.h"
+#include "core/typedefs.h"
+
+#include <cmath>
+#include <cstring>
+
+// reductions below 0.01 db are the tail of a release, they are not counted as limiting
+#define LIMITER_ACTIVE_GAIN 0.999f
+
+void PortAudioLimiter::set_lookahead(double p_lookahead) {
+	// the delay line is sized when the stream opens
+	ERR_FAIL_COND_MSG(prepared, "PortAudioLimiter::set_lookahead: limiter is attached to an open stream");
+	lookahead = CLAMP(p_lookahead, 0.0005, 0.05);
+}
+
+double PortAudioLimiter::get_lookahead() {
+	return lookahead;
+}
+
+void PortAudioLimiter::set_release_time(double p_release_time) {
+	release_time = MAX(p_release_time, 0.001);
+}
+
+double PortAudioLimiter::get_release_time() {
+	return release_time;
+}
+
+void PortAudioLimiter::set_ceiling_db(float p_ceiling_db) {
+	ceiling_db = CLAMP(p_ceiling_db, -60.0f, 0.0f);
+}
+
+float PortAudioLimiter::get_ceiling_db() {
+	return ceiling_db;
+}
+
+void PortAudioLimiter::set_true_peak(bool p_true_peak) {
+	// changes the latency
+	ERR_FAIL_COND_MSG(prepared, "PortAudioLimiter::set_true_peak: limiter is attached to an open stream");
+	true_peak = p_true_peak;
+}
+
+bool PortAudioLimiter::get_true_peak() {
+	return true_peak;
+}
+
+double PortAudioLimiter::get_latency() {
+	return prepared ? latency_frames / sample_rate : 0.0;
+}
+
+int PortAudioLimiter::get_latency_frames() {
+	return prepared ? latency_frames : 0;
+}
+
+Dictionary PortAudioLimiter::get_stats() {
+	Dictionary stats;
+	stats["latency"] = get_latency();
+	stats["latency_frames"] = get_latency_frames();
+	stats["gain_reduction_db"] = gain_reduction_db.load(std::memory_order_relaxed);
+	stats["peak_gain_reduction_db"] = peak_gain_reduction_db.load(std::memory_order_relaxed);
+	stats["limited_frames"] = limited_frames.load(std::memory_order_relaxed);
+	return stats;
+}
+
+bool PortAudioLimiter::prepare(int p_channel_count, double p_sample_rate) {
+	if (prepared) {
+		print_line("PortAudioLimiter::prepare: limiter is already attached to an open stream");
+		return false;
+	}
+	if (p_channel_count <= 0 || p_sample_rate <= 0) {
+		return false;
+	}
+	channel_count = p_channel_count;
+	sample_rate = p_sample_rate;
+	int lookahead_frames = MAX((int)Math::round(lookahead * p_sample_rate), 1);
+	window_frames = lookahead_frames + 1;
+	detection_delay = true_peak ? (int)TRUE_PEAK_DELAY : 0;
+	latency_frames = lookahead_frames + detection_delay;
+
+	uint32_t delay_frames = next_power_of_2((uint32_t)(latency_frames + TRUE_PEAK_TAPS + 1));
+	delay_line.assign(delay_frames * channel_count, 0.0f);
+	delay_mask = delay_frames - 1;
+	write_position = 0;
+	// the deque holds up to window_frames entries plus the one pushed before the oldest is dropped
+	uint32_t window_capacity = next_power_of_2((uint32_t)(window_frames + 1));
+	window_gain.assign(window_capacity, 1.0f);
+	window_frame.assign(window_capacity, 0);
+	window_mask = window_capacity - 1;
+	window_head = 0;
+	window_tail = 0;
+	detected_frames = 0;
+	average_history.assign(window_frames, 1.0f);
+	average_position = 0;
+	average_sum = window_frames;
+	release_gain = 1.0f;
+
+	// windowed sinc at 1/4, 2/4 and 3/4 between the checked frame and the next one, tap j reads frame j - 3 from it
+	for (int phase = 0; phase < TRUE_PEAK_PHASES; phase++) {
+		double fraction = (phase + 1) / 4.0;
+		double sum = 0.0;
+		double coefficients[TRUE_PEAK_TAPS];
+		for (int tap = 0; tap < TRUE_PEAK_TAPS; tap++) {
+			double t = fraction - (tap - 3);
+			double window = 0.5 + 0.5 * Math::cos(Math_PI * t / 4.0);
+			coefficients[tap] = Math::sin(Math_PI * t) / (Math_PI * t) * window;
+			sum += coefficients[tap];
+		}
+		for (int tap = 0; tap < TRUE_PEAK_TAPS; tap++) {
+			true_peak_coefficients[phase][tap] = (float)(coefficients[tap] / sum);
+		}
+	}
+
+	gain_reduction_db.store(0.0f);
+	peak_gain_reduction_db.store(0.0f);
+	limited_frames.store(0);
+	prepared = true;
+	return true;
+}
+
+void PortAudioLimiter::release() {
+	prepared = false;
+}
+
+float PortAudioLimiter::detect_peak(uint32_t p_position) {
+	const int channels = channel_count;
+	const float *checked = &delay_line[((p_position - detection_delay) & delay_mask) * channels];
+	float peak = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		peak = MAX(peak, Math::abs(checked[c]));
+	}
+	if (!true_peak) {
+		return peak;
+	}
+	// the oldest tap is TRUE_PEAK_TAPS - 1 frames behind the newest input frame
+	uint32_t first = p_position - (TRUE_PEAK_TAPS - 1);
+	for (int phase = 0; phase < TRUE_PEAK_PHASES; phase++) {
+		const float *coefficients = true_peak_coefficients[phase];
+		for (int c = 0; c < channels; c++) {
+			float value = 0.0f;
+			for (int tap = 0; tap < TRUE_PEAK_TAPS; tap++) {
+				value += coefficients[tap] * delay_line[((first + tap) & delay_mask) * channels + c];
+			}
+			peak = MAX(peak, Math::abs(value));
+		}
+	}
+	return peak;
+}
+
+float PortAudioLimiter::next_gain(float p_required_gain, float p_release_coefficient) {
+	// minimum of the required gain over the last window_frames detections
+	uint64_t frame = detected_frames++;
+	while (window_tail != window_head && window_gain[(window_tail - 1) & window_mask] >= p_required_gain) {
+		window_tail--;
+	}
+	window_gain[window_tail & window_mask] = p_required_gain;
+	window_frame[window_tail & window_mask] = frame;
+	window_tail++;
+	while (window_frame[window_head & window_mask] + window_frames <= frame) {
+		window_head++;
+	}
+	float held = window_gain[window_head & window_mask];
+
+	// drops follow immediately, recovery is smoothed. staying below the held gain keeps the average below every peak
+	if (held < release_gain) {
+		release_gain = held;
+	} else {
+		release_gain += p_release_coefficient * (held - release_gain);
+	}
+	average_sum += release_gain - average_history[average_position];
+	average_history[average_position] = release_gain;
+	average_position = average_position + 1 == window_frames ? 0 : average_position + 1;
+	return (float)MIN(average_sum / window_frames, 1.0);
+}
+
+void PortAudioLimiter::process(float *r_buffer, unsigned long p_frames) {
+	if (!prepared) {
+		return;
+	}
+	const int channels = channel_count;
+	const float ceiling = powf(10.0f, ceiling_db / 20.0f);
+	const float release_coefficient = (float)(1.0 - Math::exp(-1.0 / (release_time * sample_rate)));
+	float lowest_gain = 1.0f;
+	float gain = 1.0f;
+	uint64_t limited = 0;
+	for (unsigned long frame = 0; frame < p_frames; frame++) {
+		float *samples = r_buffer + frame * channels;
+		memcpy(&delay_line[(write_position & delay_mask) * channels], samples, channels * sizeof(float));
+		float peak = detect_peak(write_position);
+		gain = next_gain(peak > ceiling ? ceiling / peak : 1.0f, release_coefficient);
+		const float *delayed = &delay_line[((write_position - latency_frames) & delay_mask) * channels];
+		for (int c = 0; c < channels; c++) {
+			samples[c] = delayed[c] * gain;
+		}
+		write_position++;
+		lowest_gain = MIN(lowest_gain, gain);
+		if (gain < LIMITER_ACTIVE_GAIN) {
+			limited++;
+		}
+	}
+	gain_reduction_db.store(-20.0f * log10f(gain), std::memory_order_relaxed);
+	float peak_reduction = -20.0f * log10f(lowest_gain);
+	if (peak_reduction > peak_gain_reduction_db.load(std::memory_order_relaxed)) {
+		peak_gain_reduction_db.store(peak_reduction, std::memory_order_relaxed);
+	}
+	if (limited > 0) {
+		limited_frames.fetch_add(limited, std::memory_order_relaxed);
+	}
+}
+
+void PortAudioLimiter::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_lookahead"), &PortAudioLimiter::get_lookahead);
+	ClassDB::bind_method(D_METHOD("set_lookahead", "lookahead"), &PortAudioLimiter::set_lookahead);
+	ClassDB::bind_method(D_METHOD("get_release_time"), &PortAudioLimiter::get_release_time);
+	ClassDB::bind_method(D_METHOD("set_release_time", "release_time"), &PortAudioLimiter::set_release_time);
+	ClassDB::bind_method(D_METHOD("get_ceiling_db"), &PortAudioLimiter::get_ceiling_db);
+	ClassDB::bind_method(D_METHOD("set_ceiling_db", "ceiling_db"), &PortAudioLimiter::set_ceiling_db);
+	ClassDB::bind_method(D_METHOD("get_true_peak"), &PortAudioLimiter::get_true_peak);
+	ClassDB::bind_method(D_METHOD("set_true_peak", "true_peak"), &PortAudioLimiter::set_true_peak);
+	ClassDB::bind_method(D_METHOD("get_latency"), &PortAudioLimiter::get_latency);
+	ClassDB::bind_method(D_METHOD("get_latency_frames"), &PortAudioLimiter::get_latency_frames);
+	ClassDB::bind_method(D_METHOD("get_stats"), &PortAudioLimiter::get_stats);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "lookahead", PROPERTY_HINT_RANGE, "0.0005,0.05,0.0005"), "set_lookahead", "get_lookahead");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "release_time", PROPERTY_HINT_RANGE, "0.001,2,0.001"), "set_release_time", "get_release_time");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "ceiling_db", PROPERTY_HINT_RANGE, "-60,0,0.1"), "set_ceiling_db", "get_ceiling_db");
+	ADD_PROPERTY(PropertyInfo(Variant::BOOL, "true_peak"), "set_true_peak", "get_true_peak");
+}
+
+PortAudioLimiter::PortAudioLimiter() {
+	lookahead = 0.005;
+	release_time = 0.1;
+	ceiling_db = -1.0f;
+	true_peak = true;
+	prepared = false;
+	channel_count = 0;
+	sample_rate = 0;
+	window_frames = 1;
+	detection_delay = 0;
+	latency_frames = 0;
+	delay_mask = 0;
+	write_position = 0;
+	window_mask = 0;
+	window_head = 0;
+	window_tail = 0;
+	detected_frames = 0;
+	average_position = 0;
+	average_sum = 0;
+	release_gain = 1.0f;
+	gain_reduction_db.store(0.0f);
+	peak_gain_reduction_db.store(0.0f);
+	limited_frames.store(0);
+}
+
+PortAudioLimiter::~PortAudioLimiter() {
+}
@@ -0,0 +1,90 @@
+#ifndef PORT_AUDIO_LIMITER_H
+#define PORT_AUDIO_LIMITER_H
+
+#include "core/io/resource.h"
+#include "core/variant/dictionary.h"
+
+#include <atomic>
+#include <vector>
+
+// brickwall limiter on the output of a stream, runs after all other native stages and after output routing, on the
+// device channels. the output is delayed by the lookahead so the gain is already down when a peak leaves the delay line,
+// nothing above the ceiling reaches the device
+class PortAudioLimiter : public Resource {
+	GDCLASS(PortAudioLimiter, Resource);
+
+public:
+	enum {
+		// inter-sample peaks are estimated at 4x oversampling from this many frames around the checked frame
+		TRUE_PEAK_TAPS = 8,
+		TRUE_PEAK_PHASES = 3,
+		// the interpolation needs frames after the checked one, detection runs this far behind the input
+		TRUE_PEAK_DELAY = 4,
+	};
+
+private:
+	double lookahead;
+	double release_time;
+	float ceiling_db;
+	bool true_peak;
+
+	bool prepared;
+	int channel_count;
+	double sample_rate;
+	int window_frames;
+	int detection_delay;
+	int latency_frames;
+	float true_peak_coefficients[TRUE_PEAK_PHASES][TRUE_PEAK_TAPS];
+
+	// audio thread. interleaved input history, the output is read latency_frames behind the write position
+	std::vector<float> delay_line;
+	uint32_t delay_mask;
+	uint32_t write_position;
+	// sliding minimum of the required gain over the window (monotonic deque)
+	std::vector<float> window_gain;
+	std::vector<uint64_t> window_frame;
+	uint32_t window_mask;
+	uint32_t window_head;
+	uint32_t window_tail;
+	uint64_t detected_frames;
+	// moving average over the held gain, it reaches the held minimum exactly when the peak leaves the delay line
+	std::vector<float> average_history;
+	int average_position;
+	double average_sum;
+	float release_gain;
+
+	std::atomic<float> gain_reduction_db;
+	std::atomic<float> peak_gain_reduction_db;
+	std::atomic<uint64_t> limited_frames;
+
+	float detect_peak(uint32_t p_position);
+	float next_gain(float p_required_gain, float p_release_coefficient);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_lookahead(double p_lookahead);
+	double get_lookahead();
+	void set_release_time(double p_release_time);
+	double get_release_time();
+	void set_ceiling_db(float p_ceiling_db);
+	float get_ceiling_db();
+	void set_true_peak(bool p_true_peak);
+	bool get_true_peak();
+
+	// delay added to the output while attached to a stream, 0 otherwise
+	double get_latency();
+	int get_latency_frames();
+	Dictionary get_stats();
+
+	bool prepare(int p_channel_count, double p_sample_rate);
+	void release();
+	// audio thread, limits p_buffer (interleaved float frames) in place
+	void process(float *r_buffer, unsigned long p_frames);
+
+	PortAudioLimiter();
+	~PortAudioLimiter();
+};
+
+#endif
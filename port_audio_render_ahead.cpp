@@ -0,0 +1,233 @@
+#include "port_audio_render_ahead.h"
+
+#include "port_audio.h"
+
+#include "core/math/math_funcs.h"
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+#include <string.h>
+
+void PortAudioRenderAhead::set_min_latency(double p_min_latency) {
+	min_latency = p_min_latency;
+}
+
+double PortAudioRenderAhead::get_min_latency() {
+	return min_latency;
+}
+
+void PortAudioRenderAhead::set_max_latency(double p_max_latency) {
+	max_latency = p_max_latency;
+}
+
+double PortAudioRenderAhead::get_max_latency() {
+	return max_latency;
+}
+
+int PortAudioRenderAhead::get_target_fill_frames() {
+	return (int)target_fill_frames;
+}
+
+int PortAudioRenderAhead::get_fill_frames() {
+	if (!ring_buffer_data) {
+		return 0;
+	}
+	return (int)PaUtil_GetRingBufferReadAvailable(&ring_buffer);
+}
+
+double PortAudioRenderAhead::get_added_latency() {
+	if (sample_rate <= 0) {
+		return 0;
+	}
+	return get_fill_frames() / sample_rate;
+}
+
+uint64_t PortAudioRenderAhead::get_underrun_count() {
+	return underrun_count.load(std::memory_order_relaxed);
+}
+
+uint64_t PortAudioRenderAhead::get_underrun_frames() {
+	return underrun_frames.load(std::memory_order_relaxed);
+}
+
+bool PortAudioRenderAhead::setup(int p_frame_size, double p_sample_rate, unsigned int p_frames_per_buffer, const Variant &p_user_data) {
+	if (attached.load()) {
+		print_line("PortAudioRenderAhead::setup: render ahead is already attached to an open stream");
+		return false;
+	}
+	release();
+	if (p_frame_size <= 0 || p_sample_rate <= 0) {
+		print_line("PortAudioRenderAhead::setup: invalid frame size or sample rate");
+		return false;
+	}
+	frame_size = p_frame_size;
+	sample_rate = p_sample_rate;
+	frames_per_buffer = p_frames_per_buffer;
+
+	// PaUtilRingBuffer requires a power of two element count
+	int max_frames = (int)(max_latency * sample_rate) + frames_per_buffer;
+	int capacity = 1;
+	while (capacity < max_frames) {
+		capacity <<= 1;
+	}
+	ring_buffer_data = memalloc(capacity * frame_size);
+	if (PaUtil_InitializeRingBuffer(&ring_buffer, frame_size, capacity, ring_buffer_data) < 0) {
+		print_line("PortAudioRenderAhead::setup: failed to initialize ring buffer");
+		memfree(ring_buffer_data);
+		ring_buffer_data = nullptr;
+		return false;
+	}
+
+	// the render buffer is sized once for the largest possible request and reused every frame
+	Ref<StreamPeerBuffer> output_buffer;
+	output_buffer.instantiate();
+	output_buffer->resize(capacity * frame_size);
+	render_data.instantiate();
+	render_data->set_output_buffer(output_buffer);
+	render_data->set_user_data(p_user_data);
+
+	frame_time_mean = 0;
+	frame_time_deviation = 0;
+	underrun_margin = 0;
+	target_fill_frames = min_latency * sample_rate;
+	underrun_count.store(0);
+	underrun_frames.store(0);
+	handled_underrun_count = 0;
+	attached.store(true);
+	return true;
+}
+
+void PortAudioRenderAhead::release() {
+	attached.store(false);
+	if (ring_buffer_data) {
+		memfree(ring_buffer_data);
+		ring_buffer_data = nullptr;
+	}
+	render_data = Ref<PortAudioCallbackData>();
+}
+
+void PortAudioRenderAhead::detach() {
+	// the ring buffer stays allocated, render may be running on the main thread
+	attached.store(false);
+}
+
+bool PortAudioRenderAhead::is_attached() {
+	return attached.load();
+}
+
+void PortAudioRenderAhead::pull(void *p_output_buffer, unsigned long p_frames) {
+	uint8_t *output = (uint8_t *)p_output_buffer;
+	ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&ring_buffer);
+	ring_buffer_size_t frames = (ring_buffer_size_t)p_frames;
+	ring_buffer_size_t read = PaUtil_ReadRingBuffer(&ring_buffer, output, available < frames ? available : frames);
+	if (read < frames) {
+		memset(output + read * frame_size, 0, (frames - read) * frame_size);
+		underrun_frames.fetch_add(frames - read, std::memory_order_relaxed);
+		underrun_count.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void PortAudioRenderAhead::render(double p_delta) {
+	if (!ring_buffer_data || !attached.load()) {
+		return;
+	}
+
+	// track frame time variance, the fill level has to bridge the gap until the next _process
+	if (frame_time_mean <= 0) {
+		frame_time_mean = p_delta;
+	}
+	frame_time_deviation += (Math::abs(p_delta - frame_time_mean) - frame_time_deviation) * 0.1;
+	frame_time_mean += (p_delta - frame_time_mean) * 0.1;
+
+	// grow the safety margin on every underrun, let it decay while playback is stable
+	uint64_t current_underrun_count = underrun_count.load(std::memory_order_acquire);
+	if (current_underrun_count != handled_underrun_count) {
+		underrun_margin += p_delta * sample_rate;
+		handled_underrun_count = current_underrun_count;
+	} else {
+		underrun_margin *= 0.995;
+	}
+
+	double min_fill = min_latency * sample_rate;
+	double max_fill = max_latency * sample_rate;
+	target_fill_frames = frames_per_buffer + (frame_time_mean + 3.0 * frame_time_deviation) * sample_rate + underrun_margin;
+	target_fill_frames = CLAMP(target_fill_frames, min_fill, max_fill);
+
+	ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&ring_buffer);
+	ring_buffer_size_t writable = PaUtil_GetRingBufferWriteAvailable(&ring_buffer);
+	ring_buffer_size_t needed = (ring_buffer_size_t)target_fill_frames - available;
+	if (needed <= 0) {
+		return;
+	}
+	if (needed > writable) {
+		needed = writable;
+	}
+
+	Ref<StreamPeerBuffer> output_buffer = render_data->get_output_buffer();
+	output_buffer->seek(0);
+	render_data->set_frames_per_buffer(needed);
+	render_data->set_current_time(OS::get_singleton()->get_ticks_usec() / 1000000.0);
+	emit_signal("render_requested", render_data);
+
+	ring_buffer_size_t bytes_written = output_buffer->get_position();
+	if (bytes_written > needed * frame_size) {
+		print_line(vformat("PortAudioRenderAhead::render: bytes_written (%d) > requested (%d) - data truncated", (int)bytes_written, (int)(needed * frame_size)));
+		bytes_written = needed * frame_size;
+	}
+	PackedByteArray data = output_buffer->get_data_array();
+	PaUtil_WriteRingBuffer(&ring_buffer, data.ptr(), bytes_written / frame_size);
+}
+
+void PortAudioRenderAhead::_notification(int p_what) {
+	switch (p_what) {
+		case NOTIFICATION_READY: {
+			set_process(true);
+		} break;
+		case NOTIFICATION_PROCESS: {
+			render(get_process_delta_time());
+		} break;
+	}
+}
+
+void PortAudioRenderAhead::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_min_latency"), &PortAudioRenderAhead::get_min_latency);
+	ClassDB::bind_method(D_METHOD("set_min_latency", "min_latency"), &PortAudioRenderAhead::set_min_latency);
+	ClassDB::bind_method(D_METHOD("get_max_latency"), &PortAudioRenderAhead::get_max_latency);
+	ClassDB::bind_method(D_METHOD("set_max_latency", "max_latency"), &PortAudioRenderAhead::set_max_latency);
+	ClassDB::bind_method(D_METHOD("get_target_fill_frames"), &PortAudioRenderAhead::get_target_fill_frames);
+	ClassDB::bind_method(D_METHOD("get_fill_frames"), &PortAudioRenderAhead::get_fill_frames);
+	ClassDB::bind_method(D_METHOD("get_added_latency"), &PortAudioRenderAhead::get_added_latency);
+	ClassDB::bind_method(D_METHOD("get_underrun_count"), &PortAudioRenderAhead::get_underrun_count);
+	ClassDB::bind_method(D_METHOD("get_underrun_frames"), &PortAudioRenderAhead::get_underrun_frames);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "min_latency"), "set_min_latency", "get_min_latency");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "max_latency"), "set_max_latency", "get_max_latency");
+
+	ADD_SIGNAL(MethodInfo("render_requested", PropertyInfo(Variant::OBJECT, "data", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioCallbackData")));
+}
+
+PortAudioRenderAhead::PortAudioRenderAhead() {
+	ring_buffer_data = nullptr;
+	render_data = Ref<PortAudioCallbackData>();
+	frame_size = 0;
+	sample_rate = 0;
+	frames_per_buffer = 0;
+	min_latency = 0.04;
+	max_latency = 0.25;
+	frame_time_mean = 0;
+	frame_time_deviation = 0;
+	underrun_margin = 0;
+	target_fill_frames = 0;
+	underrun_count.store(0);
+	underrun_frames.store(0);
+	handled_underrun_count = 0;
+	attached.store(false);
+}
+
+PortAudioRenderAhead::~PortAudioRenderAhead() {
+	// the callback must be gone before the ring buffer is freed
+	if (attached.load() && PortAudio::get_singleton()) {
+		PortAudio::get_singleton()->close_render_ahead_stream(this);
+	}
+	release();
+}
@@ -0,0 +1,64 @@
+#ifndef PORT_AUDIO_RENDER_AHEAD_H
+#define PORT_AUDIO_RENDER_AHEAD_H
+
+#include "port_audio_callback_data.h"
+
+#include "scene/main/node.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+
+class PortAudioRenderAhead : public Node {
+	GDCLASS(PortAudioRenderAhead, Node);
+
+private:
+	PaUtilRingBuffer ring_buffer;
+	void *ring_buffer_data;
+	Ref<PortAudioCallbackData> render_data;
+	int frame_size;
+	double sample_rate;
+	unsigned int frames_per_buffer;
+
+	double min_latency;
+	double max_latency;
+	double frame_time_mean;
+	double frame_time_deviation;
+	double underrun_margin;
+	double target_fill_frames;
+
+	std::atomic<uint64_t> underrun_count;
+	std::atomic<uint64_t> underrun_frames;
+	uint64_t handled_underrun_count;
+	// set while a stream pulls from the ring buffer, the buffer is only freed on the main thread once it is cleared
+	std::atomic<bool> attached;
+
+	void render(double p_delta);
+
+protected:
+	void _notification(int p_what);
+	static void _bind_methods();
+
+public:
+	void set_min_latency(double p_min_latency);
+	double get_min_latency();
+	void set_max_latency(double p_max_latency);
+	double get_max_latency();
+	int get_target_fill_frames();
+	int get_fill_frames();
+	double get_added_latency();
+	uint64_t get_underrun_count();
+	uint64_t get_underrun_frames();
+
+	bool setup(int p_frame_size, double p_sample_rate, unsigned int p_frames_per_buffer, const Variant &p_user_data);
+	void release();
+	// the stream was closed, its callback no longer runs
+	void detach();
+	bool is_attached();
+	void pull(void *p_output_buffer, unsigned long p_frames);
+
+	PortAudioRenderAhead();
+	~PortAudioRenderAhead();
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "port_audio_resampler.h"
+
+#include "core/math/math_funcs.h"
+#include "core/typedefs.h"
+
+#include <cstring>
+
+void PortAudioResampler::setup(int p_channel_count, int p_max_block_frames) {
+	channel_count = MAX(p_channel_count, 1);
+	// a block plus what a ratio slightly above 1 and the interpolation window leave behind
+	capacity_frames = MAX(p_max_block_frames, 1) * 2 + 16;
+	buffer.assign((size_t)capacity_frames * channel_count, 0.0f);
+	reset();
+}
+
+void PortAudioResampler::reset() {
+	// one frame of silence before the first input keeps the interpolation window inside the buffer
+	memset(buffer.data(), 0, buffer.size() * sizeof(float));
+	buffer_frames = 1;
+	position = 1.0;
+}
+
+int PortAudioResampler::get_required_input(int p_output_frames, double p_ratio) const {
+	if (p_output_frames <= 0) {
+		return 0;
+	}
+	int last_index = (int)Math::floor(position + (p_output_frames - 1) * p_ratio);
+	return MAX(0, last_index + 3 - buffer_frames);
+}
+
+int PortAudioResampler::write(const float *p_input, int p_frames) {
+	int frames = MIN(p_frames, capacity_frames - buffer_frames);
+	if (frames <= 0) {
+		return 0;
+	}
+	memcpy(&buffer[(size_t)buffer_frames * channel_count], p_input, (size_t)frames * channel_count * sizeof(float));
+	buffer_frames += frames;
+	return frames;
+}
+
+int PortAudioResampler::read(float *r_output, int p_frames, double p_ratio) {
+	int produced = 0;
+	while (produced < p_frames) {
+		int index = (int)position;
+		if (index + 2 >= buffer_frames) {
+			break;
+		}
+		float t = (float)(position - index);
+		const float *p0 = &buffer[(size_t)(index - 1) * channel_count];
+		const float *p1 = p0 + channel_count;
+		const float *p2 = p1 + channel_count;
+		const float *p3 = p2 + channel_count;
+		float *output = r_output + (size_t)produced * channel_count;
+		for (int c = 0; c < channel_count; c++) {
+			output[c] = p1[c] + 0.5f * t * (p2[c] - p0[c] + t * (2.0f * p0[c] - 5.0f * p1[c] + 4.0f * p2[c] - p3[c] + t * (3.0f * (p1[c] - p2[c]) + p3[c] - p0[c])));
+		}
+		position += p_ratio;
+		produced++;
+	}
+	compact();
+	return produced;
+}
+
+void PortAudioResampler::compact() {
+	int drop = MIN((int)position - 1, buffer_frames);
+	if (drop <= 0) {
+		return;
+	}
+	memmove(buffer.data(), &buffer[(size_t)drop * channel_count], (size_t)(buffer_frames - drop) * channel_count * sizeof(float));
+	buffer_frames -= drop;
+	position -= drop;
+}
+
+double PortAudioResampler::get_buffered_frames() const {
+	return MAX(0.0, buffer_frames - position);
+}
+
+PortAudioResampler::PortAudioResampler() {
+	channel_count = 1;
+	capacity_frames = 0;
+	buffer_frames = 0;
+	position = 1.0;
+}
+
+void PortAudioDriftController::setup(double p_target_fill, double p_max_ppm) {
+	target_fill = MAX(p_target_fill, 1.0);
+	max_correction = p_max_ppm / 1000000.0;
+	filtered_error = 0;
+	integral = 0;
+	correction = 0;
+}
+
+double PortAudioDriftController::update(double p_fill, double p_period_frames) {
+	// the error in periods moves by exactly the ratio error each period, so the loop gain does not depend on how
+	// deep the buffer is. kp 3e-4 and ki 3e-8 damp it at about 0.87, a fixed offset settles in a few 10000 periods
+	double period = p_period_frames > 0 ? p_period_frames : target_fill;
+	double error = (p_fill - target_fill) / period;
+	// the fill level jumps by whole periods of the other clock, only its average is meaningful. the average has to be
+	// much faster than the loop but long enough that those jumps do not reach the ratio
+	filtered_error += 0.002 * (error - filtered_error);
+	integral = CLAMP(integral + filtered_error * 0.00000003, -max_correction, max_correction);
+	correction = CLAMP(filtered_error * 0.0003 + integral, -max_correction, max_correction);
+	return 1.0 + correction;
+}
+
+double PortAudioDriftController::get_ratio() const {
+	return 1.0 + correction;
+}
+
+double PortAudioDriftController::get_drift_ppm() const {
+	return correction * 1000000.0;
+}
+
+double PortAudioDriftController::get_target_fill() const {
+	return target_fill;
+}
+
+PortAudioDriftController::PortAudioDriftController() {
+	target_fill = 1.0;
+	max_correction = 0.005;
+	filtered_error = 0;
+	integral = 0;
+	correction = 0;
+}
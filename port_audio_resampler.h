@@ -0,0 +1,53 @@
+#ifndef PORT_AUDIO_RESAMPLER_H
+#define PORT_AUDIO_RESAMPLER_H
+
+#include <vector>
+
+// variable ratio resampler for interleaved float frames, catmull-rom interpolation.
+// the ratio (input frames per output frame) may change with every read, buffers are sized in setup()
+class PortAudioResampler {
+	int channel_count;
+	int capacity_frames;
+	std::vector<float> buffer;
+	int buffer_frames;
+	// read position in buffer frames, interpolation needs one frame before and two after it
+	double position;
+
+	void compact();
+
+public:
+	void setup(int p_channel_count, int p_max_block_frames);
+	void reset();
+
+	// input frames that have to be written before p_output_frames can be read
+	int get_required_input(int p_output_frames, double p_ratio) const;
+	// returns the frames accepted, the rest does not fit until more is read
+	int write(const float *p_input, int p_frames);
+	// returns the frames produced, less than p_frames when the input runs out
+	int read(float *r_output, int p_frames, double p_ratio);
+	// input frames not consumed yet, the latency the resampler adds
+	double get_buffered_frames() const;
+
+	PortAudioResampler();
+};
+
+// keeps the fill level of a buffer between two clocks at a target by steering a resampling ratio
+class PortAudioDriftController {
+	double target_fill;
+	double max_correction;
+	double filtered_error;
+	double integral;
+	double correction;
+
+public:
+	void setup(double p_target_fill, double p_max_ppm);
+	// once per period with the current fill level and the frames the period consumes, returns the ratio to resample with
+	double update(double p_fill, double p_period_frames);
+	double get_ratio() const;
+	double get_drift_ppm() const;
+	double get_target_fill() const;
+
+	PortAudioDriftController();
+};
+
+#endif
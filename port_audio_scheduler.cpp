@@ -0,0 +1,246 @@
+#include "port_audio_scheduler.h"
+
+#include "core/math/math_funcs.h"
+#include "core/os/memory.h"
+
+bool PortAudioScheduler::push(Event *p_event) {
+	collect();
+	if (PaUtil_GetRingBufferWriteAvailable(&incoming) < 1) {
+		return false;
+	}
+	PaUtil_WriteRingBuffer(&incoming, &p_event, 1);
+	return true;
+}
+
+void PortAudioScheduler::collect() {
+	// events are freed on the main thread, they may hold the last reference to sample data
+	Event *event;
+	while (PaUtil_ReadRingBuffer(&outgoing, &event, 1) == 1) {
+		delete event;
+	}
+}
+
+void PortAudioScheduler::retire(Event *p_event) {
+	if (PaUtil_WriteRingBuffer(&outgoing, &p_event, 1) != 1) {
+		// outgoing queue full, the event is leaked
+		leaked_events.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+Dictionary PortAudioScheduler::get_stats() {
+	Dictionary stats;
+	stats["leaked_events"] = leaked_events.load(std::memory_order_relaxed);
+	stats["failed_callbacks"] = failed_callbacks.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void PortAudioScheduler::drain_incoming() {
+	// keep pending events sorted by dac time, latest first, so the next due event is at the end. events with the
+	// same dac time keep their push order
+	while (pending_count < MAX_PENDING_EVENTS) {
+		Event *event;
+		if (PaUtil_ReadRingBuffer(&incoming, &event, 1) != 1) {
+			return;
+		}
+		int index = pending_count;
+		while (index > 0 && pending[index - 1]->dac_time <= event->dac_time) {
+			pending[index] = pending[index - 1];
+			index--;
+		}
+		pending[index] = event;
+		pending_count++;
+	}
+}
+
+PortAudioScheduler::Voice *PortAudioScheduler::find_voice(int p_voice_id) {
+	for (int i = 0; i < MAX_VOICES; i++) {
+		if (voices[i].active && voices[i].id == p_voice_id) {
+			return &voices[i];
+		}
+	}
+	return nullptr;
+}
+
+void PortAudioScheduler::start_voice(Event *p_event, int p_voice_id, float p_fade_frames) {
+	Voice *existing = find_voice(p_voice_id);
+	if (existing) {
+		existing->active = false;
+		retire(existing->source);
+	}
+	Voice *voice = nullptr;
+	for (int i = 0; i < MAX_VOICES; i++) {
+		if (!voices[i].active) {
+			voice = &voices[i];
+			break;
+		}
+	}
+	int sample_channel_count = p_event->sample_channel_count;
+	if (!voice || p_event->samples.size() == 0 || sample_channel_count <= 0) {
+		retire(p_event);
+		return;
+	}
+	voice->active = true;
+	voice->id = p_voice_id;
+	voice->source = p_event;
+	voice->samples = p_event->samples.ptr();
+	voice->frame_count = p_event->samples.size() / sample_channel_count;
+	voice->sample_channel_count = sample_channel_count;
+	voice->position = 0;
+	voice->loop = p_event->loop;
+	voice->gain = p_event->gain;
+	voice->stop_after_fade = false;
+	if (p_fade_frames > 0) {
+		voice->fade_gain = 0.0f;
+		voice->fade_step = 1.0f / p_fade_frames;
+	} else {
+		voice->fade_gain = 1.0f;
+		voice->fade_step = 0.0f;
+	}
+}
+
+void PortAudioScheduler::fade_out_voice(Voice *p_voice, float p_fade_frames) {
+	if (p_fade_frames <= 0) {
+		p_voice->active = false;
+		retire(p_voice->source);
+		return;
+	}
+	p_voice->fade_step = -p_voice->fade_gain / p_fade_frames;
+	p_voice->stop_after_fade = true;
+}
+
+void PortAudioScheduler::apply(Event *p_event, int p_offset) {
+	float fade_frames = (float)(p_event->fade * sample_rate);
+	switch (p_event->type) {
+		case PortAudio::START_VOICE: {
+			start_voice(p_event, p_event->voice_id, fade_frames);
+		} break;
+		case PortAudio::STOP_VOICE: {
+			Voice *voice = find_voice(p_event->voice_id);
+			if (voice) {
+				fade_out_voice(voice, fade_frames);
+			}
+			retire(p_event);
+		} break;
+		case PortAudio::CROSSFADE_VOICE: {
+			Voice *voice = find_voice(p_event->voice_id);
+			if (voice) {
+				fade_out_voice(voice, fade_frames);
+			}
+			start_voice(p_event, p_event->to_voice_id, fade_frames);
+		} break;
+		case PortAudio::FIRE_CALLBACK: {
+			Variant offset = p_offset;
+			Variant dac_time = p_event->dac_time;
+			const Variant *args[2] = { &offset, &dac_time };
+			Variant result;
+			Callable::CallError error;
+			p_event->callback.call(args, 2, result, error);
+			if (error.error != Callable::CallError::CALL_OK) {
+				failed_callbacks.fetch_add(1, std::memory_order_relaxed);
+			}
+			retire(p_event);
+		} break;
+		default: {
+			retire(p_event);
+		} break;
+	}
+}
+
+void PortAudioScheduler::mix(float *p_buffer, int p_from, int p_to) {
+	for (int v = 0; v < MAX_VOICES; v++) {
+		Voice &voice = voices[v];
+		if (!voice.active) {
+			continue;
+		}
+		for (int frame = p_from; frame < p_to; frame++) {
+			if (voice.position >= voice.frame_count) {
+				if (!voice.loop) {
+					voice.active = false;
+					retire(voice.source);
+					break;
+				}
+				voice.position = 0;
+			}
+			float gain = voice.gain * voice.fade_gain;
+			float *output = &p_buffer[frame * channel_count];
+			if (voice.sample_channel_count == channel_count) {
+				const float *input = &voice.samples[voice.position * channel_count];
+				for (int c = 0; c < channel_count; c++) {
+					output[c] += input[c] * gain;
+				}
+			} else {
+				float sample = voice.samples[voice.position * voice.sample_channel_count] * gain;
+				for (int c = 0; c < channel_count; c++) {
+					output[c] += sample;
+				}
+			}
+			voice.position++;
+			if (voice.fade_step != 0.0f) {
+				voice.fade_gain += voice.fade_step;
+				if (voice.fade_gain >= 1.0f) {
+					voice.fade_gain = 1.0f;
+					voice.fade_step = 0.0f;
+				} else if (voice.fade_gain <= 0.0f && voice.stop_after_fade) {
+					voice.active = false;
+					retire(voice.source);
+					break;
+				}
+			}
+		}
+	}
+}
+
+void PortAudioScheduler::process(float *p_buffer, unsigned long p_frames, double p_buffer_dac_time) {
+	drain_incoming();
+	int frames = (int)p_frames;
+	int cursor = 0;
+	while (pending_count > 0) {
+		Event *event = pending[pending_count - 1];
+		// late events fire at the start of the buffer
+		int offset = (int)Math::round((event->dac_time - p_buffer_dac_time) * sample_rate);
+		if (offset >= frames) {
+			break;
+		}
+		offset = MAX(offset, cursor);
+		mix(p_buffer, cursor, offset);
+		cursor = offset;
+		pending_count--;
+		apply(event, offset);
+	}
+	mix(p_buffer, cursor, frames);
+}
+
+PortAudioScheduler::PortAudioScheduler(double p_sample_rate, int p_channel_count) {
+	sample_rate = p_sample_rate;
+	channel_count = p_channel_count;
+	// outgoing must hold every event that can be in flight, queued and pending
+	incoming_data = memalloc(MAX_PENDING_EVENTS * sizeof(Event *));
+	outgoing_data = memalloc(MAX_PENDING_EVENTS * 4 * sizeof(Event *));
+	PaUtil_InitializeRingBuffer(&incoming, sizeof(Event *), MAX_PENDING_EVENTS, incoming_data);
+	PaUtil_InitializeRingBuffer(&outgoing, sizeof(Event *), MAX_PENDING_EVENTS * 4, outgoing_data);
+	pending_count = 0;
+	leaked_events.store(0);
+	failed_callbacks.store(0);
+	for (int i = 0; i < MAX_VOICES; i++) {
+		voices[i].active = false;
+		voices[i].source = nullptr;
+	}
+}
+
+PortAudioScheduler::~PortAudioScheduler() {
+	collect();
+	Event *event;
+	while (PaUtil_ReadRingBuffer(&incoming, &event, 1) == 1) {
+		delete event;
+	}
+	for (int i = 0; i < pending_count; i++) {
+		delete pending[i];
+	}
+	for (int i = 0; i < MAX_VOICES; i++) {
+		if (voices[i].active) {
+			delete voices[i].source;
+		}
+	}
+	memfree(incoming_data);
+	memfree(outgoing_data);
+}
@@ -0,0 +1,84 @@
+#ifndef PORT_AUDIO_SCHEDULER_H
+#define PORT_AUDIO_SCHEDULER_H
+
+#include "port_audio.h"
+
+#include "core/variant/callable.h"
+#include "core/variant/dictionary.h"
+#include "core/variant/variant.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+
+class PortAudioScheduler {
+public:
+	enum {
+		MAX_VOICES = 32,
+		MAX_PENDING_EVENTS = 256,
+	};
+
+	struct Event {
+		PortAudio::PortAudioScheduleEventType type;
+		double dac_time;
+		int voice_id;
+		int to_voice_id;
+		PackedFloat32Array samples;
+		int sample_channel_count;
+		float gain;
+		double fade;
+		bool loop;
+		Callable callback;
+	};
+
+private:
+	struct Voice {
+		bool active;
+		int id;
+		Event *source;
+		const float *samples;
+		int frame_count;
+		int sample_channel_count;
+		int position;
+		bool loop;
+		float gain;
+		float fade_gain;
+		float fade_step;
+		bool stop_after_fade;
+	};
+
+	double sample_rate;
+	int channel_count;
+	PaUtilRingBuffer incoming;
+	PaUtilRingBuffer outgoing;
+	void *incoming_data;
+	void *outgoing_data;
+	Event *pending[MAX_PENDING_EVENTS];
+	int pending_count;
+	Voice voices[MAX_VOICES];
+	// audio thread failures, counted instead of printed
+	std::atomic<uint64_t> leaked_events;
+	std::atomic<uint64_t> failed_callbacks;
+
+	void retire(Event *p_event);
+	void drain_incoming();
+	Voice *find_voice(int p_voice_id);
+	void start_voice(Event *p_event, int p_voice_id, float p_fade_frames);
+	void fade_out_voice(Voice *p_voice, float p_fade_frames);
+	void apply(Event *p_event, int p_offset);
+	void mix(float *p_buffer, int p_from, int p_to);
+
+public:
+	// main thread
+	bool push(Event *p_event);
+	void collect();
+	Dictionary get_stats();
+
+	// audio thread
+	void process(float *p_buffer, unsigned long p_frames, double p_buffer_dac_time);
+
+	PortAudioScheduler(double p_sample_rate, int p_channel_count);
+	~PortAudioScheduler();
+};
+
+#endif
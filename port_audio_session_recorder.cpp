@@ -0,0 +1,183 @@
+#include "port_audio_session_recorder.h"
+
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+#include <cstring>
+
+void PortAudioSessionRecorder::record(unsigned long p_frames, unsigned long p_status_flags, uint64_t p_ticks_usec, double p_input_buffer_adc_time,
+		double p_current_time, double p_output_buffer_dac_time, const uint8_t *p_input, uint32_t p_input_size,
+		int p_voice_gate_event, const uint8_t *p_pre_roll, uint32_t p_pre_roll_size) {
+	ring_buffer_size_t size = sizeof(PortAudioSessionFormat::RecordHeader) + p_input_size + p_pre_roll_size;
+	// single producer, the available space only grows until the record is written
+	if (PaUtil_GetRingBufferWriteAvailable(&buffer) < size) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		dropped_since_last++;
+		return;
+	}
+	PortAudioSessionFormat::RecordHeader record;
+	record.frames = (uint32_t)p_frames;
+	record.status_flags = (uint32_t)p_status_flags;
+	record.input_size = p_input_size;
+	record.dropped = dropped_since_last;
+	record.voice_gate_event = p_voice_gate_event;
+	record.pre_roll_size = p_pre_roll_size;
+	record.ticks_usec = p_ticks_usec;
+	record.input_buffer_adc_time = p_input_buffer_adc_time;
+	record.current_time = p_current_time;
+	record.output_buffer_dac_time = p_output_buffer_dac_time;
+	PaUtil_WriteRingBuffer(&buffer, &record, sizeof(record));
+	if (p_input_size > 0) {
+		PaUtil_WriteRingBuffer(&buffer, p_input, p_input_size);
+	}
+	if (p_pre_roll_size > 0) {
+		PaUtil_WriteRingBuffer(&buffer, p_pre_roll, p_pre_roll_size);
+	}
+	dropped_since_last = 0;
+}
+
+uint64_t PortAudioSessionRecorder::get_dropped_count() const {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+int PortAudioSessionRecorder::get_capacity() const {
+	return (int)buffer.bufferSize;
+}
+
+void PortAudioSessionRecorder::flush() {
+	void *data1;
+	void *data2;
+	ring_buffer_size_t size1;
+	ring_buffer_size_t size2;
+	ring_buffer_size_t available = PaUtil_GetRingBufferReadAvailable(&buffer);
+	if (available <= 0) {
+		return;
+	}
+	PaUtil_GetRingBufferReadRegions(&buffer, available, &data1, &size1, &data2, &size2);
+	file->store_buffer((const uint8_t *)data1, size1);
+	if (size2 > 0) {
+		file->store_buffer((const uint8_t *)data2, size2);
+	}
+	PaUtil_AdvanceRingBufferReadIndex(&buffer, available);
+	file->flush();
+}
+
+void PortAudioSessionRecorder::write_thread_main(void *p_recorder) {
+	PortAudioSessionRecorder *recorder = (PortAudioSessionRecorder *)p_recorder;
+	while (!recorder->write_exit.load()) {
+		OS::get_singleton()->delay_usec(20000);
+		recorder->flush();
+	}
+	recorder->flush();
+}
+
+Error PortAudioSessionRecorder::start(const String &p_path, const PortAudioSessionFormat::FileHeader &p_header) {
+	ERR_FAIL_COND_V(file != nullptr, ERR_ALREADY_IN_USE);
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	if (!file) {
+		return err;
+	}
+	file->store_buffer((const uint8_t *)&p_header, sizeof(p_header));
+	write_exit.store(false);
+	write_thread.start(&PortAudioSessionRecorder::write_thread_main, this);
+	return OK;
+}
+
+void PortAudioSessionRecorder::stop() {
+	if (!file) {
+		return;
+	}
+	write_exit.store(true);
+	write_thread.wait_to_finish();
+	file->close();
+	memdelete(file);
+	file = nullptr;
+}
+
+PortAudioSessionRecorder::PortAudioSessionRecorder(int p_capacity_bytes) {
+	// PaUtilRingBuffer needs a power of two element count
+	int capacity = next_power_of_2(MAX(p_capacity_bytes, 65536));
+	buffer_data = memalloc(capacity);
+	PaUtil_InitializeRingBuffer(&buffer, 1, capacity, buffer_data);
+	dropped.store(0);
+	dropped_since_last = 0;
+	file = nullptr;
+	write_exit.store(false);
+}
+
+PortAudioSessionRecorder::~PortAudioSessionRecorder() {
+	stop();
+	memfree(buffer_data);
+}
+
+Error PortAudioSessionReader::open(const String &p_path) {
+	ERR_FAIL_COND_V(file != nullptr, ERR_ALREADY_IN_USE);
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::READ, &err);
+	if (!file) {
+		return err;
+	}
+	if (file->get_buffer((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+			header.magic != PortAudioSessionFormat::MAGIC || header.version != PortAudioSessionFormat::VERSION) {
+		close();
+		return ERR_FILE_UNRECOGNIZED;
+	}
+	return OK;
+}
+
+void PortAudioSessionReader::close() {
+	if (!file) {
+		return;
+	}
+	file->close();
+	memdelete(file);
+	file = nullptr;
+}
+
+const PortAudioSessionFormat::FileHeader &PortAudioSessionReader::get_header() const {
+	return header;
+}
+
+bool PortAudioSessionReader::read_next(PortAudioSessionFormat::RecordHeader &r_record, Vector<uint8_t> &r_input, Vector<uint8_t> &r_pre_roll) {
+	if (!file) {
+		return false;
+	}
+	// a session cut off by a crash ends with a partial record, it is ignored
+	if (file->get_buffer((uint8_t *)&r_record, sizeof(r_record)) != sizeof(r_record)) {
+		return false;
+	}
+	// a corrupt record must not drive the allocations below, the recorder always writes whole frames
+	uint64_t input_frame_size = (uint64_t)header.input_channel_count * header.input_sample_size;
+	uint64_t pre_roll_frame_size = (uint64_t)header.input_channel_count * sizeof(float);
+	if (header.frames_per_buffer > 0 && r_record.frames > header.frames_per_buffer) {
+		return false;
+	}
+	if (r_record.input_size != r_record.frames * input_frame_size) {
+		return false;
+	}
+	if (r_record.pre_roll_size > 0 && (pre_roll_frame_size == 0 || r_record.pre_roll_size % pre_roll_frame_size != 0)) {
+		return false;
+	}
+	if ((uint64_t)r_record.input_size + r_record.pre_roll_size > file->get_length() - file->get_position()) {
+		return false;
+	}
+	r_input.resize(r_record.input_size);
+	if (r_record.input_size > 0 && file->get_buffer(r_input.ptrw(), r_record.input_size) != r_record.input_size) {
+		return false;
+	}
+	r_pre_roll.resize(r_record.pre_roll_size);
+	if (r_record.pre_roll_size > 0 && file->get_buffer(r_pre_roll.ptrw(), r_record.pre_roll_size) != r_record.pre_roll_size) {
+		return false;
+	}
+	return true;
+}
+
+PortAudioSessionReader::PortAudioSessionReader() {
+	file = nullptr;
+	memset(&header, 0, sizeof(header));
+}
+
+PortAudioSessionReader::~PortAudioSessionReader() {
+	close();
+}
@@ -0,0 +1,95 @@
+#ifndef PORT_AUDIO_SESSION_RECORDER_H
+#define PORT_AUDIO_SESSION_RECORDER_H
+
+#include "core/io/file_access.h"
+#include "core/os/thread.h"
+#include "core/string/ustring.h"
+#include "core/templates/vector.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+
+// file layout, host byte order: FileHeader followed by one RecordHeader + input bytes + pre-roll bytes per callback
+struct PortAudioSessionFormat {
+	enum {
+		MAGIC = 0x52534150, // "PASR"
+		VERSION = 2,
+	};
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t version;
+		double sample_rate;
+		uint32_t frames_per_buffer;
+		uint32_t input_channel_count;
+		uint32_t input_sample_size;
+		uint32_t output_channel_count;
+		uint32_t output_sample_size;
+		uint32_t reserved;
+	};
+
+	struct RecordHeader {
+		uint32_t frames;
+		uint32_t status_flags;
+		uint32_t input_size;
+		// callbacks lost right before this one because the writer fell behind
+		uint32_t dropped;
+		// voice gate state the script saw, pre_roll_size bytes of FLOAT_32 input frames follow the input
+		int32_t voice_gate_event;
+		uint32_t pre_roll_size;
+		uint64_t ticks_usec;
+		double input_buffer_adc_time;
+		double current_time;
+		double output_buffer_dac_time;
+	};
+};
+
+// records the callbacks of one stream, a background thread writes them to disk
+class PortAudioSessionRecorder {
+	PaUtilRingBuffer buffer;
+	void *buffer_data;
+	std::atomic<uint64_t> dropped;
+	uint32_t dropped_since_last;
+
+	FileAccess *file;
+	Thread write_thread;
+	std::atomic<bool> write_exit;
+
+	static void write_thread_main(void *p_recorder);
+	void flush();
+
+public:
+	Error start(const String &p_path, const PortAudioSessionFormat::FileHeader &p_header);
+	void stop();
+
+	// audio thread, never blocks. a callback that does not fit is dropped as a whole
+	void record(unsigned long p_frames, unsigned long p_status_flags, uint64_t p_ticks_usec, double p_input_buffer_adc_time,
+			double p_current_time, double p_output_buffer_dac_time, const uint8_t *p_input, uint32_t p_input_size,
+			int p_voice_gate_event, const uint8_t *p_pre_roll, uint32_t p_pre_roll_size);
+
+	uint64_t get_dropped_count() const;
+	// ring buffer size in bytes, the largest record that fits
+	int get_capacity() const;
+
+	PortAudioSessionRecorder(int p_capacity_bytes);
+	~PortAudioSessionRecorder();
+};
+
+// sequential access to a recorded session
+class PortAudioSessionReader {
+	FileAccess *file;
+	PortAudioSessionFormat::FileHeader header;
+
+public:
+	Error open(const String &p_path);
+	void close();
+	const PortAudioSessionFormat::FileHeader &get_header() const;
+	// false at the end of the file, on a truncated record or on sizes that do not match the header
+	bool read_next(PortAudioSessionFormat::RecordHeader &r_record, Vector<uint8_t> &r_input, Vector<uint8_t> &r_pre_roll);
+
+	PortAudioSessionReader();
+	~PortAudioSessionReader();
+};
+
+#endif
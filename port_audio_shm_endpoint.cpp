@@ -0,0 +1,132 @@
+#include "port_audio_shm_endpoint.h"
+
+#include "core/typedefs.h"
+
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#endif
+
+bool PortAudioShmEndpoint::is_supported() {
+#ifdef __linux__
+	return true;
+#else
+	return false;
+#endif
+}
+
+Error PortAudioShmEndpoint::create(const String &p_name, int p_channel_count, double p_sample_rate, int p_capacity_frames, bool p_input) {
+#ifdef __linux__
+	ERR_FAIL_COND_V(header != nullptr, ERR_ALREADY_IN_USE);
+	ERR_FAIL_COND_V(p_channel_count <= 0, ERR_INVALID_PARAMETER);
+	name = p_name.begins_with("/") ? p_name : "/" + p_name;
+	uint32_t capacity_frames = next_power_of_2((uint32_t)MAX(p_capacity_frames, 1024));
+	CharString name_utf8 = name.utf8();
+	// never attach to a segment another process or endpoint still owns, readers would see two writers
+	fd = shm_open(name_utf8.get_data(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0) {
+		return errno == EEXIST ? ERR_ALREADY_EXISTS : ERR_CANT_CREATE;
+	}
+	mapped_size = PORT_AUDIO_SHM_SIZE(p_channel_count, capacity_frames);
+	if (ftruncate(fd, mapped_size) != 0) {
+		::close(fd);
+		shm_unlink(name_utf8.get_data());
+		fd = -1;
+		return ERR_CANT_CREATE;
+	}
+	void *memory = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (memory == MAP_FAILED) {
+		::close(fd);
+		shm_unlink(name_utf8.get_data());
+		fd = -1;
+		return ERR_CANT_CREATE;
+	}
+	// touching every page now keeps page faults out of the callback
+	memset(memory, 0, mapped_size);
+	header = (PortAudioShmHeader *)memory;
+	samples = PORT_AUDIO_SHM_SAMPLES(header);
+	header->channel_count = (uint32_t)p_channel_count;
+	header->capacity_frames = capacity_frames;
+	header->sample_rate = p_sample_rate;
+	header->version = PORT_AUDIO_SHM_VERSION;
+	__atomic_store_n(&header->magic, PORT_AUDIO_SHM_MAGIC, __ATOMIC_RELEASE);
+	write_position = 0;
+	input = p_input;
+	return OK;
+#else
+	return ERR_UNAVAILABLE;
+#endif
+}
+
+void PortAudioShmEndpoint::close() {
+#ifdef __linux__
+	if (!header) {
+		return;
+	}
+	// readers see closed after draining what is left
+	__atomic_store_n(&header->closed, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&header->futex, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	munmap(header, mapped_size);
+	::close(fd);
+	shm_unlink(name.utf8().get_data());
+	header = nullptr;
+	samples = nullptr;
+	fd = -1;
+#endif
+}
+
+bool PortAudioShmEndpoint::is_input() const {
+	return input;
+}
+
+int PortAudioShmEndpoint::get_channel_count() const {
+	return header ? (int)header->channel_count : 0;
+}
+
+void PortAudioShmEndpoint::write(const float *p_frames, unsigned long p_frame_count) {
+#ifdef __linux__
+	const uint32_t channel_count = header->channel_count;
+	const uint64_t capacity = header->capacity_frames;
+	if (p_frame_count > capacity) {
+		p_frames += (p_frame_count - capacity) * channel_count;
+		p_frame_count = capacity;
+	}
+	// readers drop frames below reserve_position - capacity, they may be half overwritten
+	__atomic_store_n(&header->reserve_position, write_position + p_frame_count, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	uint64_t offset = write_position & (capacity - 1);
+	uint64_t first = MIN(capacity - offset, (uint64_t)p_frame_count);
+	memcpy(samples + offset * channel_count, p_frames, first * channel_count * sizeof(float));
+	memcpy(samples, p_frames + first * channel_count, (p_frame_count - first) * channel_count * sizeof(float));
+	write_position += p_frame_count;
+	__atomic_store_n(&header->write_position, write_position, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&header->futex, 1, __ATOMIC_SEQ_CST);
+	// the wake is a syscall, skip it while no reader is waiting
+	if (__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST) > 0) {
+		syscall(SYS_futex, &header->futex, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+	}
+#endif
+}
+
+PortAudioShmEndpoint::PortAudioShmEndpoint() {
+	fd = -1;
+	mapped_size = 0;
+	header = nullptr;
+	samples = nullptr;
+	write_position = 0;
+	input = false;
+}
+
+PortAudioShmEndpoint::~PortAudioShmEndpoint() {
+	close();
+}
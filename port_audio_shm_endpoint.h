@@ -0,0 +1,35 @@
+#ifndef PORT_AUDIO_SHM_ENDPOINT_H
+#define PORT_AUDIO_SHM_ENDPOINT_H
+
+#include "tools/shm_reader/port_audio_shm.h"
+
+#include "core/error/error_list.h"
+#include "core/string/ustring.h"
+
+// posix shared memory ring a stream publishes its float frames into, readers use tools/shm_reader
+class PortAudioShmEndpoint {
+private:
+	String name;
+	int fd;
+	size_t mapped_size;
+	PortAudioShmHeader *header;
+	float *samples;
+	uint64_t write_position;
+	bool input;
+
+public:
+	static bool is_supported();
+
+	Error create(const String &p_name, int p_channel_count, double p_sample_rate, int p_capacity_frames, bool p_input);
+	void close();
+	bool is_input() const;
+	int get_channel_count() const;
+
+	// audio thread, never blocks on readers
+	void write(const float *p_frames, unsigned long p_frame_count);
+
+	PortAudioShmEndpoint();
+	~PortAudioShmEndpoint();
+};
+
+#endif
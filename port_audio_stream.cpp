@@ -78,6 +78,74 @@ void PortAudioStream::set_stream_flags(PortAudioStreamFlag p_stream_flags) {
 	stream_flags = p_stream_flags;
 }
 
+Ref<PortAudioGraph> PortAudioStream::get_graph() {
+	return graph;
+}
+
+void PortAudioStream::set_graph(Ref<PortAudioGraph> p_graph) {
+	graph = p_graph;
+}
+
+Ref<PortAudioConvolver> PortAudioStream::get_convolver() {
+	return convolver;
+}
+
+void PortAudioStream::set_convolver(Ref<PortAudioConvolver> p_convolver) {
+	convolver = p_convolver;
+}
+
+Ref<PortAudioVoiceGate> PortAudioStream::get_voice_gate() {
+	return voice_gate;
+}
+
+void PortAudioStream::set_voice_gate(Ref<PortAudioVoiceGate> p_voice_gate) {
+	voice_gate = p_voice_gate;
+}
+
+Ref<PortAudioWatchdog> PortAudioStream::get_watchdog() {
+	return watchdog;
+}
+
+void PortAudioStream::set_watchdog(Ref<PortAudioWatchdog> p_watchdog) {
+	watchdog = p_watchdog;
+}
+
+Ref<PortAudioJitterBuffer> PortAudioStream::get_jitter_buffer() {
+	return jitter_buffer;
+}
+
+void PortAudioStream::set_jitter_buffer(Ref<PortAudioJitterBuffer> p_jitter_buffer) {
+	jitter_buffer = p_jitter_buffer;
+}
+
+Ref<PortAudioBroadcast> PortAudioStream::get_broadcast() {
+	return broadcast;
+}
+
+void PortAudioStream::set_broadcast(Ref<PortAudioBroadcast> p_broadcast) {
+	broadcast = p_broadcast;
+}
+
+Ref<PortAudioLimiter> PortAudioStream::get_limiter() {
+	return limiter;
+}
+
+void PortAudioStream::set_limiter(Ref<PortAudioLimiter> p_limiter) {
+	limiter = p_limiter;
+}
+
+double PortAudioStream::get_input_alignment() {
+	return input_alignment.load(std::memory_order_relaxed);
+}
+
+void PortAudioStream::set_input_alignment(double p_input_alignment) {
+	input_alignment.store(MAX(p_input_alignment, 0.0), std::memory_order_relaxed);
+}
+
+PortAudioClock *PortAudioStream::get_clock() {
+	return &clock;
+}
+
 void *PortAudioStream::get_stream() {
 	return stream;
 }
@@ -101,6 +169,22 @@ void PortAudioStream::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_output_stream_parameter", "output_stream_parameter"), &PortAudioStream::set_output_stream_parameter);
 	ClassDB::bind_method(D_METHOD("get_stream_flags"), &PortAudioStream::get_stream_flags);
 	ClassDB::bind_method(D_METHOD("set_stream_flags", "stream_flags"), &PortAudioStream::set_stream_flags);
+	ClassDB::bind_method(D_METHOD("get_graph"), &PortAudioStream::get_graph);
+	ClassDB::bind_method(D_METHOD("set_graph", "graph"), &PortAudioStream::set_graph);
+	ClassDB::bind_method(D_METHOD("get_convolver"), &PortAudioStream::get_convolver);
+	ClassDB::bind_method(D_METHOD("set_convolver", "convolver"), &PortAudioStream::set_convolver);
+	ClassDB::bind_method(D_METHOD("get_voice_gate"), &PortAudioStream::get_voice_gate);
+	ClassDB::bind_method(D_METHOD("set_voice_gate", "voice_gate"), &PortAudioStream::set_voice_gate);
+	ClassDB::bind_method(D_METHOD("get_watchdog"), &PortAudioStream::get_watchdog);
+	ClassDB::bind_method(D_METHOD("set_watchdog", "watchdog"), &PortAudioStream::set_watchdog);
+	ClassDB::bind_method(D_METHOD("get_jitter_buffer"), &PortAudioStream::get_jitter_buffer);
+	ClassDB::bind_method(D_METHOD("set_jitter_buffer", "jitter_buffer"), &PortAudioStream::set_jitter_buffer);
+	ClassDB::bind_method(D_METHOD("get_broadcast"), &PortAudioStream::get_broadcast);
+	ClassDB::bind_method(D_METHOD("set_broadcast", "broadcast"), &PortAudioStream::set_broadcast);
+	ClassDB::bind_method(D_METHOD("get_limiter"), &PortAudioStream::get_limiter);
+	ClassDB::bind_method(D_METHOD("set_limiter", "limiter"), &PortAudioStream::set_limiter);
+	ClassDB::bind_method(D_METHOD("get_input_alignment"), &PortAudioStream::get_input_alignment);
+	ClassDB::bind_method(D_METHOD("set_input_alignment", "input_alignment"), &PortAudioStream::set_input_alignment);
 
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "input_channel_count"), "set_input_channel_count", "get_input_channel_count");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "output_channel_count"), "set_output_channel_count", "get_output_channel_count");
@@ -110,6 +194,14 @@ void PortAudioStream::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "input_stream_parameter", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStreamParameter"), "set_input_stream_parameter", "get_input_stream_parameter");
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "output_stream_parameter", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioStreamParameter"), "set_output_stream_parameter", "get_output_stream_parameter");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "stream_flags", PROPERTY_HINT_FLAGS, "NO_FLAG, CLIP_OFF, DITHER_OFF, NEVER_DROP_INPUT, PRIME_OOUTPUT_BUFFERS_USING_STREAM_CALLBACK, PLATFORM_SPECIFIC_FLAGS"), "set_stream_flags", "get_stream_flags");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "graph", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioGraph"), "set_graph", "get_graph");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "convolver", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioConvolver"), "set_convolver", "get_convolver");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "voice_gate", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioVoiceGate"), "set_voice_gate", "get_voice_gate");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "watchdog", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioWatchdog"), "set_watchdog", "get_watchdog");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "jitter_buffer", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioJitterBuffer"), "set_jitter_buffer", "get_jitter_buffer");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "broadcast", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioBroadcast"), "set_broadcast", "get_broadcast");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "limiter", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioLimiter"), "set_limiter", "get_limiter");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "input_alignment"), "set_input_alignment", "get_input_alignment");
 
 	// PortAudioStreamFlag
 	BIND_ENUM_CONSTANT(NO_FLAG);
@@ -127,6 +219,14 @@ PortAudioStream::PortAudioStream() {
 	input_stream_parameter = Ref<PortAudioStreamParameter>();
 	output_stream_parameter = Ref<PortAudioStreamParameter>();
 	stream_flags = NO_FLAG;
+	graph = Ref<PortAudioGraph>();
+	convolver = Ref<PortAudioConvolver>();
+	voice_gate = Ref<PortAudioVoiceGate>();
+	watchdog = Ref<PortAudioWatchdog>();
+	jitter_buffer = Ref<PortAudioJitterBuffer>();
+	broadcast = Ref<PortAudioBroadcast>();
+	limiter = Ref<PortAudioLimiter>();
+	input_alignment.store(0.0);
 }
 
 PortAudioStream::~PortAudioStream() {
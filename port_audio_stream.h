@@ -1,10 +1,20 @@
 #ifndef PORT_AUDIO_STREAM_H
 #define PORT_AUDIO_STREAM_H
 
+#include "port_audio_broadcast.h"
+#include "port_audio_clock.h"
+#include "port_audio_convolver.h"
+#include "port_audio_graph.h"
+#include "port_audio_jitter_buffer.h"
+#include "port_audio_limiter.h"
 #include "port_audio_stream_parameter.h"
+#include "port_audio_voice_gate.h"
+#include "port_audio_watchdog.h"
 
 #include "core/io/resource.h"
 
+#include <atomic>
+
 class PortAudioStream : public Resource {
 	GDCLASS(PortAudioStream, Resource);
 
@@ -25,6 +35,15 @@ private:
 	Ref<PortAudioStreamParameter> input_stream_parameter;
 	Ref<PortAudioStreamParameter> output_stream_parameter;
 	PortAudioStreamFlag stream_flags;
+	Ref<PortAudioGraph> graph;
+	Ref<PortAudioConvolver> convolver;
+	Ref<PortAudioVoiceGate> voice_gate;
+	Ref<PortAudioWatchdog> watchdog;
+	Ref<PortAudioJitterBuffer> jitter_buffer;
+	Ref<PortAudioBroadcast> broadcast;
+	Ref<PortAudioLimiter> limiter;
+	PortAudioClock clock;
+	std::atomic<double> input_alignment;
 
 protected:
 	static void _bind_methods();
@@ -44,6 +63,23 @@ public:
 	void set_output_stream_parameter(Ref<PortAudioStreamParameter> p_output_stream_parameter);
 	PortAudioStreamFlag get_stream_flags();
 	void set_stream_flags(PortAudioStreamFlag p_stream_flags);
+	Ref<PortAudioGraph> get_graph();
+	void set_graph(Ref<PortAudioGraph> p_graph);
+	Ref<PortAudioConvolver> get_convolver();
+	void set_convolver(Ref<PortAudioConvolver> p_convolver);
+	Ref<PortAudioVoiceGate> get_voice_gate();
+	void set_voice_gate(Ref<PortAudioVoiceGate> p_voice_gate);
+	Ref<PortAudioWatchdog> get_watchdog();
+	void set_watchdog(Ref<PortAudioWatchdog> p_watchdog);
+	Ref<PortAudioJitterBuffer> get_jitter_buffer();
+	void set_jitter_buffer(Ref<PortAudioJitterBuffer> p_jitter_buffer);
+	Ref<PortAudioBroadcast> get_broadcast();
+	void set_broadcast(Ref<PortAudioBroadcast> p_broadcast);
+	Ref<PortAudioLimiter> get_limiter();
+	void set_limiter(Ref<PortAudioLimiter> p_limiter);
+	double get_input_alignment();
+	void set_input_alignment(double p_input_alignment);
+	PortAudioClock *get_clock();
 	void *get_stream();
 	void set_stream(void *p_stream);
 
@@ -42,6 +42,22 @@ void *PortAudioStreamParameter::get_host_api_specific_stream_info() {
 	return host_api_specific_stream_info;
 }
 
+void PortAudioStreamParameter::set_channel_routing(Ref<PortAudioChannelRouting> p_channel_routing) {
+	channel_routing = p_channel_routing;
+}
+
+Ref<PortAudioChannelRouting> PortAudioStreamParameter::get_channel_routing() {
+	return channel_routing;
+}
+
+void PortAudioStreamParameter::set_conditioning(Ref<PortAudioInputConditioning> p_conditioning) {
+	conditioning = p_conditioning;
+}
+
+Ref<PortAudioInputConditioning> PortAudioStreamParameter::get_conditioning() {
+	return conditioning;
+}
+
 void PortAudioStreamParameter::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_device_index"), &PortAudioStreamParameter::get_device_index);
 	ClassDB::bind_method(D_METHOD("set_device_index", "device_index"), &PortAudioStreamParameter::set_device_index);
@@ -51,11 +67,17 @@ void PortAudioStreamParameter::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("set_sample_format", "sample_format"), &PortAudioStreamParameter::set_sample_format);
 	ClassDB::bind_method(D_METHOD("get_suggested_latency"), &PortAudioStreamParameter::get_suggested_latency);
 	ClassDB::bind_method(D_METHOD("set_suggested_latency", "suggested_latency"), &PortAudioStreamParameter::set_suggested_latency);
+	ClassDB::bind_method(D_METHOD("get_channel_routing"), &PortAudioStreamParameter::get_channel_routing);
+	ClassDB::bind_method(D_METHOD("set_channel_routing", "channel_routing"), &PortAudioStreamParameter::set_channel_routing);
+	ClassDB::bind_method(D_METHOD("get_conditioning"), &PortAudioStreamParameter::get_conditioning);
+	ClassDB::bind_method(D_METHOD("set_conditioning", "conditioning"), &PortAudioStreamParameter::set_conditioning);
 
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "device_index"), "set_device_index", "get_device_index");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "channel_count"), "set_channel_count", "get_channel_count");
 	ADD_PROPERTY(PropertyInfo(Variant::INT, "sample_format", PROPERTY_HINT_ENUM, "FLOAT_32, INT_32, INT_24, INT_16, INT_8, U_INT_8, CUSTOM_FORMAT, NON_INTERLEAVED"), "set_sample_format", "get_sample_format");
 	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "suggested_latency"), "set_suggested_latency", "get_suggested_latency");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "channel_routing", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioChannelRouting"), "set_channel_routing", "get_channel_routing");
+	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "conditioning", PROPERTY_HINT_RESOURCE_TYPE, "PortAudioInputConditioning"), "set_conditioning", "get_conditioning");
 
 	// PortAudioSampleSize
 	BIND_ENUM_CONSTANT(FLOAT_32);
@@ -74,6 +96,8 @@ PortAudioStreamParameter::PortAudioStreamParameter() {
 	sample_format = PortAudioStreamParameter::PortAudioSampleFormat::FLOAT_32;
 	suggested_latency = 0;
 	host_api_specific_stream_info = nullptr;
+	channel_routing = Ref<PortAudioChannelRouting>();
+	conditioning = Ref<PortAudioInputConditioning>();
 }
 
 PortAudioStreamParameter::~PortAudioStreamParameter() {
@@ -1,6 +1,9 @@
 #ifndef PORT_AUDIO_STREAM_PARAMETER_H
 #define PORT_AUDIO_STREAM_PARAMETER_H
 
+#include "port_audio_channel_routing.h"
+#include "port_audio_input_conditioning.h"
+
 #include "core/io/resource.h"
 
 class PortAudioStreamParameter : public Resource {
@@ -24,6 +27,8 @@ private:
 	PortAudioSampleFormat sample_format;
 	double suggested_latency;
 	void *host_api_specific_stream_info;
+	Ref<PortAudioChannelRouting> channel_routing;
+	Ref<PortAudioInputConditioning> conditioning;
 
 protected:
 	static void _bind_methods();
@@ -39,6 +44,10 @@ public:
 	double get_suggested_latency();
 	void set_host_api_specific_stream_info(void *p_host_api_specific_stream_info);
 	void *get_host_api_specific_stream_info();
+	void set_channel_routing(Ref<PortAudioChannelRouting> p_channel_routing);
+	Ref<PortAudioChannelRouting> get_channel_routing();
+	void set_conditioning(Ref<PortAudioInputConditioning> p_conditioning);
+	Ref<PortAudioInputConditioning> get_conditioning();
 	PortAudioStreamParameter();
 	~PortAudioStreamParameter();
 };
@@ -0,0 +1,134 @@
+#include "port_audio_tracer.h"
+
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+#include <cstring>
+
+void PortAudioTracer::record_callback(uint64_t p_start_usec, uint64_t p_end_usec, unsigned long p_frames, unsigned long p_status_flags,
+		double p_input_buffer_adc_time, double p_current_time, double p_output_buffer_dac_time) {
+	Record record;
+	record.type = RECORD_CALLBACK;
+	record.frames = (uint32_t)p_frames;
+	record.status_flags = (uint32_t)p_status_flags;
+	record.start_usec = p_start_usec;
+	record.end_usec = p_end_usec;
+	record.input_buffer_adc_time = p_input_buffer_adc_time;
+	record.current_time = p_current_time;
+	record.output_buffer_dac_time = p_output_buffer_dac_time;
+	record.name[0] = '\0';
+	if (PaUtil_WriteRingBuffer(&callbacks, &record, 1) != 1) {
+		// the flusher fell behind, never wait on the audio thread
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void PortAudioTracer::add_marker(const String &p_name) {
+	Record record;
+	memset(&record, 0, sizeof(Record));
+	record.type = RECORD_MARKER;
+	record.start_usec = OS::get_singleton()->get_ticks_usec();
+	record.end_usec = record.start_usec;
+	CharString name = p_name.utf8();
+	strncpy(record.name, name.get_data(), MARKER_NAME_LENGTH - 1);
+	MutexLock lock(marker_mutex);
+	if (PaUtil_WriteRingBuffer(&markers, &record, 1) != 1) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint64_t PortAudioTracer::get_dropped_count() const {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+void PortAudioTracer::write_event(const Record &p_record) {
+	String event;
+	if (p_record.type == RECORD_CALLBACK) {
+		event = vformat("{\"name\":\"callback\",\"cat\":\"audio\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%d,\"dur\":%d,\"args\":{\"frames\":%d,\"status_flags\":%d,",
+				(int64_t)p_record.start_usec, (int64_t)(p_record.end_usec - p_record.start_usec), p_record.frames, p_record.status_flags);
+		event += vformat("\"input_buffer_adc_time\":%s,\"current_time\":%s,\"output_buffer_dac_time\":%s}}",
+				String::num(p_record.input_buffer_adc_time, 9), String::num(p_record.current_time, 9), String::num(p_record.output_buffer_dac_time, 9));
+	} else {
+		event = vformat("{\"name\":%s,\"cat\":\"marker\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":2,\"ts\":%d}",
+				String(p_record.name).json_escape().quote(), (int64_t)p_record.start_usec);
+	}
+	file->store_string(first_event ? "\n" : ",\n");
+	file->store_string(event);
+	first_event = false;
+}
+
+void PortAudioTracer::flush() {
+	// records are merged by time so the file stays ordered
+	Record callback;
+	Record marker;
+	bool has_callback = PaUtil_ReadRingBuffer(&callbacks, &callback, 1) == 1;
+	bool has_marker = PaUtil_ReadRingBuffer(&markers, &marker, 1) == 1;
+	while (has_callback || has_marker) {
+		if (has_callback && (!has_marker || callback.start_usec <= marker.start_usec)) {
+			write_event(callback);
+			has_callback = PaUtil_ReadRingBuffer(&callbacks, &callback, 1) == 1;
+		} else {
+			write_event(marker);
+			has_marker = PaUtil_ReadRingBuffer(&markers, &marker, 1) == 1;
+		}
+	}
+	file->flush();
+}
+
+void PortAudioTracer::flush_thread_main(void *p_tracer) {
+	PortAudioTracer *tracer = (PortAudioTracer *)p_tracer;
+	while (!tracer->flush_exit.load()) {
+		OS::get_singleton()->delay_usec(50000);
+		tracer->flush();
+	}
+	tracer->flush();
+}
+
+Error PortAudioTracer::start(const String &p_path, const String &p_stream_name) {
+	ERR_FAIL_COND_V(file != nullptr, ERR_ALREADY_IN_USE);
+	Error err;
+	file = FileAccess::open(p_path, FileAccess::WRITE, &err);
+	if (!file) {
+		return err;
+	}
+	// the json array format is still readable if the closing bracket is never written
+	file->store_string("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	file->store_string("\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":" + p_stream_name.json_escape().quote() + "}},");
+	file->store_string("\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"callback\"}},");
+	file->store_string("\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"markers\"}}");
+	first_event = false;
+	flush_exit.store(false);
+	flush_thread.start(&PortAudioTracer::flush_thread_main, this);
+	return OK;
+}
+
+void PortAudioTracer::stop() {
+	if (!file) {
+		return;
+	}
+	flush_exit.store(true);
+	flush_thread.wait_to_finish();
+	file->store_string("\n]}\n");
+	file->close();
+	memdelete(file);
+	file = nullptr;
+}
+
+PortAudioTracer::PortAudioTracer(int p_capacity) {
+	// PaUtilRingBuffer needs a power of two element count
+	int capacity = next_power_of_2(MAX(p_capacity, 64));
+	callback_data = memalloc(capacity * sizeof(Record));
+	marker_data = memalloc(MAX_MARKERS * sizeof(Record));
+	PaUtil_InitializeRingBuffer(&callbacks, sizeof(Record), capacity, callback_data);
+	PaUtil_InitializeRingBuffer(&markers, sizeof(Record), MAX_MARKERS, marker_data);
+	dropped.store(0);
+	file = nullptr;
+	first_event = true;
+	flush_exit.store(false);
+}
+
+PortAudioTracer::~PortAudioTracer() {
+	stop();
+	memfree(callback_data);
+	memfree(marker_data);
+}
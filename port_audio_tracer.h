@@ -0,0 +1,71 @@
+#ifndef PORT_AUDIO_TRACER_H
+#define PORT_AUDIO_TRACER_H
+
+#include "core/io/file_access.h"
+#include "core/os/mutex.h"
+#include "core/os/thread.h"
+#include "core/string/ustring.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+
+// records callback activity of one stream and streams it to a chrome trace / perfetto json file
+class PortAudioTracer {
+public:
+	enum RecordType {
+		RECORD_CALLBACK = 0,
+		RECORD_MARKER = 1,
+	};
+
+	enum {
+		MARKER_NAME_LENGTH = 32,
+		MAX_MARKERS = 256,
+	};
+
+	struct Record {
+		uint32_t type;
+		uint32_t frames;
+		uint32_t status_flags;
+		uint64_t start_usec;
+		uint64_t end_usec;
+		double input_buffer_adc_time;
+		double current_time;
+		double output_buffer_dac_time;
+		char name[MARKER_NAME_LENGTH];
+	};
+
+private:
+	// callbacks are written by the audio thread only, markers by any thread under marker_mutex
+	PaUtilRingBuffer callbacks;
+	PaUtilRingBuffer markers;
+	void *callback_data;
+	void *marker_data;
+	Mutex marker_mutex;
+	std::atomic<uint64_t> dropped;
+
+	FileAccess *file;
+	bool first_event;
+	Thread flush_thread;
+	std::atomic<bool> flush_exit;
+
+	static void flush_thread_main(void *p_tracer);
+	void flush();
+	void write_event(const Record &p_record);
+
+public:
+	Error start(const String &p_path, const String &p_stream_name);
+	void stop();
+
+	// audio thread
+	void record_callback(uint64_t p_start_usec, uint64_t p_end_usec, unsigned long p_frames, unsigned long p_status_flags,
+			double p_input_buffer_adc_time, double p_current_time, double p_output_buffer_dac_time);
+
+	void add_marker(const String &p_name);
+	uint64_t get_dropped_count() const;
+
+	PortAudioTracer(int p_capacity);
+	~PortAudioTracer();
+};
+
+#endif
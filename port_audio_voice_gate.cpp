@@ -0,0 +1,229 @@
+#include "port_audio_voice_gate.h"
+
+#include "core/math/math_funcs.h"
+
+#include <cmath>
+#include <cstring>
+
+void PortAudioVoiceGate::set_threshold_db(float p_threshold_db) {
+	threshold_db = p_threshold_db;
+}
+
+float PortAudioVoiceGate::get_threshold_db() {
+	return threshold_db;
+}
+
+void PortAudioVoiceGate::set_flatness_threshold(float p_flatness_threshold) {
+	flatness_threshold = CLAMP(p_flatness_threshold, 0.0f, 1.0f);
+}
+
+float PortAudioVoiceGate::get_flatness_threshold() {
+	return flatness_threshold;
+}
+
+void PortAudioVoiceGate::set_hangover(double p_hangover) {
+	hangover = MAX(p_hangover, 0.0);
+	if (prepared) {
+		hangover_frames = (int)(hangover * sample_rate);
+	}
+}
+
+double PortAudioVoiceGate::get_hangover() {
+	return hangover;
+}
+
+void PortAudioVoiceGate::set_pre_roll(double p_pre_roll) {
+	// the ring is allocated when the stream opens
+	ERR_FAIL_COND_MSG(prepared, "PortAudioVoiceGate::set_pre_roll: gate is attached to an open stream");
+	pre_roll = MAX(p_pre_roll, 0.0);
+}
+
+double PortAudioVoiceGate::get_pre_roll() {
+	return pre_roll;
+}
+
+bool PortAudioVoiceGate::is_open() {
+	return open.load(std::memory_order_relaxed);
+}
+
+float PortAudioVoiceGate::get_energy_db() {
+	return last_energy_db.load(std::memory_order_relaxed);
+}
+
+float PortAudioVoiceGate::get_flatness() {
+	return last_flatness.load(std::memory_order_relaxed);
+}
+
+int PortAudioVoiceGate::get_pre_roll_capacity() const {
+	return pre_roll_capacity;
+}
+
+bool PortAudioVoiceGate::prepare(int p_channel_count, double p_sample_rate) {
+	if (prepared) {
+		print_line("PortAudioVoiceGate::prepare: gate is already attached to an open stream");
+		return false;
+	}
+	if (p_channel_count <= 0 || p_sample_rate <= 0) {
+		return false;
+	}
+	channel_count = p_channel_count;
+	sample_rate = p_sample_rate;
+	fft.setup(ANALYSIS_SIZE);
+	window.resize(ANALYSIS_SIZE);
+	for (int i = 0; i < ANALYSIS_SIZE; i++) {
+		window[i] = 0.5f - 0.5f * Math::cos(Math_TAU * i / (ANALYSIS_SIZE - 1));
+	}
+	history.assign(ANALYSIS_SIZE, 0.0f);
+	real.assign(ANALYSIS_SIZE, 0.0f);
+	imag.assign(ANALYSIS_SIZE, 0.0f);
+	history_position = 0;
+	// flatness is measured over the speech band only, hum and hiss outside of it would dominate
+	low_bin = MAX(1, (int)(150.0 * ANALYSIS_SIZE / sample_rate));
+	high_bin = MIN(ANALYSIS_SIZE / 2 - 1, (int)(4000.0 * ANALYSIS_SIZE / sample_rate));
+	pre_roll_capacity = (int)(pre_roll * sample_rate);
+	pre_roll_ring.assign((size_t)MAX(pre_roll_capacity, 1) * channel_count, 0.0f);
+	pre_roll_position = 0;
+	pre_roll_fill = 0;
+	hangover_frames = (int)(hangover * sample_rate);
+	hangover_remaining = 0;
+	open.store(false);
+	prepared = true;
+	return true;
+}
+
+void PortAudioVoiceGate::release() {
+	prepared = false;
+	open.store(false);
+	history.clear();
+	pre_roll_ring.clear();
+}
+
+float PortAudioVoiceGate::analyze(const float *p_input, unsigned long p_frames, float &r_energy_db) {
+	// mono mix, plain loops over contiguous data so the compiler can vectorize them
+	const float channel_gain = 1.0f / channel_count;
+	float energy = 0.0f;
+	for (unsigned long frame = 0; frame < p_frames; frame++) {
+		const float *samples = p_input + frame * channel_count;
+		float mono = 0.0f;
+		for (int c = 0; c < channel_count; c++) {
+			mono += samples[c];
+		}
+		mono *= channel_gain;
+		energy += mono * mono;
+		history[history_position] = mono;
+		history_position = (history_position + 1) & (ANALYSIS_SIZE - 1);
+	}
+	r_energy_db = 10.0f * log10f(energy / MAX(p_frames, 1ul) + 1e-12f);
+
+	for (int i = 0; i < ANALYSIS_SIZE; i++) {
+		real[i] = history[(history_position + i) & (ANALYSIS_SIZE - 1)] * window[i];
+	}
+	memset(imag.data(), 0, ANALYSIS_SIZE * sizeof(float));
+	fft.forward(real.data(), imag.data());
+
+	// spectral flatness, geometric over arithmetic mean of the power spectrum. noise is close to 1, voiced speech is low
+	float log_sum = 0.0f;
+	float sum = 0.0f;
+	for (int bin = low_bin; bin <= high_bin; bin++) {
+		float power = real[bin] * real[bin] + imag[bin] * imag[bin] + 1e-12f;
+		log_sum += logf(power);
+		sum += power;
+	}
+	int bin_count = high_bin - low_bin + 1;
+	return expf(log_sum / bin_count) / (sum / bin_count);
+}
+
+void PortAudioVoiceGate::store_pre_roll(const float *p_input, unsigned long p_frames) {
+	if (pre_roll_capacity <= 0) {
+		return;
+	}
+	if ((int)p_frames > pre_roll_capacity) {
+		p_input += (p_frames - pre_roll_capacity) * channel_count;
+		p_frames = pre_roll_capacity;
+	}
+	int first = MIN(pre_roll_capacity - pre_roll_position, (int)p_frames);
+	memcpy(&pre_roll_ring[(size_t)pre_roll_position * channel_count], p_input, (size_t)first * channel_count * sizeof(float));
+	memcpy(pre_roll_ring.data(), p_input + (size_t)first * channel_count, (size_t)(p_frames - first) * channel_count * sizeof(float));
+	pre_roll_position = (pre_roll_position + (int)p_frames) % pre_roll_capacity;
+	pre_roll_fill = MIN(pre_roll_fill + (int)p_frames, pre_roll_capacity);
+}
+
+PortAudioVoiceGate::GateEvent PortAudioVoiceGate::process(const float *p_input, unsigned long p_frames, float *r_pre_roll, int &r_pre_roll_frames) {
+	r_pre_roll_frames = 0;
+	float energy_db;
+	float flatness = analyze(p_input, p_frames, energy_db);
+	last_energy_db.store(energy_db, std::memory_order_relaxed);
+	last_flatness.store(flatness, std::memory_order_relaxed);
+
+	bool voiced = energy_db > threshold_db && flatness < flatness_threshold;
+	bool was_open = open.load(std::memory_order_relaxed);
+	GateEvent event = GATE_CLOSED;
+	if (voiced) {
+		hangover_remaining = hangover_frames;
+		event = was_open ? GATE_OPEN : GATE_ENTER;
+	} else if (was_open) {
+		// hangover keeps pauses between words from chopping the signal
+		hangover_remaining -= (int)p_frames;
+		event = hangover_remaining > 0 ? GATE_OPEN : GATE_EXIT;
+	}
+	open.store(event == GATE_ENTER || event == GATE_OPEN, std::memory_order_relaxed);
+
+	if (event == GATE_ENTER && r_pre_roll && pre_roll_fill > 0) {
+		int start = (pre_roll_position - pre_roll_fill + pre_roll_capacity) % pre_roll_capacity;
+		int first = MIN(pre_roll_capacity - start, pre_roll_fill);
+		memcpy(r_pre_roll, &pre_roll_ring[(size_t)start * channel_count], (size_t)first * channel_count * sizeof(float));
+		memcpy(r_pre_roll + (size_t)first * channel_count, pre_roll_ring.data(), (size_t)(pre_roll_fill - first) * channel_count * sizeof(float));
+		r_pre_roll_frames = pre_roll_fill;
+	}
+	store_pre_roll(p_input, p_frames);
+	return event;
+}
+
+void PortAudioVoiceGate::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_threshold_db"), &PortAudioVoiceGate::get_threshold_db);
+	ClassDB::bind_method(D_METHOD("set_threshold_db", "threshold_db"), &PortAudioVoiceGate::set_threshold_db);
+	ClassDB::bind_method(D_METHOD("get_flatness_threshold"), &PortAudioVoiceGate::get_flatness_threshold);
+	ClassDB::bind_method(D_METHOD("set_flatness_threshold", "flatness_threshold"), &PortAudioVoiceGate::set_flatness_threshold);
+	ClassDB::bind_method(D_METHOD("get_hangover"), &PortAudioVoiceGate::get_hangover);
+	ClassDB::bind_method(D_METHOD("set_hangover", "hangover"), &PortAudioVoiceGate::set_hangover);
+	ClassDB::bind_method(D_METHOD("get_pre_roll"), &PortAudioVoiceGate::get_pre_roll);
+	ClassDB::bind_method(D_METHOD("set_pre_roll", "pre_roll"), &PortAudioVoiceGate::set_pre_roll);
+	ClassDB::bind_method(D_METHOD("is_open"), &PortAudioVoiceGate::is_open);
+	ClassDB::bind_method(D_METHOD("get_energy_db"), &PortAudioVoiceGate::get_energy_db);
+	ClassDB::bind_method(D_METHOD("get_flatness"), &PortAudioVoiceGate::get_flatness);
+
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "threshold_db"), "set_threshold_db", "get_threshold_db");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "flatness_threshold", PROPERTY_HINT_RANGE, "0,1,0.01"), "set_flatness_threshold", "get_flatness_threshold");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "hangover"), "set_hangover", "get_hangover");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "pre_roll"), "set_pre_roll", "get_pre_roll");
+
+	// GateEvent
+	BIND_ENUM_CONSTANT(GATE_CLOSED);
+	BIND_ENUM_CONSTANT(GATE_OPEN);
+	BIND_ENUM_CONSTANT(GATE_ENTER);
+	BIND_ENUM_CONSTANT(GATE_EXIT);
+}
+
+PortAudioVoiceGate::PortAudioVoiceGate() {
+	threshold_db = -45.0f;
+	flatness_threshold = 0.5f;
+	hangover = 0.3;
+	pre_roll = 0.25;
+	prepared = false;
+	channel_count = 0;
+	sample_rate = 0;
+	history_position = 0;
+	low_bin = 1;
+	high_bin = 1;
+	pre_roll_capacity = 0;
+	pre_roll_position = 0;
+	pre_roll_fill = 0;
+	hangover_frames = 0;
+	hangover_remaining = 0;
+	open.store(false);
+	last_energy_db.store(-120.0f);
+	last_flatness.store(1.0f);
+}
+
+PortAudioVoiceGate::~PortAudioVoiceGate() {
+}
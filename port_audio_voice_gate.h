@@ -0,0 +1,86 @@
+#ifndef PORT_AUDIO_VOICE_GATE_H
+#define PORT_AUDIO_VOICE_GATE_H
+
+#include "port_audio_fft.h"
+
+#include "core/io/resource.h"
+
+#include <atomic>
+#include <vector>
+
+// voice activity detection on input streams, the script callback only runs while the gate is open
+class PortAudioVoiceGate : public Resource {
+	GDCLASS(PortAudioVoiceGate, Resource);
+
+public:
+	enum GateEvent {
+		GATE_CLOSED = 0,
+		GATE_OPEN = 1,
+		GATE_ENTER = 2,
+		GATE_EXIT = 3,
+	};
+
+	enum {
+		ANALYSIS_SIZE = 512,
+	};
+
+private:
+	float threshold_db;
+	float flatness_threshold;
+	double hangover;
+	double pre_roll;
+
+	bool prepared;
+	int channel_count;
+	double sample_rate;
+	PortAudioFFT fft;
+	std::vector<float> window;
+	std::vector<float> history;
+	std::vector<float> real;
+	std::vector<float> imag;
+	int history_position;
+	int low_bin;
+	int high_bin;
+	std::vector<float> pre_roll_ring;
+	int pre_roll_capacity;
+	int pre_roll_position;
+	int pre_roll_fill;
+	int hangover_frames;
+	int hangover_remaining;
+	std::atomic<bool> open;
+	std::atomic<float> last_energy_db;
+	std::atomic<float> last_flatness;
+
+	float analyze(const float *p_input, unsigned long p_frames, float &r_energy_db);
+	void store_pre_roll(const float *p_input, unsigned long p_frames);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_threshold_db(float p_threshold_db);
+	float get_threshold_db();
+	void set_flatness_threshold(float p_flatness_threshold);
+	float get_flatness_threshold();
+	void set_hangover(double p_hangover);
+	double get_hangover();
+	void set_pre_roll(double p_pre_roll);
+	double get_pre_roll();
+	bool is_open();
+	float get_energy_db();
+	float get_flatness();
+
+	bool prepare(int p_channel_count, double p_sample_rate);
+	void release();
+	int get_pre_roll_capacity() const;
+	// audio thread, p_input holds interleaved float frames. on GATE_ENTER the frames preceding p_input
+	// are copied to r_pre_roll (oldest first, room for get_pre_roll_capacity() frames)
+	GateEvent process(const float *p_input, unsigned long p_frames, float *r_pre_roll, int &r_pre_roll_frames);
+
+	PortAudioVoiceGate();
+	~PortAudioVoiceGate();
+};
+
+VARIANT_ENUM_CAST(PortAudioVoiceGate::GateEvent);
+
+#endif
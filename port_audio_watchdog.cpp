@@ -0,0 +1,309 @@
+#include "port_audio_watchdog.h"
+
+#include "core/typedefs.h"
+
+#include <portaudio.h>
+
+#include <cstring>
+
+void PortAudioWatchdog::set_degrade_mode(DegradeMode p_degrade_mode) {
+	// the audio thread reads the mode, changing it on an attached watchdog would mix two strategies
+	ERR_FAIL_COND_MSG(prepared, "PortAudioWatchdog::set_degrade_mode: watchdog is attached to an open stream");
+	degrade_mode = p_degrade_mode;
+}
+
+PortAudioWatchdog::DegradeMode PortAudioWatchdog::get_degrade_mode() {
+	return degrade_mode;
+}
+
+void PortAudioWatchdog::set_budget(double p_budget) {
+	budget = MAX(p_budget, 0.01);
+}
+
+double PortAudioWatchdog::get_budget() {
+	return budget;
+}
+
+void PortAudioWatchdog::set_recover_budget(double p_recover_budget) {
+	recover_budget = MAX(p_recover_budget, 0.0);
+}
+
+double PortAudioWatchdog::get_recover_budget() {
+	return recover_budget;
+}
+
+void PortAudioWatchdog::set_trigger_periods(int p_trigger_periods) {
+	trigger_periods = MAX(p_trigger_periods, 1);
+}
+
+int PortAudioWatchdog::get_trigger_periods() {
+	return trigger_periods;
+}
+
+void PortAudioWatchdog::set_recover_periods(int p_recover_periods) {
+	recover_periods = MAX(p_recover_periods, 1);
+}
+
+int PortAudioWatchdog::get_recover_periods() {
+	return recover_periods;
+}
+
+PortAudioWatchdog::WatchdogState PortAudioWatchdog::get_state() {
+	return (WatchdogState)state.load(std::memory_order_relaxed);
+}
+
+Dictionary PortAudioWatchdog::get_stats() {
+	Dictionary stats;
+	stats["state"] = state.load(std::memory_order_relaxed);
+	stats["forced"] = forced.load(std::memory_order_relaxed);
+	stats["load"] = last_load.load(std::memory_order_relaxed);
+	stats["callbacks"] = callback_count.load(std::memory_order_relaxed);
+	stats["overruns"] = overrun_count.load(std::memory_order_relaxed);
+	stats["underflows"] = underflow_count.load(std::memory_order_relaxed);
+	stats["degradations"] = degrade_count.load(std::memory_order_relaxed);
+	stats["degraded_periods"] = degraded_period_count.load(std::memory_order_relaxed);
+	stats["last_call_duration_usec"] = last_call_duration_usec.load(std::memory_order_relaxed);
+	stats["max_call_duration_usec"] = max_call_duration_usec.load(std::memory_order_relaxed);
+	return stats;
+}
+
+bool PortAudioWatchdog::prepare(double p_sample_rate, int p_channel_count, unsigned long p_frames_per_buffer, bool p_can_substitute) {
+	if (prepared) {
+		print_line("PortAudioWatchdog::prepare: watchdog is already attached to an open stream");
+		return false;
+	}
+	if (p_sample_rate <= 0) {
+		return false;
+	}
+	sample_rate = p_sample_rate;
+	channel_count = MAX(p_channel_count, 0);
+	can_substitute = p_can_substitute && channel_count > 0 && degrade_mode != DEGRADE_SKIP_PROCESSORS;
+	if (can_substitute) {
+		// frames per buffer may be unspecified, longer periods repeat the stored frames
+		unsigned long capacity = p_frames_per_buffer > 0 ? p_frames_per_buffer : DEFAULT_SUBSTITUTE_FRAMES;
+		last_good.assign(capacity * channel_count, 0.0f);
+	}
+	last_good_frames = 0;
+	substitute_gain = 0.0f;
+	over_count = 0;
+	good_count = 0;
+	degraded_periods_left = 0;
+	state.store(WATCHDOG_NORMAL);
+	forced.store(false);
+	callback_count.store(0);
+	overrun_count.store(0);
+	underflow_count.store(0);
+	degrade_count.store(0);
+	degraded_period_count.store(0);
+	last_call_duration_usec.store(0);
+	max_call_duration_usec.store(0);
+	last_load.store(0.0f);
+	PaUtil_FlushRingBuffer(&transitions);
+	prepared = true;
+	return true;
+}
+
+void PortAudioWatchdog::release() {
+	prepared = false;
+	last_good.clear();
+	last_good_frames = 0;
+}
+
+bool PortAudioWatchdog::should_skip_script() const {
+	return degrade_mode != DEGRADE_SKIP_PROCESSORS && state.load(std::memory_order_relaxed) == WATCHDOG_DEGRADED;
+}
+
+bool PortAudioWatchdog::should_skip_processors() const {
+	return degrade_mode == DEGRADE_SKIP_PROCESSORS && state.load(std::memory_order_relaxed) == WATCHDOG_DEGRADED;
+}
+
+void PortAudioWatchdog::store_last_good(const float *p_output, unsigned long p_frames) {
+	if (!can_substitute) {
+		return;
+	}
+	unsigned long capacity = last_good.size() / channel_count;
+	p_frames = MIN(p_frames, capacity);
+	memcpy(last_good.data(), p_output, p_frames * channel_count * sizeof(float));
+	last_good_frames = p_frames;
+}
+
+bool PortAudioWatchdog::render_substitute(float *r_output, unsigned long p_frames) {
+	if (!can_substitute || last_good_frames == 0 || substitute_gain <= 0.0f || p_frames == 0) {
+		return false;
+	}
+	// ramp within the period, a gain step would click. repeats decay so a stuck script does not loop forever
+	float start_gain = substitute_gain;
+	float end_gain = degrade_mode == DEGRADE_REPEAT_LAST_BUFFER ? start_gain * 0.5f : 0.0f;
+	if (end_gain < 0.001f) {
+		end_gain = 0.0f;
+	}
+	float gain_step = (end_gain - start_gain) / p_frames;
+	for (unsigned long frame = 0; frame < p_frames; frame++) {
+		const float *source = &last_good[(frame % last_good_frames) * channel_count];
+		float *destination = r_output + frame * channel_count;
+		float gain = start_gain + gain_step * frame;
+		for (int c = 0; c < channel_count; c++) {
+			destination[c] = source[c] * gain;
+		}
+	}
+	substitute_gain = end_gain;
+	return true;
+}
+
+void PortAudioWatchdog::set_state(WatchdogState p_state, float p_load) {
+	WatchdogState previous = (WatchdogState)state.load(std::memory_order_relaxed);
+	state.store(p_state, std::memory_order_relaxed);
+	// only the user visible changes are reported, recovering is still degraded from the outside
+	bool report = (previous == WATCHDOG_NORMAL && p_state == WATCHDOG_DEGRADED) || p_state == WATCHDOG_NORMAL;
+	if (report) {
+		Transition transition = { (int32_t)p_state, p_load };
+		PaUtil_WriteRingBuffer(&transitions, &transition, 1);
+	}
+}
+
+void PortAudioWatchdog::update(uint64_t p_call_duration_usec, unsigned long p_frames, unsigned long p_status_flags) {
+	if (!prepared) {
+		return;
+	}
+	callback_count.fetch_add(1, std::memory_order_relaxed);
+	last_call_duration_usec.store(p_call_duration_usec, std::memory_order_relaxed);
+	if (p_call_duration_usec > max_call_duration_usec.load(std::memory_order_relaxed)) {
+		max_call_duration_usec.store(p_call_duration_usec, std::memory_order_relaxed);
+	}
+	double period_usec = p_frames * 1000000.0 / sample_rate;
+	float load = period_usec > 0 ? (float)(p_call_duration_usec / period_usec) : 0.0f;
+	last_load.store(load, std::memory_order_relaxed);
+
+	// an underflow means an earlier period was late, it counts like an overrun
+	bool underflow = (p_status_flags & paOutputUnderflow) != 0;
+	if (underflow) {
+		underflow_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	bool over = load > budget;
+	if (over) {
+		overrun_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	over = over || underflow;
+	// hysteresis, leaving the degraded mode needs a clearly lower load than entering it
+	bool good = load < MIN(recover_budget, budget) && !underflow;
+	bool is_forced = forced.load(std::memory_order_relaxed);
+
+	switch (state.load(std::memory_order_relaxed)) {
+		case WATCHDOG_NORMAL: {
+			over_count = over ? over_count + 1 : 0;
+			if (over_count >= trigger_periods || is_forced) {
+				over_count = 0;
+				good_count = 0;
+				degraded_periods_left = recover_periods;
+				substitute_gain = 1.0f;
+				degrade_count.fetch_add(1, std::memory_order_relaxed);
+				set_state(WATCHDOG_DEGRADED, load);
+			}
+		} break;
+		case WATCHDOG_DEGRADED: {
+			degraded_period_count.fetch_add(1, std::memory_order_relaxed);
+			if (is_forced) {
+				break;
+			}
+			if (degrade_mode == DEGRADE_SKIP_PROCESSORS) {
+				// the script still runs, its timing tells when the processors can come back
+				good_count = good ? good_count + 1 : 0;
+				if (good_count >= recover_periods) {
+					set_state(WATCHDOG_NORMAL, load);
+				}
+			} else if (--degraded_periods_left <= 0) {
+				// the script is skipped, nothing to measure, give it a chance again
+				good_count = 0;
+				set_state(WATCHDOG_RECOVERING, load);
+			}
+		} break;
+		case WATCHDOG_RECOVERING: {
+			if (over || is_forced) {
+				degraded_periods_left = recover_periods;
+				substitute_gain = 1.0f;
+				set_state(WATCHDOG_DEGRADED, load);
+				break;
+			}
+			if (good) {
+				good_count++;
+			}
+			if (good_count >= recover_periods) {
+				set_state(WATCHDOG_NORMAL, load);
+			}
+		} break;
+	}
+}
+
+bool PortAudioWatchdog::pop_transition(Transition &r_transition) {
+	return PaUtil_ReadRingBuffer(&transitions, &r_transition, 1) == 1;
+}
+
+void PortAudioWatchdog::set_forced(bool p_forced) {
+	forced.store(p_forced, std::memory_order_relaxed);
+}
+
+bool PortAudioWatchdog::is_forced() const {
+	return forced.load(std::memory_order_relaxed);
+}
+
+void PortAudioWatchdog::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("get_degrade_mode"), &PortAudioWatchdog::get_degrade_mode);
+	ClassDB::bind_method(D_METHOD("set_degrade_mode", "degrade_mode"), &PortAudioWatchdog::set_degrade_mode);
+	ClassDB::bind_method(D_METHOD("get_budget"), &PortAudioWatchdog::get_budget);
+	ClassDB::bind_method(D_METHOD("set_budget", "budget"), &PortAudioWatchdog::set_budget);
+	ClassDB::bind_method(D_METHOD("get_recover_budget"), &PortAudioWatchdog::get_recover_budget);
+	ClassDB::bind_method(D_METHOD("set_recover_budget", "recover_budget"), &PortAudioWatchdog::set_recover_budget);
+	ClassDB::bind_method(D_METHOD("get_trigger_periods"), &PortAudioWatchdog::get_trigger_periods);
+	ClassDB::bind_method(D_METHOD("set_trigger_periods", "trigger_periods"), &PortAudioWatchdog::set_trigger_periods);
+	ClassDB::bind_method(D_METHOD("get_recover_periods"), &PortAudioWatchdog::get_recover_periods);
+	ClassDB::bind_method(D_METHOD("set_recover_periods", "recover_periods"), &PortAudioWatchdog::set_recover_periods);
+	ClassDB::bind_method(D_METHOD("get_state"), &PortAudioWatchdog::get_state);
+	ClassDB::bind_method(D_METHOD("get_stats"), &PortAudioWatchdog::get_stats);
+
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "degrade_mode", PROPERTY_HINT_ENUM, "FadeToSilence,SkipProcessors,RepeatLastBuffer"), "set_degrade_mode", "get_degrade_mode");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "budget", PROPERTY_HINT_RANGE, "0.01,2,0.01"), "set_budget", "get_budget");
+	ADD_PROPERTY(PropertyInfo(Variant::FLOAT, "recover_budget", PROPERTY_HINT_RANGE, "0,2,0.01"), "set_recover_budget", "get_recover_budget");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "trigger_periods", PROPERTY_HINT_RANGE, "1,64,1"), "set_trigger_periods", "get_trigger_periods");
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "recover_periods", PROPERTY_HINT_RANGE, "1,1024,1"), "set_recover_periods", "get_recover_periods");
+
+	// DegradeMode
+	BIND_ENUM_CONSTANT(DEGRADE_FADE_TO_SILENCE);
+	BIND_ENUM_CONSTANT(DEGRADE_SKIP_PROCESSORS);
+	BIND_ENUM_CONSTANT(DEGRADE_REPEAT_LAST_BUFFER);
+
+	// WatchdogState
+	BIND_ENUM_CONSTANT(WATCHDOG_NORMAL);
+	BIND_ENUM_CONSTANT(WATCHDOG_DEGRADED);
+	BIND_ENUM_CONSTANT(WATCHDOG_RECOVERING);
+}
+
+PortAudioWatchdog::PortAudioWatchdog() {
+	degrade_mode = DEGRADE_FADE_TO_SILENCE;
+	budget = 0.8;
+	recover_budget = 0.5;
+	trigger_periods = 2;
+	recover_periods = 64;
+	prepared = false;
+	sample_rate = 0;
+	channel_count = 0;
+	can_substitute = false;
+	last_good_frames = 0;
+	substitute_gain = 0.0f;
+	over_count = 0;
+	good_count = 0;
+	degraded_periods_left = 0;
+	state.store(WATCHDOG_NORMAL);
+	forced.store(false);
+	callback_count.store(0);
+	overrun_count.store(0);
+	underflow_count.store(0);
+	degrade_count.store(0);
+	degraded_period_count.store(0);
+	last_call_duration_usec.store(0);
+	max_call_duration_usec.store(0);
+	last_load.store(0.0f);
+	PaUtil_InitializeRingBuffer(&transitions, sizeof(Transition), TRANSITION_QUEUE_SIZE, transition_data);
+}
+
+PortAudioWatchdog::~PortAudioWatchdog() {
+}
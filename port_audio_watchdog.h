@@ -0,0 +1,115 @@
+#ifndef PORT_AUDIO_WATCHDOG_H
+#define PORT_AUDIO_WATCHDOG_H
+
+#include "core/io/resource.h"
+#include "core/variant/dictionary.h"
+
+#include <pa_ringbuffer.h>
+
+#include <atomic>
+#include <vector>
+
+// overload protection for one stream, fed with the duration of every callback
+class PortAudioWatchdog : public Resource {
+	GDCLASS(PortAudioWatchdog, Resource);
+
+public:
+	enum DegradeMode {
+		DEGRADE_FADE_TO_SILENCE = 0,
+		DEGRADE_SKIP_PROCESSORS = 1,
+		DEGRADE_REPEAT_LAST_BUFFER = 2,
+	};
+
+	enum WatchdogState {
+		WATCHDOG_NORMAL = 0,
+		WATCHDOG_DEGRADED = 1,
+		WATCHDOG_RECOVERING = 2,
+	};
+
+	enum {
+		TRANSITION_QUEUE_SIZE = 64,
+		DEFAULT_SUBSTITUTE_FRAMES = 4096,
+	};
+
+	struct Transition {
+		int32_t state;
+		float load;
+	};
+
+private:
+	DegradeMode degrade_mode;
+	double budget;
+	double recover_budget;
+	int trigger_periods;
+	int recover_periods;
+
+	bool prepared;
+	double sample_rate;
+	int channel_count;
+	bool can_substitute;
+	std::vector<float> last_good;
+	unsigned long last_good_frames;
+	float substitute_gain;
+	int over_count;
+	int good_count;
+	int degraded_periods_left;
+
+	std::atomic<int> state;
+	std::atomic<bool> forced;
+	std::atomic<uint64_t> callback_count;
+	std::atomic<uint64_t> overrun_count;
+	std::atomic<uint64_t> underflow_count;
+	std::atomic<uint64_t> degrade_count;
+	std::atomic<uint64_t> degraded_period_count;
+	std::atomic<uint64_t> last_call_duration_usec;
+	std::atomic<uint64_t> max_call_duration_usec;
+	std::atomic<float> last_load;
+
+	// written by the audio thread, drained by the monitor thread
+	PaUtilRingBuffer transitions;
+	Transition transition_data[TRANSITION_QUEUE_SIZE];
+
+	void set_state(WatchdogState p_state, float p_load);
+
+protected:
+	static void _bind_methods();
+
+public:
+	void set_degrade_mode(DegradeMode p_degrade_mode);
+	DegradeMode get_degrade_mode();
+	void set_budget(double p_budget);
+	double get_budget();
+	void set_recover_budget(double p_recover_budget);
+	double get_recover_budget();
+	void set_trigger_periods(int p_trigger_periods);
+	int get_trigger_periods();
+	void set_recover_periods(int p_recover_periods);
+	int get_recover_periods();
+	WatchdogState get_state();
+	Dictionary get_stats();
+
+	// p_can_substitute: the device buffer is interleaved float, fade and repeat need it
+	bool prepare(double p_sample_rate, int p_channel_count, unsigned long p_frames_per_buffer, bool p_can_substitute);
+	void release();
+
+	// audio thread
+	bool should_skip_script() const;
+	bool should_skip_processors() const;
+	void store_last_good(const float *p_output, unsigned long p_frames);
+	// false when the caller has to write silence
+	bool render_substitute(float *r_output, unsigned long p_frames);
+	void update(uint64_t p_call_duration_usec, unsigned long p_frames, unsigned long p_status_flags);
+
+	// monitor thread
+	bool pop_transition(Transition &r_transition);
+	void set_forced(bool p_forced);
+	bool is_forced() const;
+
+	PortAudioWatchdog();
+	~PortAudioWatchdog();
+};
+
+VARIANT_ENUM_CAST(PortAudioWatchdog::DegradeMode);
+VARIANT_ENUM_CAST(PortAudioWatchdog::WatchdogState);
+
+#endif
@@ -0,0 +1,193 @@
+#include "port_audio_worker_pool.h"
+
+#include "core/os/memory.h"
+#include "core/os/os.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#include <immintrin.h>
+#define PORT_AUDIO_CPU_RELAX() _mm_pause()
+#else
+#include <thread>
+#define PORT_AUDIO_CPU_RELAX() std::this_thread::yield()
+#endif
+
+static void pin_current_thread(int p_core) {
+#if defined(__linux__)
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(p_core, &cpu_set);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#elif defined(_WIN32)
+	SetThreadAffinityMask(GetCurrentThread(), ((DWORD_PTR)1) << p_core);
+#else
+	// no hard affinity available, rely on the scheduler
+	(void)p_core;
+#endif
+}
+
+int PortAudioWorkerPool::get_worker_count() const {
+	return worker_count;
+}
+
+uint64_t PortAudioWorkerPool::get_deadline_miss_count() const {
+	return deadline_miss_count.load(std::memory_order_relaxed);
+}
+
+void PortAudioWorkerPool::run_tasks(uint32_t p_generation) {
+	uint64_t claim = job.load(std::memory_order_acquire);
+	while (true) {
+		uint32_t task_count = (uint32_t)(claim >> 16) & MAX_TASKS;
+		uint32_t index = (uint32_t)claim & MAX_TASKS;
+		if ((uint32_t)(claim >> 32) != p_generation || index >= task_count) {
+			return;
+		}
+		if (job.compare_exchange_weak(claim, claim + 1, std::memory_order_acquire, std::memory_order_acquire)) {
+			task(task_user_data, (int)index);
+			completed.fetch_add(1, std::memory_order_release);
+			claim = job.load(std::memory_order_acquire);
+		}
+	}
+}
+
+void PortAudioWorkerPool::worker_main(void *p_worker) {
+	Worker *worker = (Worker *)p_worker;
+	PortAudioWorkerPool *pool = worker->pool;
+	if (pool->pin_threads) {
+		int processor_count = OS::get_singleton()->get_processor_count();
+		// workers are spread over the cores after core 0, the audio callback thread itself is not pinned
+		pin_current_thread(processor_count > 1 ? 1 + worker->index % (processor_count - 1) : 0);
+	}
+
+	uint32_t seen_generation = (uint32_t)(pool->job.load(std::memory_order_acquire) >> 32);
+	uint64_t idle_since = OS::get_singleton()->get_ticks_usec();
+	while (!pool->exit.load(std::memory_order_acquire)) {
+		uint32_t current_generation = (uint32_t)(pool->job.load(std::memory_order_acquire) >> 32);
+		if (current_generation != seen_generation) {
+			seen_generation = current_generation;
+			pool->run_tasks(current_generation);
+			idle_since = OS::get_singleton()->get_ticks_usec();
+			continue;
+		}
+
+		// spin for a while after each period, then sleep until the next job is published
+		if (OS::get_singleton()->get_ticks_usec() - idle_since < pool->spin_usec) {
+			PORT_AUDIO_CPU_RELAX();
+			continue;
+		}
+		pool->sleeping.fetch_add(1, std::memory_order_seq_cst);
+		if ((uint32_t)(pool->job.load(std::memory_order_seq_cst) >> 32) == seen_generation && !pool->exit.load(std::memory_order_acquire)) {
+			pool->wake.wait();
+		}
+		pool->sleeping.fetch_sub(1, std::memory_order_seq_cst);
+		idle_since = OS::get_singleton()->get_ticks_usec();
+	}
+}
+
+void PortAudioWorkerPool::start(int p_worker_count, bool p_pin_threads) {
+	stop();
+	if (p_worker_count <= 0) {
+		return;
+	}
+	exit.store(false);
+	pin_threads = p_pin_threads;
+	worker_count = p_worker_count;
+	workers = memnew_arr(Worker, worker_count);
+	Thread::Settings settings;
+	settings.priority = Thread::PRIORITY_HIGH;
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].pool = this;
+		workers[i].index = i;
+		workers[i].thread.start(&PortAudioWorkerPool::worker_main, &workers[i], settings);
+	}
+}
+
+void PortAudioWorkerPool::stop() {
+	if (!workers) {
+		return;
+	}
+	exit.store(true, std::memory_order_release);
+	for (int i = 0; i < worker_count; i++) {
+		wake.post();
+	}
+	for (int i = 0; i < worker_count; i++) {
+		workers[i].thread.wait_to_finish();
+	}
+	memdelete_arr(workers);
+	workers = nullptr;
+	worker_count = 0;
+}
+
+void PortAudioWorkerPool::execute(Task p_task, void *p_user_data, int p_task_count, uint64_t p_budget_usec) {
+	bool parallel = worker_count > 0 && p_task_count > 1 && p_task_count <= MAX_TASKS;
+	// another stream's callback owns the workers, waiting for it could cost a whole period
+	if (parallel && busy.exchange(true, std::memory_order_acquire)) {
+		parallel = false;
+	} else if (parallel && serial_periods > 0) {
+		serial_periods--;
+		busy.store(false, std::memory_order_release);
+		parallel = false;
+	}
+	if (!parallel) {
+		for (int i = 0; i < p_task_count; i++) {
+			p_task(p_user_data, i);
+		}
+		return;
+	}
+
+	uint64_t deadline = OS::get_singleton()->get_ticks_usec() + p_budget_usec;
+	task = p_task;
+	task_user_data = p_user_data;
+	completed.store(0, std::memory_order_relaxed);
+	generation++;
+	// publishes task and task_user_data to every worker that claims from this generation
+	job.store(((uint64_t)generation << 32) | ((uint64_t)p_task_count << 16), std::memory_order_seq_cst);
+	int sleeping_workers = sleeping.load(std::memory_order_seq_cst);
+	for (int i = 0; i < sleeping_workers; i++) {
+		wake.post();
+	}
+
+	// the calling thread takes part, so unclaimed tasks never wait on a slow worker
+	run_tasks(generation);
+	bool deadline_missed = false;
+	// every task is claimed at this point, once they have completed no worker touches p_user_data again
+	while (completed.load(std::memory_order_acquire) < p_task_count) {
+		if (!deadline_missed && OS::get_singleton()->get_ticks_usec() > deadline) {
+			deadline_missed = true;
+		}
+		PORT_AUDIO_CPU_RELAX();
+	}
+	if (deadline_missed) {
+		// the pool did not pay off, run serially for a while before trying again
+		deadline_miss_count.fetch_add(1, std::memory_order_relaxed);
+		serial_periods = 64;
+	}
+	busy.store(false, std::memory_order_release);
+}
+
+PortAudioWorkerPool::PortAudioWorkerPool() {
+	workers = nullptr;
+	worker_count = 0;
+	pin_threads = false;
+	spin_usec = 2000;
+	exit.store(false);
+	job.store(0);
+	completed.store(0);
+	sleeping.store(0);
+	busy.store(false);
+	task = nullptr;
+	task_user_data = nullptr;
+	generation = 0;
+	serial_periods = 0;
+	deadline_miss_count.store(0);
+}
+
+PortAudioWorkerPool::~PortAudioWorkerPool() {
+	stop();
+}
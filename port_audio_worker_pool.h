@@ -0,0 +1,62 @@
+#ifndef PORT_AUDIO_WORKER_POOL_H
+#define PORT_AUDIO_WORKER_POOL_H
+
+#include "core/os/semaphore.h"
+#include "core/os/thread.h"
+
+#include <atomic>
+
+class PortAudioWorkerPool {
+public:
+	typedef void (*Task)(void *p_user_data, int p_index);
+
+private:
+	struct Worker {
+		Thread thread;
+		PortAudioWorkerPool *pool;
+		int index;
+	};
+
+	Worker *workers;
+	int worker_count;
+	bool pin_threads;
+	uint64_t spin_usec;
+
+	enum {
+		MAX_TASKS = 0xFFFF,
+	};
+
+	std::atomic<bool> exit;
+	// generation << 32 | task count << 16 | next index. a task is claimed with a cas on the whole word, so a worker
+	// that is late for a job can never claim a task of the next one
+	std::atomic<uint64_t> job;
+	std::atomic<int> completed;
+	std::atomic<int> sleeping;
+	Semaphore wake;
+	// streams share the pool, the caller that takes this owns the workers until its job completed
+	std::atomic<bool> busy;
+
+	// written by the owning caller before the job is published, stable until every claimed task has completed
+	Task task;
+	void *task_user_data;
+	uint32_t generation;
+	int serial_periods;
+	std::atomic<uint64_t> deadline_miss_count;
+
+	static void worker_main(void *p_worker);
+	void run_tasks(uint32_t p_generation);
+
+public:
+	int get_worker_count() const;
+	uint64_t get_deadline_miss_count() const;
+
+	void start(int p_worker_count, bool p_pin_threads);
+	void stop();
+	// reentrant, a caller that finds the workers busy with another job runs its tasks serially
+	void execute(Task p_task, void *p_user_data, int p_task_count, uint64_t p_budget_usec);
+
+	PortAudioWorkerPool();
+	~PortAudioWorkerPool();
+};
+
+#endif
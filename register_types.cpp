@@ -1,9 +1,20 @@
 #include "register_types.h"
 
 #include "./port_audio.h"
+#include "./port_audio_aggregate_stream.h"
+#include "./port_audio_broadcast.h"
 #include "./port_audio_callback_data.h"
+#include "./port_audio_channel_routing.h"
+#include "./port_audio_convolver.h"
+#include "./port_audio_graph.h"
+#include "./port_audio_input_conditioning.h"
+#include "./port_audio_limiter.h"
+#include "./port_audio_jitter_buffer.h"
+#include "./port_audio_render_ahead.h"
 #include "./port_audio_stream.h"
 #include "./port_audio_stream_parameter.h"
+#include "./port_audio_voice_gate.h"
+#include "./port_audio_watchdog.h"
 
 #include "./port_audio_test_node.h"
 
@@ -22,6 +33,18 @@ void register_portaudio_types() {
 	ClassDB::register_class<PortAudioStream>();
 	ClassDB::register_class<PortAudioStreamParameter>();
 	ClassDB::register_class<PortAudioCallbackData>();
+	ClassDB::register_class<PortAudioRenderAhead>();
+	ClassDB::register_class<PortAudioGraph>();
+	ClassDB::register_class<PortAudioConvolver>();
+	ClassDB::register_class<PortAudioChannelRouting>();
+	ClassDB::register_class<PortAudioVoiceGate>();
+	ClassDB::register_class<PortAudioWatchdog>();
+	ClassDB::register_class<PortAudioAggregateStream>();
+	ClassDB::register_class<PortAudioJitterBuffer>();
+	ClassDB::register_class<PortAudioBroadcast>();
+	ClassDB::register_class<PortAudioBroadcastReader>();
+	ClassDB::register_class<PortAudioInputConditioning>();
+	ClassDB::register_class<PortAudioLimiter>();
 
 	// Nodes
 	ClassDB::register_class<PortAudioTestNode>();
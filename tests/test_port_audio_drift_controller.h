@@ -0,0 +1,75 @@
+#ifndef TEST_PORT_AUDIO_DRIFT_CONTROLLER_H
+#define TEST_PORT_AUDIO_DRIFT_CONTROLLER_H
+
+#include "../port_audio_resampler.h"
+
+#include "core/math/math_funcs.h"
+#include "tests/test_macros.h"
+
+namespace TestPortAudioDriftController {
+
+struct Result {
+	double mean_ppm = 0;
+	double max_deviation_ppm = 0;
+	double min_fill = 0;
+};
+
+// a producer on its own clock writes whole blocks, the consumer takes one period times the ratio per update
+static Result run(int p_period, int p_block, double p_target_fill, double p_offset_ppm, int p_periods, int p_tail) {
+	PortAudioDriftController drift;
+	drift.setup(p_target_fill, 1000);
+	double offset = p_offset_ppm / 1000000.0;
+	double fill = p_target_fill;
+	double phase = 0;
+	Result result;
+	result.min_fill = fill;
+	for (int i = 0; i < p_periods; i++) {
+		phase += p_period * (1.0 + offset);
+		while (phase >= p_block) {
+			fill += p_block;
+			phase -= p_block;
+		}
+		double ratio = drift.update(fill, p_period);
+		fill -= p_period * ratio;
+		result.min_fill = MIN(result.min_fill, fill);
+		if (i >= p_periods - p_tail) {
+			double ppm = drift.get_drift_ppm();
+			result.mean_ppm += ppm / p_tail;
+			result.max_deviation_ppm = MAX(result.max_deviation_ppm, Math::abs(ppm - p_offset_ppm));
+		}
+	}
+	return result;
+}
+
+TEST_CASE("[PortAudio][DriftController] Converges to a fixed offset") {
+	const double offsets[] = { 100, -100, 250 };
+	for (double offset : offsets) {
+		// periods of different length, the fill level jumps at irregular intervals
+		Result result = run(441, 256, 1764, offset, 200000, 50000);
+		CHECK_MESSAGE(Math::abs(result.mean_ppm - offset) < 1.0, vformat("offset %f mean %f", offset, result.mean_ppm));
+		CHECK_MESSAGE(result.max_deviation_ppm < 5.0, vformat("offset %f deviation %f", offset, result.max_deviation_ppm));
+		CHECK(result.min_fill > 0);
+	}
+}
+
+TEST_CASE("[PortAudio][DriftController] No limit cycle with equal periods") {
+	const double offsets[] = { 100, -100 };
+	for (double offset : offsets) {
+		// the fill level steps by a whole block once per beat of the two clocks, the ratio must not chase every step
+		Result result = run(256, 256, 1024, offset, 200000, 50000);
+		CHECK_MESSAGE(Math::abs(result.mean_ppm - offset) < 1.0, vformat("offset %f mean %f", offset, result.mean_ppm));
+		CHECK_MESSAGE(result.max_deviation_ppm < 200.0, vformat("offset %f deviation %f", offset, result.max_deviation_ppm));
+		CHECK(result.min_fill > 0);
+	}
+}
+
+TEST_CASE("[PortAudio][DriftController] Deep buffer converges like a shallow one") {
+	// a jitter buffer holds many periods, the loop gain must not shrink with its depth
+	Result result = run(256, 480, 2880, 100, 200000, 50000);
+	CHECK_MESSAGE(Math::abs(result.mean_ppm - 100) < 1.0, vformat("mean %f", result.mean_ppm));
+	CHECK_MESSAGE(result.max_deviation_ppm < 20.0, vformat("deviation %f", result.max_deviation_ppm));
+}
+
+} // namespace TestPortAudioDriftController
+
+#endif
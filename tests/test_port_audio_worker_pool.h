@@ -0,0 +1,92 @@
+#ifndef TEST_PORT_AUDIO_WORKER_POOL_H
+#define TEST_PORT_AUDIO_WORKER_POOL_H
+
+#include "../port_audio_worker_pool.h"
+
+#include "core/os/thread.h"
+#include "tests/test_macros.h"
+
+#include <atomic>
+
+namespace TestPortAudioWorkerPool {
+
+enum {
+	TASK_COUNT = 8,
+	ITERATIONS = 2000,
+};
+
+struct Caller {
+	PortAudioWorkerPool *pool = nullptr;
+	std::atomic<int> runs[TASK_COUNT];
+	std::atomic<int> foreign_runs;
+	std::atomic<bool> *start = nullptr;
+
+	Caller() {
+		for (int i = 0; i < TASK_COUNT; i++) {
+			runs[i].store(0);
+		}
+		foreign_runs.store(0);
+	}
+};
+
+// each caller passes itself as user data, a task run for the wrong caller shows up in both counts
+static void count_task(void *p_user_data, int p_index) {
+	Caller *caller = (Caller *)p_user_data;
+	if (p_index < 0 || p_index >= TASK_COUNT) {
+		caller->foreign_runs.fetch_add(1);
+		return;
+	}
+	caller->runs[p_index].fetch_add(1);
+}
+
+static void caller_main(void *p_caller) {
+	Caller *caller = (Caller *)p_caller;
+	while (!caller->start->load()) {
+	}
+	for (int i = 0; i < ITERATIONS; i++) {
+		caller->pool->execute(&count_task, caller, TASK_COUNT, 1000000);
+	}
+}
+
+TEST_CASE("[PortAudio][WorkerPool] Runs every task once per job") {
+	PortAudioWorkerPool pool;
+	pool.start(2, false);
+	Caller caller;
+	for (int i = 0; i < 100; i++) {
+		pool.execute(&count_task, &caller, TASK_COUNT, 1000000);
+	}
+	pool.stop();
+	for (int i = 0; i < TASK_COUNT; i++) {
+		CHECK(caller.runs[i].load() == 100);
+	}
+}
+
+TEST_CASE("[PortAudio][WorkerPool] Two callers at once") {
+	// two streams whose callbacks run the pool at the same time, neither may lose or steal a task
+	PortAudioWorkerPool pool;
+	pool.start(3, false);
+	std::atomic<bool> start;
+	start.store(false);
+	Caller callers[2];
+	Thread threads[2];
+	for (int c = 0; c < 2; c++) {
+		callers[c].pool = &pool;
+		callers[c].start = &start;
+		threads[c].start(&caller_main, &callers[c]);
+	}
+	start.store(true);
+	for (int c = 0; c < 2; c++) {
+		threads[c].wait_to_finish();
+	}
+	pool.stop();
+	for (int c = 0; c < 2; c++) {
+		CHECK(callers[c].foreign_runs.load() == 0);
+		for (int i = 0; i < TASK_COUNT; i++) {
+			CHECK_MESSAGE(callers[c].runs[i].load() == ITERATIONS, vformat("caller %d task %d", c, i));
+		}
+	}
+}
+
+} // namespace TestPortAudioWorkerPool
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Shared memory layout of a stream published with PortAudio.publish_stream().
+ * Shared between the Godot module (writer) and port_audio_shm_reader (readers), Linux only.
+ */
+#ifndef PORT_AUDIO_SHM_H
+#define PORT_AUDIO_SHM_H
+
+#include <stdint.h>
+
+#define PORT_AUDIO_SHM_MAGIC 0x50414d53u /* "PAMS" */
+#define PORT_AUDIO_SHM_VERSION 1u
+
+typedef struct PortAudioShmHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t channel_count;
+	uint32_t capacity_frames; /* power of two */
+	double sample_rate;
+	/* frames written since the endpoint was created, stored after the samples */
+	uint64_t write_position;
+	/* write_position plus the frames currently being written, stored before the samples */
+	uint64_t reserve_position;
+	/* incremented after every write, readers futex wait on it */
+	uint32_t futex;
+	/* number of readers blocked in futex wait, the writer only wakes when non zero */
+	uint32_t waiters;
+	/* set once the writer is gone */
+	uint32_t closed;
+	uint32_t reserved[3];
+} PortAudioShmHeader;
+
+/* the header is followed by capacity_frames * channel_count interleaved 32 bit float samples */
+#define PORT_AUDIO_SHM_SAMPLES(header) ((float *)((uint8_t *)(header) + sizeof(PortAudioShmHeader)))
+
+#define PORT_AUDIO_SHM_SIZE(channel_count, capacity_frames) \
+	(sizeof(PortAudioShmHeader) + (uint64_t)(channel_count) * (capacity_frames) * sizeof(float))
+
+#endif
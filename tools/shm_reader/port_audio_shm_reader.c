@@ -0,0 +1,123 @@
+#define _GNU_SOURCE
+
+#include "port_audio_shm_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+int port_audio_shm_reader_open(PortAudioShmReader *reader, const char *name) {
+	struct stat info;
+	memset(reader, 0, sizeof(PortAudioShmReader));
+	reader->fd = shm_open(name, O_RDWR, 0);
+	if (reader->fd < 0) {
+		return -1;
+	}
+	if (fstat(reader->fd, &info) != 0 || (size_t)info.st_size < sizeof(PortAudioShmHeader)) {
+		close(reader->fd);
+		return -1;
+	}
+	/* mapped writable because waiters is updated by the readers */
+	reader->mapped_size = (size_t)info.st_size;
+	reader->header = (PortAudioShmHeader *)mmap(NULL, reader->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, reader->fd, 0);
+	if (reader->header == MAP_FAILED) {
+		close(reader->fd);
+		return -1;
+	}
+	if (reader->header->magic != PORT_AUDIO_SHM_MAGIC || reader->header->version != PORT_AUDIO_SHM_VERSION ||
+			reader->mapped_size < PORT_AUDIO_SHM_SIZE(reader->header->channel_count, reader->header->capacity_frames)) {
+		port_audio_shm_reader_close(reader);
+		errno = EPROTO;
+		return -1;
+	}
+	reader->samples = PORT_AUDIO_SHM_SAMPLES(reader->header);
+	reader->read_position = __atomic_load_n(&reader->header->write_position, __ATOMIC_ACQUIRE);
+	return 0;
+}
+
+void port_audio_shm_reader_close(PortAudioShmReader *reader) {
+	if (reader->header && reader->header != MAP_FAILED) {
+		munmap(reader->header, reader->mapped_size);
+	}
+	if (reader->fd >= 0) {
+		close(reader->fd);
+	}
+	reader->header = NULL;
+	reader->fd = -1;
+}
+
+static void wait_for_write(PortAudioShmHeader *header, uint32_t futex_value, int timeout_ms) {
+	struct timespec timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+	__atomic_add_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+	syscall(SYS_futex, &header->futex, FUTEX_WAIT, futex_value, timeout_ms < 0 ? NULL : &timeout, NULL, 0);
+	__atomic_sub_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+long port_audio_shm_reader_read(PortAudioShmReader *reader, float *destination, unsigned long max_frames, int timeout_ms) {
+	PortAudioShmHeader *header = reader->header;
+	const uint64_t capacity = header->capacity_frames;
+	const uint32_t channel_count = header->channel_count;
+	uint64_t write_position;
+	uint64_t frames;
+	uint64_t offset;
+	uint64_t first;
+
+	for (;;) {
+		uint32_t futex_value = __atomic_load_n(&header->futex, __ATOMIC_ACQUIRE);
+		write_position = __atomic_load_n(&header->write_position, __ATOMIC_ACQUIRE);
+		if (write_position != reader->read_position) {
+			break;
+		}
+		if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+			return -1;
+		}
+		if (timeout_ms == 0) {
+			return 0;
+		}
+		wait_for_write(header, futex_value, timeout_ms);
+		if (timeout_ms > 0 && __atomic_load_n(&header->write_position, __ATOMIC_ACQUIRE) == reader->read_position) {
+			return 0;
+		}
+	}
+
+	if (write_position - reader->read_position > capacity) {
+		/* the writer lapped this reader, continue with the oldest frames still intact */
+		reader->overrun_frames += write_position - reader->read_position - capacity;
+		reader->read_position = write_position - capacity;
+	}
+	frames = write_position - reader->read_position;
+	if (frames > max_frames) {
+		frames = max_frames;
+	}
+	offset = reader->read_position & (capacity - 1);
+	first = capacity - offset < frames ? capacity - offset : frames;
+	memcpy(destination, reader->samples + offset * channel_count, first * channel_count * sizeof(float));
+	memcpy(destination + first * channel_count, reader->samples, (frames - first) * channel_count * sizeof(float));
+
+	/* frames the writer overwrote or is overwriting while they were copied are torn, drop them */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	write_position = __atomic_load_n(&header->reserve_position, __ATOMIC_ACQUIRE);
+	if (write_position - reader->read_position > capacity) {
+		uint64_t lost = write_position - reader->read_position - capacity;
+		if (lost >= frames) {
+			reader->overrun_frames += frames;
+			reader->read_position += frames;
+			return 0;
+		}
+		memmove(destination, destination + lost * channel_count, (frames - lost) * channel_count * sizeof(float));
+		reader->overrun_frames += lost;
+		reader->read_position += lost;
+		frames -= lost;
+	}
+	reader->read_position += frames;
+	return (long)frames;
+}
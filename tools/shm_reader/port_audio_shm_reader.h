@@ -0,0 +1,40 @@
+/*
+ * Reader for streams published with PortAudio.publish_stream().
+ * Any number of readers can attach, the writer never waits for them.
+ */
+#ifndef PORT_AUDIO_SHM_READER_H
+#define PORT_AUDIO_SHM_READER_H
+
+#include "port_audio_shm.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct PortAudioShmReader {
+	int fd;
+	size_t mapped_size;
+	PortAudioShmHeader *header;
+	const float *samples;
+	uint64_t read_position;
+	/* frames lost because the reader fell more than capacity_frames behind */
+	uint64_t overrun_frames;
+} PortAudioShmReader;
+
+/* attaches to the endpoint called name (as passed to publish_stream), reading starts at the current write position */
+int port_audio_shm_reader_open(PortAudioShmReader *reader, const char *name);
+void port_audio_shm_reader_close(PortAudioShmReader *reader);
+
+/*
+ * copies up to max_frames interleaved frames into destination, waiting up to timeout_ms (-1 forever) for data.
+ * returns the number of frames, 0 on timeout and -1 once the writer closed the endpoint.
+ */
+long port_audio_shm_reader_read(PortAudioShmReader *reader, float *destination, unsigned long max_frames, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Writes a published stream as raw interleaved 32 bit floats to stdout, e.g.
+ *   cc -O2 -o shm_cat shm_cat.c port_audio_shm_reader.c -lrt
+ *   ./shm_cat /godot_output | ffmpeg -f f32le -ar 48000 -ac 2 -i - out.flac
+ */
+#include "port_audio_shm_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char **argv) {
+	PortAudioShmReader reader;
+	float *buffer;
+	long frames;
+	const unsigned long max_frames = 4096;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <name>\n", argv[0]);
+		return 1;
+	}
+	if (port_audio_shm_reader_open(&reader, argv[1]) != 0) {
+		perror("port_audio_shm_reader_open");
+		return 1;
+	}
+	fprintf(stderr, "%u channels, %.0f Hz\n", reader.header->channel_count, reader.header->sample_rate);
+	buffer = (float *)malloc(max_frames * reader.header->channel_count * sizeof(float));
+	while ((frames = port_audio_shm_reader_read(&reader, buffer, max_frames, 1000)) >= 0) {
+		if (frames > 0) {
+			fwrite(buffer, sizeof(float) * reader.header->channel_count, (size_t)frames, stdout);
+		}
+	}
+	if (reader.overrun_frames > 0) {
+		fprintf(stderr, "%llu frames lost to overruns\n", (unsigned long long)reader.overrun_frames);
+	}
+	free(buffer);
+	port_audio_shm_reader_close(&reader);
+	return 0;
+}